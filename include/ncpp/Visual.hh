@@ -114,6 +114,11 @@ namespace ncpp
 			return error_guard (ncvisual_set_yx (visual, y, x, pixel), -1);
 		}
 
+		bool set_pxbudget (size_t bytes) const NOEXCEPT_MAYBE
+		{
+			return error_guard (ncvisual_set_pxbudget (visual, bytes), -1);
+		}
+
 	private:
 		void common_init (ncplane *plane, const char *file)
 		{
@@ -36,6 +36,10 @@ extern "C" {
 // all diagnostics, a superset of NCDIRECT_OPTION_VERBOSE (which this implies).
 #define NCDIRECT_OPTION_VERY_VERBOSE        0x0020ull
 
+// Transmit kitty graphics only through the tty, never via shared memory or
+// temporary files. Chosen to match fullscreen mode's NCOPTION_NO_KITTY_SHM.
+#define NCDIRECT_OPTION_NO_KITTY_SHM        0x0040ull
+
 // Initialize a direct-mode Notcurses context on the connected terminal at 'fp'.
 // 'fp' must be a tty. You'll usually want stdout. Direct mode supports a
 // limited subset of Notcurses routines which directly affect 'fp', and neither
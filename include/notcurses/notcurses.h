@@ -48,6 +48,7 @@ struct nctablet;  // grouped item within an ncreel
 struct ncreel;    // hierarchical block-based data browser
 struct nctab;     // grouped item within an nctabbed
 struct nctabbed;  // widget with one tab visible at a time
+struct nclayout;  // text analyzed for repeated ncplane_puttext()-style output
 
 // we never blit full blocks, but instead spaces (more efficient) with the
 // background set to the desired foreground. these need be kept in the same
@@ -900,6 +901,12 @@ typedef enum {
 // anything but the virtual console/terminal in which Notcurses is running.
 #define NCOPTION_NO_FONT_CHANGES     0x0080ull
 
+// When the terminal speaks the kitty graphics protocol and shares our
+// machine, Notcurses hands it large images through POSIX shared memory (or
+// temporary files), rather than base64 through the tty. Set to always use
+// the tty, and to skip probing for these transmission mediums.
+#define NCOPTION_NO_KITTY_SHM        0x0100ull
+
 // Configuration for notcurses_init().
 typedef struct notcurses_options {
   // The name of the terminfo database entry describing this terminal. If NULL,
@@ -1203,6 +1210,11 @@ API char* notcurses_at_yx(struct notcurses* nc, int yoff, int xoff,
 // with the parent (it will still move with the parent, maintaining its
 // relative position, if the parent is moved to a new location).
 #define NCPLANE_OPTION_FIXED      0x0008ull
+// Allocate the plane's framebuffer lazily, in bands of rows, upon the first
+// write to each band. Unwritten bands read as empty cells (i.e. they show the
+// plane's base cell), and cost no memory. Useful for very large planes which
+// are mostly empty, e.g. a deep scrollback.
+#define NCPLANE_OPTION_TILED      0x0010ull
 
 typedef struct ncplane_options {
   int y;            // vertical placement relative to parent plane
@@ -1292,6 +1304,25 @@ API bool ncplane_set_scrolling(struct ncplane* n, bool scrollp)
 API bool ncplane_scrolling_p(const struct ncplane* n)
   __attribute__ ((nonnull (1)));
 
+// Retain rows scrolled off the top of 'n' in a scrollback history, stored in
+// a memory-mapped file at 'path' (which is created, or truncated). Pass NULL
+// to discard the history (the file is left in place). History is disabled by
+// default. Not yet supported on Windows.
+API int ncplane_set_history(struct ncplane* n, const char* path)
+  __attribute__ ((nonnull (1)));
+
+// Return the number of rows retained in the history of 'n'.
+API int ncplane_history_rows(const struct ncplane* n)
+  __attribute__ ((nonnull (1)));
+
+// Render 'n' as if it were 'rows' rows back in its history: the top 'rows'
+// rows are drawn from history, and the live rows are drawn shifted down by
+// 'rows'. 0 returns to the live view. Only rendering is affected; output
+// still goes to the live plane. While sought, the view stays anchored to the
+// same rows as 'n' scrolls. Resizing 'n' returns it to the live view.
+API int ncplane_history_seek(struct ncplane* n, int rows)
+  __attribute__ ((nonnull (1)));
+
 // Palette API. Some terminals only support 256 colors, but allow the full
 // palette to be specified with arbitrary RGB colors. In all cases, it's more
 // performant to use indexed colors, since it's much less data to write to the
@@ -1481,6 +1512,8 @@ typedef struct ncstats {
   uint64_t sprixelbytes;     // sprixel bytes emitted
   uint64_t input_errors;     // errors processing control sequences/utf8
   uint64_t input_events;     // characters returned to userspace
+  uint64_t blitcache_hits;   // cell blits replayed from an ncvisual's cache
+  uint64_t blitcache_misses; // cacheable cell blits performed afresh
 } ncstats;
 
 // Allocate an ncstats object. Use this rather than allocating your own, since
@@ -1761,6 +1794,18 @@ ncplane_putc(struct ncplane* n, const nccell* c){
   return ncplane_putc_yx(n, -1, -1, c);
 }
 
+// Write the 'len' cells of 'cells' to a single row of 'n', starting at the
+// specified coordinates (-1 for the cursor's row and/or column), as if by
+// repeated calls to ncplane_putc_yx(), but checking the row once for the
+// entire span. Secondary columns of wide glyphs in 'cells' are skipped, so a
+// row read with ncplane_at_yx_cell() can be written back directly. The span
+// must fit on the row; it neither wraps nor scrolls. On success, the cursor
+// follows the span, and the number of columns written is returned. On
+// failure, -1 is returned.
+API int ncplane_putcells_yx(struct ncplane* n, int y, int x,
+                            const nccell* cells, unsigned len)
+  __attribute__ ((nonnull (1, 4)));
+
 // Replace the cell at the specified coordinates with the provided 7-bit char
 // 'c'. Advance the cursor by 1. On success, returns 1. On failure, returns -1.
 // This works whether the underlying char is signed or unsigned.
@@ -2020,6 +2065,25 @@ ncplane_printf_stained(struct ncplane* n, const char* format, ...){
 API int ncplane_puttext(struct ncplane* n, int y, ncalign_e align,
                         const char* text, size_t* bytes);
 
+// Analyze 'text' (which may be NULL) for output with ncplane_putlayout(). The
+// layout retains its own copy of the text, the widths and break opportunities
+// of each word, and the lines as most recently filled. Writing the layout
+// again at the same plane width and starting column reuses those lines; a
+// change of width only recomputes where the lines break.
+API ALLOC struct nclayout* nclayout_create(const char* text);
+
+// Append 'text' to the layout. Only the final paragraph of the prior text
+// (that following its last linebreaker) is reanalyzed. Returns -1 on invalid
+// UTF-8, in which case the layout is unchanged.
+API int nclayout_append(struct nclayout* l, const char* text);
+
+// Write the layout to 'n' exactly as ncplane_puttext() would write its text,
+// with the same arguments and return value.
+API int ncplane_putlayout(struct ncplane* n, int y, ncalign_e align,
+                          struct nclayout* l, size_t* bytes);
+
+API void nclayout_destroy(struct nclayout* l);
+
 // Draw horizontal or vertical lines using the specified cell, starting at the
 // current cursor position. The cursor will end at the cell following the last
 // cell output (even, perhaps counter-intuitively, when drawing vertical
@@ -2699,6 +2763,10 @@ API ALLOC struct ncvisual* ncvisual_from_plane(const struct ncplane* n,
 #define NCVISUAL_OPTION_CHILDPLANE    0x0020ull // interpret n as parent
 #define NCVISUAL_OPTION_NOINTERPOLATE 0x0040ull // non-interpolative scaling
                                                 // 0x0080 is used internally
+#define NCVISUAL_OPTION_THREADED      0x0100ull // blit bands in parallel
+#define NCVISUAL_OPTION_CACHED        0x0200ull // memoize cell blits
+#define NCVISUAL_OPTION_MEDIANCUT     0x0400ull // median cut sixel palette
+#define NCVISUAL_OPTION_KEEPPALETTE   0x0800ull // carry sixel palette across frames
 
 struct ncvisual_options {
   // if no ncplane is provided, one will be created using the exact size
@@ -2796,6 +2864,12 @@ API int ncvisual_at_yx(const struct ncvisual* n, int y, int x, uint32_t* pixel)
 API int ncvisual_set_yx(const struct ncvisual* n, int y, int x, uint32_t pixel)
   __attribute__ ((nonnull (1)));
 
+// Keep Sixel output rendered from 'n' below 'bytes' bytes (where possible) by
+// quantizing to fewer color registers. 0 (the default) removes the budget.
+// Other blitters ignore it.
+API int ncvisual_set_pxbudget(struct ncvisual* n, size_t bytes)
+  __attribute__ ((nonnull (1)));
+
 // Render the decoded frame to the specified ncplane. If one is not provided,
 // one will be created, having the exact size necessary to display the visual.
 // A subregion of the visual can be rendered using 'begx', 'begy', 'lenx', and
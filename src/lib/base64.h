@@ -18,7 +18,7 @@ static unsigned const char b64subs[] =
 // check the pixel against the transcolor. matches (and sufficiently low alpha)
 // are likewise flattened to alpha=0.
 static inline void
-base64_rgba3(const uint32_t* pixels, size_t pcount, char* b64, bool wipe[static 3],
+base64_rgba3(const uint32_t* pixels, size_t pcount, char* b64, const bool wipe[3],
              uint32_t transcolor){
   uint32_t pixel = *pixels++;
   unsigned r = ncpixel_r(pixel);
@@ -31,7 +31,7 @@ base64_rgba3(const uint32_t* pixels, size_t pcount, char* b64, bool wipe[static
     a = 0;
   }
   b64[0] = b64subs[(r & 0xfc) >> 2];
-  b64[1] = b64subs[(r & 0x3 << 4) | ((g & 0xf0) >> 4)];
+  b64[1] = b64subs[((r & 0x3) << 4) | ((g & 0xf0) >> 4)];
   b64[2] = b64subs[((g & 0xf) << 2) | ((b & 0xc0) >> 6)];
   b64[3] = b64subs[b & 0x3f];
   b64[4] = b64subs[(a & 0xfc) >> 2];
@@ -47,7 +47,7 @@ base64_rgba3(const uint32_t* pixels, size_t pcount, char* b64, bool wipe[static
   r = ncpixel_r(pixel);
   g = ncpixel_g(pixel);
   b = ncpixel_b(pixel);
-  a = wipe[1] ? 0 : rgba_trans_p(pixel, transcolor) ? 0 : 255;
+  a = wipe[1] ? 0 : rgba_trans_p(pixel, transcolor) ? 0 : ncpixel_a(pixel);
   b64[5] = b64subs[b64[5] | ((r & 0xf0) >> 4)];
   b64[6] = b64subs[((r & 0xf) << 2) | ((g & 0xc0) >> 6u)];
   b64[7] = b64subs[g & 0x3f];
@@ -64,7 +64,7 @@ base64_rgba3(const uint32_t* pixels, size_t pcount, char* b64, bool wipe[static
   r = ncpixel_r(pixel);
   g = ncpixel_g(pixel);
   b = ncpixel_b(pixel);
-  a = wipe[2] ? 0 : rgba_trans_p(pixel, transcolor) ? 0 : 255;
+  a = wipe[2] ? 0 : rgba_trans_p(pixel, transcolor) ? 0 : ncpixel_a(pixel);
   b64[10] = b64subs[b64[10] | ((r & 0xc0) >> 6)];
   b64[11] = b64subs[r & 0x3f];
   b64[12] = b64subs[(g & 0xfc) >> 2];
@@ -110,6 +110,110 @@ base64final(const unsigned char* src, char* b64, size_t b){
   }
 }
 
+#if defined(__GNUC__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__ && \
+    (defined(__x86_64__) || defined(__aarch64__))
+// encode 12 bytes at a time into 16 base64 characters. the bytes are shuffled
+// such that each 32-bit lane holds source bytes (1, 0, 2, 1) of its triple,
+// from which all four sextets can be extracted with shifts and masks. the
+// sextets are then mapped onto the alphabet by range (A-Z, a-z, 0-9, +, /).
+// the shuffle wants a byte permute (TBL on aarch64, PSHUFB on x86-64). the
+// x86-64 baseline (SSE2) has none, and is slower than the scalar encoder, so
+// there we only use vectors where we can detect AVX2 at runtime.
+#define BASE64_VEC
+typedef int8_t b64vec8 __attribute__ ((vector_size (16)));
+typedef uint32_t b64vec32 __attribute__ ((vector_size (16)));
+#if defined(__x86_64__)
+#define BASE64_AVX2
+#endif
+#ifdef __clang__
+#define B64VEC_SPREAD(v) \
+  __builtin_shufflevector(v, v, 1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10)
+#else
+#define B64VEC_SPREAD(v) \
+  __builtin_shuffle(v, (b64vec8){1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10})
+#endif
+
+// encode a single group from |in|, of which only the low 12 bytes are used
+#define B64VEC_GROUP(in, b64) do{ \
+  b64vec32 l_ = (b64vec32)B64VEC_SPREAD(in); \
+  b64vec32 sextets_ = ((l_ >> 10u) & 0x3f) | (((l_ >> 4u) & 0x3f) << 8u) | \
+                      (((l_ >> 22u) & 0x3f) << 16u) | (((l_ >> 16u) & 0x3f) << 24u); \
+  b64vec8 i_ = (b64vec8)sextets_; \
+  b64vec8 off_ = (b64vec8){0} + 'A'; \
+  off_ += (i_ > 25) & ('a' - 26 - 'A'); \
+  off_ += (i_ > 51) & ('0' - 52 - ('a' - 26)); \
+  off_ += (i_ > 61) & ('+' - 62 - ('0' - 52)); \
+  off_ += (i_ > 62) & ('/' - 63 - ('+' - 62)); \
+  i_ += off_; \
+  memcpy((b64), &i_, 16); \
+}while(0)
+
+// always inlined, so that each encoder compiles it for its own target
+static inline __attribute__ ((always_inline)) void
+base64_groups(const unsigned char* src, size_t groups, char* b64){
+  if(groups == 0){
+    return;
+  }
+  b64vec8 in;
+  // the shuffle ignores the top four bytes, so we can load them from the
+  // following group, so long as there is one.
+  while(--groups){
+    memcpy(&in, src, 16);
+    B64VEC_GROUP(in, b64);
+    src += 12;
+    b64 += 16;
+  }
+  in = (b64vec8){0};
+  memcpy(&in, src, 12);
+  B64VEC_GROUP(in, b64);
+}
+
+#ifdef BASE64_AVX2
+__attribute__ ((target ("avx2"))) static inline void
+base64_groups_avx2(const unsigned char* src, size_t groups, char* b64){
+  base64_groups(src, groups, b64);
+}
+#else
+static inline void
+base64_groups_vec(const unsigned char* src, size_t groups, char* b64){
+  base64_groups(src, groups, b64);
+}
+#endif
+#endif
+
+// base64-encode |len| bytes of |src| into |b64|, which must have room for
+// 4 * ((len + 2) / 3) characters. no terminator is written. this is the same
+// stream as produced by successive base64x3() calls and a final
+// base64final(), but works through 12-byte groups in vector registers where
+// possible.
+static inline void
+base64_encode(const unsigned char* src, size_t len, char* b64){
+#ifdef BASE64_VEC
+  size_t groups = len / 12;
+#ifdef BASE64_AVX2
+  if(__builtin_cpu_supports("avx2")){
+    base64_groups_avx2(src, groups, b64);
+  }else{
+    groups = 0;
+  }
+#else
+  base64_groups_vec(src, groups, b64);
+#endif
+  src += groups * 12;
+  b64 += groups * 16;
+  len -= groups * 12;
+#endif
+  while(len >= 3){
+    base64x3(src, b64);
+    src += 3;
+    b64 += 4;
+    len -= 3;
+  }
+  if(len){
+    base64final(src, b64, len);
+  }
+}
+
 #ifdef __cplusplus
 }
 #endif
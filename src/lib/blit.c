@@ -1,59 +1,11 @@
 #include <stddef.h>
 #include <inttypes.h>
 #include "internal.h"
+#include "blitsolve.h"
 
 static const uint32_t zeroes32;
 static const unsigned char zeroes[] = "\x00\x00\x00\x00";
 
-// linearly interpolate a 24-bit RGB value along each 8-bit channel
-static inline uint32_t
-lerp(uint32_t c0, uint32_t c1, unsigned nointerpolate){
-  unsigned r0, g0, b0, r1, g1, b1;
-  uint32_t ret = 0;
-  ncchannel_rgb8(c0, &r0, &g0, &b0);
-  if(!nointerpolate){
-    ncchannel_rgb8(c1, &r1, &g1, &b1);
-    ncchannel_set_rgb8(&ret, (r0 + r1 + 1) / 2,
-                          (g0 + g1 + 1) / 2,
-                          (b0 + b1 + 1) / 2);
-  }else{
-    ncchannel_set_rgb8(&ret, r0, g0, b0);
-  }
-  return ret;
-}
-
-// linearly interpolate a 24-bit RGB value along each 8-bit channel
-static inline uint32_t
-trilerp(uint32_t c0, uint32_t c1, uint32_t c2, unsigned nointerpolate){
-  uint32_t ret = 0;
-  unsigned r0, g0, b0, r1, g1, b1, r2, g2, b2;
-  ncchannel_rgb8(c0, &r0, &g0, &b0);
-  if(!nointerpolate){
-    ncchannel_rgb8(c1, &r1, &g1, &b1);
-    ncchannel_rgb8(c2, &r2, &g2, &b2);
-    ncchannel_set_rgb8(&ret, (r0 + r1 + r2 + 2) / 3,
-                          (g0 + g1 + g2 + 2) / 3,
-                          (b0 + b1 + b2 + 2) / 3);
-  }else{
-    ncchannel_set_rgb8(&ret, r0, g0, b0);
-  }
-  return ret;
-}
-
-// take a sum over channels, and the sample count, write back lerped channel
-static inline uint32_t
-generalerp(unsigned rsum, unsigned gsum, unsigned bsum, int count){
-  if(count == 0){
-    assert(0 == rsum);
-    assert(0 == gsum);
-    assert(0 == bsum);
-    return 0;
-  }
-  return NCCHANNEL_INITIALIZER((rsum + (count - 1)) / count,
-                               (gsum + (count - 1)) / count,
-                               (bsum + (count - 1)) / count);
-}
-
 static inline unsigned
 rgba_trans_q(const unsigned char* p, uint32_t transcolor){
   uint32_t q;
@@ -77,7 +29,8 @@ tria_blit_ascii(ncplane* nc, int linesize, const void* data,
     if(y < 0){
       continue;
     }
-    if(ncplane_cursor_move_yx(nc, y, bargs->u.cell.placex < 0 ? 0 : bargs->u.cell.placex)){
+    if(!bargs->u.cell.banded &&
+       ncplane_cursor_move_yx(nc, y, bargs->u.cell.placex < 0 ? 0 : bargs->u.cell.placex)){
       return -1;
     }
     int visx = bargs->begx;
@@ -88,6 +41,9 @@ tria_blit_ascii(ncplane* nc, int linesize, const void* data,
       const unsigned char* rgbbase_up = dat + (linesize * visy) + (visx * 4);
 //fprintf(stderr, "[%04d/%04d] lsize: %d %02x %02x %02x %02x\n", y, x, linesize, rgbbase_up[0], rgbbase_up[1], rgbbase_up[2], rgbbase_up[3]);
       nccell* c = ncplane_cell_ref_yx(nc, y, x);
+      if(c == NULL){
+        return -1;
+      }
       // use the default for the background, as that's the only way it's
       // effective in that case anyway
       c->channels = 0;
@@ -132,7 +88,8 @@ tria_blit(ncplane* nc, int linesize, const void* data, int leny, int lenx,
     if(y < 0){
       continue;
     }
-    if(ncplane_cursor_move_yx(nc, y, bargs->u.cell.placex < 0 ? 0 : bargs->u.cell.placex)){
+    if(!bargs->u.cell.banded &&
+       ncplane_cursor_move_yx(nc, y, bargs->u.cell.placex < 0 ? 0 : bargs->u.cell.placex)){
       return -1;
     }
     int visx = bargs->begx;
@@ -147,6 +104,9 @@ tria_blit(ncplane* nc, int linesize, const void* data, int leny, int lenx,
       }
 //fprintf(stderr, "[%04d/%04d] lsize: %d %02x %02x %02x %02x\n", y, x, linesize, rgbbase_up[0], rgbbase_up[1], rgbbase_up[2], rgbbase_up[3]);
       nccell* c = ncplane_cell_ref_yx(nc, y, x);
+      if(c == NULL){
+        return -1;
+      }
       // use the default for the background, as that's the only way it's
       // effective in that case anyway
       c->channels = 0;
@@ -198,137 +158,6 @@ tria_blit(ncplane* nc, int linesize, const void* data, int leny, int lenx,
   return total;
 }
 
-// once we find the closest pair of colors, we need look at the other two
-// colors, and determine whether either belongs with us rather with them.
-// if so, take the closer, and trilerp it in with us. otherwise, lerp the
-// two excluded pixels (and retain our original lerp).
-static const struct qdriver {
-  int pair[2];      // indices of contributing pair
-  int others[2];    // indices of excluded pair
-  const char* egc;  // EGC corresponding to contributing pair
-  const char* oth0egc; // EGC upon absorbing others[0]
-  const char* oth1egc; // EGC upon absorbing others[1]
-} quadrant_drivers[6] = {
-  { .pair = { 0, 1 }, .others = { 2, 3 }, .egc = "▀", .oth0egc = "▛", .oth1egc = "▜", },
-  { .pair = { 0, 2 }, .others = { 1, 3 }, .egc = "▌", .oth0egc = "▛", .oth1egc = "▙", },
-  { .pair = { 0, 3 }, .others = { 1, 2 }, .egc = "▚", .oth0egc = "▜", .oth1egc = "▙", },
-  { .pair = { 1, 2 }, .others = { 0, 3 }, .egc = "▞", .oth0egc = "▛", .oth1egc = "▟", },
-  { .pair = { 1, 3 }, .others = { 0, 2 }, .egc = "▐", .oth0egc = "▜", .oth1egc = "▟", },
-  { .pair = { 2, 3 }, .others = { 0, 1 }, .egc = "▄", .oth0egc = "▙", .oth1egc = "▟", },
-};
-
-// get the six distances between four colors. diffs must be an array of
-// at least 6 uint32_t values.
-static void
-rgb_4diff(uint32_t* diffs, uint32_t tl, uint32_t tr, uint32_t bl, uint32_t br){
-  struct rgb {
-    unsigned r, g, b;
-  } colors[4];
-  ncchannel_rgb8(tl, &colors[0].r, &colors[0].g, &colors[0].b);
-  ncchannel_rgb8(tr, &colors[1].r, &colors[1].g, &colors[1].b);
-  ncchannel_rgb8(bl, &colors[2].r, &colors[2].g, &colors[2].b);
-  ncchannel_rgb8(br, &colors[3].r, &colors[3].g, &colors[3].b);
-  for(size_t idx = 0 ; idx < sizeof(quadrant_drivers) / sizeof(*quadrant_drivers) ; ++idx){
-    const struct qdriver* qd = quadrant_drivers + idx;
-    const struct rgb* rgb0 = colors + qd->pair[0];
-    const struct rgb* rgb1 = colors + qd->pair[1];
-    diffs[idx] = rgb_diff(rgb0->r, rgb0->g, rgb0->b,
-                          rgb1->r, rgb1->g, rgb1->b);
-  }
-}
-
-// solve for the EGC and two colors to best represent four colors at top
-// left, top right, bot left, bot right
-static inline const char*
-quadrant_solver(uint32_t tl, uint32_t tr, uint32_t bl, uint32_t br,
-                uint32_t* fore, uint32_t* back, unsigned nointerpolate){
-  const uint32_t colors[4] = { tl, tr, bl, br };
-//fprintf(stderr, "%08x/%08x/%08x/%08x\n", tl, tr, bl, br);
-  uint32_t diffs[sizeof(quadrant_drivers) / sizeof(*quadrant_drivers)];
-  rgb_4diff(diffs, tl, tr, bl, br);
-  // compiler can't verify that we'll always be less than 769 somewhere,
-  // so fuck it, just go ahead and initialize to 0 / diffs[0]
-  size_t mindiffidx = 0;
-  unsigned mindiff = diffs[0]; // 3 * 256 + 1; // max distance is 256 * 3
-  // if all diffs are 0, emit a space
-  bool allzerodiffs = (mindiff == 0);
-  for(size_t idx = 1 ; idx < sizeof(diffs) / sizeof(*diffs) ; ++idx){
-    if(diffs[idx] < mindiff){
-      mindiffidx = idx;
-      mindiff = diffs[idx];
-    }
-    if(diffs[idx]){
-      allzerodiffs = false;
-    }
-  }
-  if(allzerodiffs){
-    *fore = *back = tl;
-    return " ";
-  }
-  // at this point, 0 <= mindiffidx <= 5. foreground color will be the
-  // lerp of this nearest pair. we then check the other two. if they are
-  // closer to one another than either is to our lerp, lerp between them.
-  // otherwise, bring the closer one into our lerped fold.
-  const struct qdriver* qd = &quadrant_drivers[mindiffidx];
-  // the diff of the excluded pair is conveniently located at the inverse
-  // location within diffs[] viz mindiffidx.
-  // const uint32_t otherdiff = diffs[5 - mindiffidx];
-  *fore = lerp(colors[qd->pair[0]], colors[qd->pair[1]], nointerpolate);
-  *back = lerp(colors[qd->others[0]], colors[qd->others[1]], nointerpolate);
-//fprintf(stderr, "mindiff: %u[%zu] fore: %08x back: %08x %d+%d/%d+%d\n", mindiff, mindiffidx, *fore, *back, qd->pair[0], qd->pair[1], qd->others[0], qd->others[1]);
-  const char* egc = qd->egc;
-  // break down the excluded pair and lerp
-  unsigned r0, r1, r2, g0, g1, g2, b0, b1, b2;
-  unsigned roth, goth, both, rlerp, glerp, blerp;
-  ncchannel_rgb8(*back, &roth, &goth, &both);
-  ncchannel_rgb8(*fore, &rlerp, &glerp, &blerp);
-//fprintf(stderr, "rgbs: %02x %02x %02x / %02x %02x %02x\n", r0, g0, b0, r1, g1, b1);
-  // get diffs of the excluded two from both lerps
-  ncchannel_rgb8(colors[qd->others[0]], &r0, &g0, &b0);
-  ncchannel_rgb8(colors[qd->others[1]], &r1, &g1, &b1);
-  diffs[0] = rgb_diff(r0, g0, b0, roth, goth, both);
-  diffs[1] = rgb_diff(r1, g1, b1, roth, goth, both);
-  diffs[2] = rgb_diff(r0, g0, b0, rlerp, glerp, blerp);
-  diffs[3] = rgb_diff(r1, g1, b1, rlerp, glerp, blerp);
-  // get diffs of the included two from their lerp
-  ncchannel_rgb8(colors[qd->pair[0]], &r0, &g0, &b0);
-  ncchannel_rgb8(colors[qd->pair[1]], &r1, &g1, &b1);
-  diffs[4] = rgb_diff(r0, g0, b0, rlerp, glerp, blerp);
-  diffs[5] = rgb_diff(r1, g1, b1, rlerp, glerp, blerp);
-  unsigned curdiff = diffs[0] + diffs[1] + diffs[4] + diffs[5];
-  // it might be better to combine three, and leave one totally unchanged.
-  // propose a trilerps; we only need consider the member of the excluded pair
-  // closer to the primary lerp. recalculate total diff; merge if lower.
-  if(diffs[2] < diffs[3]){
-    unsigned tri = trilerp(colors[qd->pair[0]], colors[qd->pair[1]], colors[qd->others[0]],
-                           nointerpolate);
-    ncchannel_rgb8(colors[qd->others[0]], &r2, &g2, &b2);
-    ncchannel_rgb8(tri, &roth, &goth, &both);
-    if(rgb_diff(r0, g0, b0, roth, goth, both) +
-       rgb_diff(r1, g1, b1, roth, goth, both) +
-       rgb_diff(r2, g2, b2, roth, goth, both) < curdiff){
-      egc = qd->oth0egc;
-      *back = colors[qd->others[1]];
-      *fore = tri;
-    }
-//fprintf(stderr, "quadblitter swap type 1\n");
-  }else{
-    unsigned tri = trilerp(colors[qd->pair[0]], colors[qd->pair[1]], colors[qd->others[1]],
-                           nointerpolate);
-    ncchannel_rgb8(colors[qd->others[1]], &r2, &g2, &b2);
-    ncchannel_rgb8(tri, &roth, &goth, &both);
-    if(rgb_diff(r0, g0, b0, roth, goth, both) +
-       rgb_diff(r1, g1, b1, roth, goth, both) +
-       rgb_diff(r2, g2, b2, roth, goth, both) < curdiff){
-      egc = qd->oth1egc;
-      *back = colors[qd->others[0]];
-      *fore = tri;
-    }
-//fprintf(stderr, "quadblitter swap type 2\n");
-  }
-  return egc;
-}
-
 // quadrant check for transparency. returns an EGC if we found transparent
 // quads and have solved for colors (this EGC ought then be loaded into the
 // cell). returns NULL otherwise. transparency trumps everything else in terms
@@ -446,6 +275,49 @@ qtrans_check(nccell* c, unsigned blendcolors,
   return egc;
 }
 
+// opaque cells are solved in batches of up to this many
+#define BLIT_BATCH 64
+
+// solve the queued opaque quadrant cells, and write them out.
+static void
+quadrant_flush(ncplane* nc, nccell** cells, const uint32_t (*blocks)[4],
+               unsigned count, bool blendcolors, unsigned nointerpolate){
+  uint8_t solved[BLIT_BATCH];
+  uint32_t fores[BLIT_BATCH], backs[BLIT_BATCH];
+  quadrant_solve_batch(blocks, count, solved, fores, backs, nointerpolate);
+  for(unsigned i = 0 ; i < count ; ++i){
+    nccell* c = cells[i];
+    cell_set_fchannel(c, fores[i]);
+    cell_set_bchannel(c, backs[i]);
+    if(blendcolors){
+      nccell_set_bg_alpha(c, NCALPHA_BLEND);
+      nccell_set_fg_alpha(c, NCALPHA_BLEND);
+    }
+    cell_set_blitquadrants(c, 1, 1, 1, 1);
+    pool_blit_packed(&nc->pool, c, quadrant_solved_egc(solved[i]));
+  }
+}
+
+// solve the queued opaque sextant cells, and write them out.
+static void
+sex_flush(ncplane* nc, nccell** cells, const uint32_t (*blocks)[6],
+          unsigned count, bool blendcolors, unsigned nointerpolate){
+  uint8_t solved[BLIT_BATCH];
+  uint32_t l0s[BLIT_BATCH], l1s[BLIT_BATCH];
+  sex_solve_batch(blocks, count, solved, l0s, l1s, nointerpolate);
+  for(unsigned i = 0 ; i < count ; ++i){
+    nccell* c = cells[i];
+    ncchannels_set_fchannel(&c->channels, l0s[i]);
+    ncchannels_set_bchannel(&c->channels, l1s[i]);
+    if(blendcolors){
+      ncchannels_set_fg_alpha(&c->channels, NCALPHA_BLEND);
+      ncchannels_set_bg_alpha(&c->channels, NCALPHA_BLEND);
+    }
+    cell_set_blitquadrants(c, 1, 1, 1, 1);
+    pool_blit_packed(&nc->pool, c, sex_solver_egcs[solved[i]]);
+  }
+}
+
 // quadrant blitter. maps 2x2 to each cell. since we only have two colors at
 // our disposal (foreground and background), we lose some fidelity.
 static inline int
@@ -455,6 +327,9 @@ quadrant_blit(ncplane* nc, int linesize, const void* data, int leny, int lenx,
   const bool blendcolors = bargs->flags & NCVISUAL_OPTION_BLEND;
   int dimy, dimx, x, y;
   int total = 0; // number of cells written
+  nccell* cells[BLIT_BATCH]; // opaque cells awaiting the solver
+  uint32_t blocks[BLIT_BATCH][4];
+  unsigned pending = 0;
   ncplane_dim_yx(nc, &dimy, &dimx);
 //fprintf(stderr, "quadblitter %dx%d -> %d/%d+%d/%d\n", leny, lenx, dimy, dimx, bargs->u.cell.placey, bargs->u.cell.placex);
   // FIXME not going to necessarily be safe on all architectures hrmmm
@@ -464,7 +339,8 @@ quadrant_blit(ncplane* nc, int linesize, const void* data, int leny, int lenx,
     if(y < 0){
       continue;
     }
-    if(ncplane_cursor_move_yx(nc, y, bargs->u.cell.placex < 0 ? 0 : bargs->u.cell.placex)){
+    if(!bargs->u.cell.banded &&
+       ncplane_cursor_move_yx(nc, y, bargs->u.cell.placex < 0 ? 0 : bargs->u.cell.placex)){
       return -1;
     }
     int visx = bargs->begx;
@@ -487,148 +363,58 @@ quadrant_blit(ncplane* nc, int linesize, const void* data, int leny, int lenx,
       }
 //fprintf(stderr, "[%04d/%04d] lsize: %d %02x %02x %02x %02x\n", y, x, linesize, rgbbase_tl[0], rgbbase_tr[1], rgbbase_bl[2], rgbbase_br[3]);
       nccell* c = ncplane_cell_ref_yx(nc, y, x);
+      if(c == NULL){
+        return -1;
+      }
       c->channels = 0;
       c->stylemask = 0;
       const char* egc = qtrans_check(c, blendcolors, rgbbase_tl, rgbbase_tr,
                                      rgbbase_bl, rgbbase_br, bargs->transcolor,
                                      nointerpolate);
-      if(egc == NULL){
-        uint32_t tl = 0, tr = 0, bl = 0, br = 0;
-        ncchannel_set_rgb8(&tl, rgbbase_tl[0], rgbbase_tl[1], rgbbase_tl[2]);
-        ncchannel_set_rgb8(&tr, rgbbase_tr[0], rgbbase_tr[1], rgbbase_tr[2]);
-        ncchannel_set_rgb8(&bl, rgbbase_bl[0], rgbbase_bl[1], rgbbase_bl[2]);
-        ncchannel_set_rgb8(&br, rgbbase_br[0], rgbbase_br[1], rgbbase_br[2]);
-        uint32_t bg, fg;
-//fprintf(stderr, "qtrans check: %d/%d\n%08x %08x\n%08x %08x\n", y, x, *(const uint32_t*)rgbbase_tl, *(const uint32_t*)rgbbase_tr, *(const uint32_t*)rgbbase_bl, *(const uint32_t*)rgbbase_br);
-        egc = quadrant_solver(tl, tr, bl, br, &fg, &bg, nointerpolate);
-        assert(egc);
-//fprintf(stderr, "%d/%d %08x/%08x\n", y, x, fg, bg);
-        cell_set_fchannel(c, fg);
-        cell_set_bchannel(c, bg);
-        if(blendcolors){
-          nccell_set_bg_alpha(c, NCALPHA_BLEND);
-          nccell_set_fg_alpha(c, NCALPHA_BLEND);
+      if(egc == NULL){ // no transparency; queue it up for the solver
+        uint32_t* block = blocks[pending];
+        memset(block, 0, sizeof(blocks[pending]));
+        ncchannel_set_rgb8(&block[0], rgbbase_tl[0], rgbbase_tl[1], rgbbase_tl[2]);
+        ncchannel_set_rgb8(&block[1], rgbbase_tr[0], rgbbase_tr[1], rgbbase_tr[2]);
+        ncchannel_set_rgb8(&block[2], rgbbase_bl[0], rgbbase_bl[1], rgbbase_bl[2]);
+        ncchannel_set_rgb8(&block[3], rgbbase_br[0], rgbbase_br[1], rgbbase_br[2]);
+        cells[pending++] = c;
+        if(pending == BLIT_BATCH){
+          quadrant_flush(nc, cells, blocks, pending, blendcolors, nointerpolate);
+          total += pending;
+          pending = 0;
         }
-        cell_set_blitquadrants(c, 1, 1, 1, 1);
+        continue;
       }
-      if(*egc){
-        if(pool_blit_direct(&nc->pool, c, egc, strlen(egc), 1) <= 0){
-          return -1;
-        }
+      if(*egc){ // qtrans_check() EGCs are three bytes and a NUL
+        pool_blit_packed(&nc->pool, c, egc);
         ++total;
       }
     }
   }
-  return total;
+  quadrant_flush(nc, cells, blocks, pending, blendcolors, nointerpolate);
+  return total + pending;
 }
 
-// Solve for the cell rendered by this 3x2 sample. None of the input pixels may
-// be transparent (that ought already have been handled). We use exhaustive
-// search, which might be quite computationally intensive for the worst case
-// (all six pixels are different colors). We want to solve for the 2-partition
-// of pixels that minimizes total source distance from the resulting lerps.
-static const char*
-sex_solver(const uint32_t rgbas[6], uint64_t* channels, unsigned blendcolors,
-           unsigned nointerpolate){
-  // each element within the set of 64 has an inverse element within the set,
-  // for which we would calculate the same total differences, so just handle
-  // the first 32. the partition[] bit masks represent combinations of
-  // sextants, and their indices correspond to sex[].
-  static const char* sex[32] = {
-    " ", "🬀", "🬁", "🬃", "🬇", "🬏", "🬞", "🬂", // 0..7
-    "🬄", "🬈", "🬐", "🬟", "🬅", "🬉", "🬑", "🬠", // 8..15
-    "🬋", "🬓", "🬢", "🬖", "🬦", "🬭", "🬆", "🬊", // 16..23
-    "🬒", "🬡", "🬌", "▌", "🬣", "🬗", "🬧", "🬍", // 24..31
-  };
-  static const unsigned partitions[32] = {
-    0, // 1 way to arrange 0
-    1, 2, 4, 8, 16, 32, // 6 ways to arrange 1
-    3, 5, 9, 17, 33, 6, 10, 18, 34, 12, 20, 36, 24, 40, 48, // 15 ways for 2
-    //  16 ways to arrange 3, *but* six of them are inverses, so 10
-    7, 11, 19, 35, 13, 21, 37, 25, 41, 14 //  10 + 15 + 6 + 1 == 32
-  };
-  // we loop over the bitstrings, dividing the pixels into two sets, and then
-  // taking a general lerp over each set. we then compute the sum of absolute
-  // differences, and see if it's the new minimum.
-  int best = -1;
-  uint32_t mindiff = UINT_MAX;
-//fprintf(stderr, "%06x %06x\n%06x %06x\n%06x %06x\n", rgbas[0], rgbas[1], rgbas[2], rgbas[3], rgbas[4], rgbas[5]);
-  for(size_t glyph = 0 ; glyph < sizeof(partitions) / sizeof(*partitions) ; ++glyph){
-    unsigned rsum0 = 0, rsum1 = 0;
-    unsigned gsum0 = 0, gsum1 = 0;
-    unsigned bsum0 = 0, bsum1 = 0;
-    int insum = 0;
-    int outsum = 0;
-    for(unsigned mask = 0 ; mask < 6 ; ++mask){
-      if(partitions[glyph] & (1u << mask)){
-        if(!nointerpolate || !insum){
-          rsum0 += ncpixel_r(rgbas[mask]);
-          gsum0 += ncpixel_g(rgbas[mask]);
-          bsum0 += ncpixel_b(rgbas[mask]);
-          ++insum;
-        }
-      }else{
-        if(!nointerpolate || !outsum){
-          rsum1 += ncpixel_r(rgbas[mask]);
-          gsum1 += ncpixel_g(rgbas[mask]);
-          bsum1 += ncpixel_b(rgbas[mask]);
-          ++outsum;
-        }
-      }
-    }
-    uint32_t l0 = generalerp(rsum0, gsum0, bsum0, insum);
-    uint32_t l1 = generalerp(rsum1, gsum1, bsum1, outsum);
-//fprintf(stderr, "sum0: %06x sum1: %06x insum: %d\n", l0 & 0xffffffu, l1 & 0xffffffu, insum);
-    uint32_t totaldiff = 0;
-    for(unsigned mask = 0 ; mask < 6 ; ++mask){
-      unsigned r, g, b;
-      if(partitions[glyph] & (1u << mask)){
-        ncchannel_rgb8(l0, &r, &g, &b);
-      }else{
-        ncchannel_rgb8(l1, &r, &g, &b);
-      }
-      uint32_t rdiff = rgb_diff(ncpixel_r(rgbas[mask]), ncpixel_g(rgbas[mask]),
-                                ncpixel_b(rgbas[mask]), r, g, b);
-      totaldiff += rdiff;
-//fprintf(stderr, "mask: %u totaldiff: %u insum: %d (%08x / %08x)\n", mask, totaldiff, insum, l0, l1);
-    }
-//fprintf(stderr, "bits: %u %zu totaldiff: %f best: %f (%d)\n", partitions[glyph], glyph, totaldiff, mindiff, best);
-    if(totaldiff < mindiff){
-      mindiff = totaldiff;
-      best = glyph;
-      ncchannels_set_fchannel(channels, l0);
-      ncchannels_set_bchannel(channels, l1);
-    }
-    if(totaldiff == 0){ // can't beat that!
-      break;
-    }
-  }
-//fprintf(stderr, "solved for best: %d (%u)\n", best, mindiff);
-  assert(best >= 0 && best < 32);
-  if(blendcolors){
-    ncchannels_set_fg_alpha(channels, NCALPHA_BLEND);
-    ncchannels_set_bg_alpha(channels, NCALPHA_BLEND);
-  }
-  return sex[best];
-}
+// sextant EGCs indexed by a bitmask of transparent sextants; the bit is *set*
+// where the sextant *is not*. each is padded as sex_solver_egcs[] is.
+// 32: bottom right 16: bottom left
+//  8: middle right  4: middle left
+//  2: upper right   1: upper left
+static const char sex_trans_egcs[64][5] = {
+  "█", "🬻", "🬺", "🬹", "🬸", "🬷", "🬶", "🬵",
+  "🬴", "🬳", "🬲", "🬱", "🬰", "🬯", "🬮", "🬭",
+  "🬬", "🬫", "🬪", "🬩", "🬨", "▐", "🬧", "🬦",
+  "🬥", "🬤", "🬣", "🬢", "🬡", "🬠", "🬟", "🬞",
+  "🬝", "🬜", "🬛", "🬚", "🬙", "🬘", "🬗", "🬖",
+  "🬕", "🬔", "▌", "🬓", "🬒", "🬑", "🬐", "🬏",
+  "🬎", "🬍", "🬌", "🬋", "🬊", "🬉", "🬈", "🬇",
+  "🬆", "🬅", "🬄", "🬃", "🬂", "🬁", "🬀", " ",
+};
 
 static const char*
 sex_trans_check(cell* c, const uint32_t rgbas[6], unsigned blendcolors,
                 uint32_t transcolor, unsigned nointerpolate){
-  // bit is *set* where sextant *is not*
-  // 32: bottom right 16: bottom left
-  //  8: middle right  4: middle left
-  //  2: upper right   1: upper left
-  static const char* sex[64] = {
-    "█", "🬻", "🬺", "🬹", "🬸", "🬷", "🬶", "🬵",
-    "🬴", "🬳", "🬲", "🬱", "🬰", "🬯", "🬮", "🬭",
-    "🬬", "🬫", "🬪", "🬩", "🬨", "▐", "🬧", "🬦",
-    "🬥", "🬤", "🬣", "🬢", "🬡", "🬠", "🬟", "🬞",
-    "🬝", "🬜", "🬛", "🬚", "🬙", "🬘", "🬗", "🬖",
-    "🬕", "🬔", "▌", "🬓", "🬒", "🬑", "🬐", "🬏",
-    "🬎", "🬍", "🬌", "🬋", "🬊", "🬉", "🬈", "🬇",
-    "🬆", "🬅", "🬄", "🬃", "🬂", "🬁", "🬀", " ",
-  };
   unsigned transstring = 0;
   unsigned r = 0, g = 0, b = 0;
   unsigned div = 0;
@@ -648,7 +434,7 @@ sex_trans_check(cell* c, const uint32_t rgbas[6], unsigned blendcolors,
   nccell_set_bg_alpha(c, NCALPHA_TRANSPARENT);
   // there were some transparent pixels. since they get priority, the foreground
   // is just a general lerp across non-transparent pixels.
-  const char* egc = sex[transstring];
+  const char* egc = sex_trans_egcs[transstring];
   nccell_set_bg_alpha(c, NCALPHA_TRANSPARENT);
 //fprintf(stderr, "transtring: %u egc: %s\n", transtring, egc);
   if(*egc == ' '){ // entirely transparent
@@ -676,6 +462,9 @@ sextant_blit(ncplane* nc, int linesize, const void* data, int leny, int lenx,
   const bool blendcolors = bargs->flags & NCVISUAL_OPTION_BLEND;
   int dimy, dimx, x, y;
   int total = 0; // number of cells written
+  nccell* cells[BLIT_BATCH]; // opaque cells awaiting the solver
+  uint32_t blocks[BLIT_BATCH][6];
+  unsigned pending = 0;
   ncplane_dim_yx(nc, &dimy, &dimx);
 //fprintf(stderr, "sexblitter %dx%d -> %d/%d+%d/%d\n", leny, lenx, dimy, dimx, bargs->u.cell.placey, bargs->u.cell.placex);
   const unsigned char* dat = data;
@@ -684,7 +473,8 @@ sextant_blit(ncplane* nc, int linesize, const void* data, int leny, int lenx,
     if(y < 0){
       continue;
     }
-    if(ncplane_cursor_move_yx(nc, y, bargs->u.cell.placex < 0 ? 0 : bargs->u.cell.placex)){
+    if(!bargs->u.cell.banded &&
+       ncplane_cursor_move_yx(nc, y, bargs->u.cell.placex < 0 ? 0 : bargs->u.cell.placex)){
       return -1;
     }
     int visx = bargs->begx;
@@ -710,23 +500,31 @@ sextant_blit(ncplane* nc, int linesize, const void* data, int leny, int lenx,
         }
       }
       nccell* c = ncplane_cell_ref_yx(nc, y, x);
+      if(c == NULL){
+        return -1;
+      }
       c->channels = 0;
       c->stylemask = 0;
       const char* egc = sex_trans_check(c, rgbas, blendcolors, bargs->transcolor, nointerpolate);
-      if(egc == NULL){ // no transparency; run a full solver
-        egc = sex_solver(rgbas, &c->channels, blendcolors, nointerpolate);
-        cell_set_blitquadrants(c, 1, 1, 1, 1);
+      if(egc == NULL){ // no transparency; queue it up for the solver
+        memcpy(blocks[pending], rgbas, sizeof(rgbas));
+        cells[pending++] = c;
+        if(pending == BLIT_BATCH){
+          sex_flush(nc, cells, blocks, pending, blendcolors, nointerpolate);
+          total += pending;
+          pending = 0;
+        }
+        continue;
       }
 //fprintf(stderr, "sex EGC: %s channels: %016lx\n", egc, c->channels);
       if(*egc){
-        if(pool_blit_direct(&nc->pool, c, egc, strlen(egc), 1) <= 0){
-          return -1;
-        }
+        pool_blit_packed(&nc->pool, c, egc);
         ++total;
       }
     }
   }
-  return total;
+  sex_flush(nc, cells, blocks, pending, blendcolors, nointerpolate);
+  return total + pending;
 }
 
 // fold the r, g, and b components of the pixel into *r, *g, and *b, and
@@ -740,6 +538,20 @@ fold_rgb8(unsigned* restrict r, unsigned* restrict g, unsigned* restrict b,
   ++*foldcount;
 }
 
+// UTF-8 encodings of the Braille Patterns are always 0xe2 0xaX 0xCC, where
+// 0 <= X <= 3 and 0x80 <= CC <= 0xbf (4 groups of 64), indexed by dot mask.
+#define BRAILLE1(i) { '\xe2', (char)(0xa0 + (i) / 64), (char)(0x80 + (i) % 64), '\0' }
+#define BRAILLE4(i) BRAILLE1(i), BRAILLE1((i) + 1), BRAILLE1((i) + 2), BRAILLE1((i) + 3)
+#define BRAILLE16(i) BRAILLE4(i), BRAILLE4((i) + 4), BRAILLE4((i) + 8), BRAILLE4((i) + 12)
+#define BRAILLE64(i) BRAILLE16(i), BRAILLE16((i) + 16), BRAILLE16((i) + 32), BRAILLE16((i) + 48)
+static const char braille_egcs[256][4] = {
+  BRAILLE64(0), BRAILLE64(64), BRAILLE64(128), BRAILLE64(192),
+};
+#undef BRAILLE64
+#undef BRAILLE16
+#undef BRAILLE4
+#undef BRAILLE1
+
 // Braille blitter. maps 4x2 to each cell. since we only have one color at
 // our disposal (foreground), we lose some fidelity. this is optimal for
 // visuals with only two colors in a given area, as it packs lots of
@@ -758,7 +570,8 @@ braille_blit(ncplane* nc, int linesize, const void* data, int leny, int lenx,
     if(y < 0){
       continue;
     }
-    if(ncplane_cursor_move_yx(nc, y, bargs->u.cell.placex < 0 ? 0 : bargs->u.cell.placex)){
+    if(!bargs->u.cell.banded &&
+       ncplane_cursor_move_yx(nc, y, bargs->u.cell.placex < 0 ? 0 : bargs->u.cell.placex)){
       return -1;
     }
     int visx = bargs->begx;
@@ -838,6 +651,9 @@ braille_blit(ncplane* nc, int linesize, const void* data, int leny, int lenx,
       }
 //fprintf(stderr, "[%04d/%04d] lsize: %d %02x %02x %02x %02x\n", y, x, linesize, rgbbase_up[0], rgbbase_up[1], rgbbase_up[2], rgbbase_up[3]);
       nccell* c = ncplane_cell_ref_yx(nc, y, x);
+      if(c == NULL){
+        return -1;
+      }
       // use the default for the background, as that's the only way it's
       // effective in that case anyway
       c->channels = 0;
@@ -854,16 +670,10 @@ braille_blit(ncplane* nc, int linesize, const void* data, int leny, int lenx,
           // FIXME else look for pairs of transparency!
       }else{
         if(blends){
-          nccell_set_fg_rgb8(c, r / blends, g / blends, b / blends);
-        }
-        // UTF-8 encodings of the Braille Patterns are always 0xe2 0xaX 0xCC,
-        // where 0 <= X <= 3 and 0x80 <= CC <= 0xbf (4 groups of 64).
-        char egc[4] = { 0xe2, 0xa0, 0x80, 0x00 };
-        egc[2] += egcidx % 64;
-        egc[1] += egcidx / 64;
-        if(pool_blit_direct(&nc->pool, c, egc, strlen(egc), 1) <= 0){
-          return -1;
+          nccell_set_fg_rgb8(c, blit_div(r, blends), blit_div(g, blends),
+                             blit_div(b, blends));
         }
+        pool_blit_packed(&nc->pool, c, braille_egcs[egcidx]);
       }
       ++total;
     }
@@ -989,6 +799,143 @@ const struct blitset* lookup_blitset(const tinfo* tcache, ncblitter_e setid,
   return &notcurses_blitters[setid - 1];
 }
 
+// a threaded blit gives each thread at least this many cell rows
+#define BLIT_BAND_MINROWS 8
+// and never uses more than this many threads
+#define BLIT_MAXTHREADS 16
+
+typedef struct blitband {
+  ncplane* nc;
+  ncblitter blit;
+  int linesize;
+  const void* data;
+  int leny, lenx;
+  blitterargs bargs;
+  int ret;          // result of the band's blit
+  pthread_t tid;
+} blitband;
+
+static void*
+blitband_thread(void* vband){
+  blitband* band = vband;
+  band->ret = band->blit(band->nc, band->linesize, band->data, band->leny,
+                         band->lenx, &band->bargs);
+  return NULL;
+}
+
+int blit_threadcount(int units, int minunits){
+  long cpus = 1;
+#ifdef _SC_NPROCESSORS_ONLN
+  cpus = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+  int threads = units / minunits;
+  if(threads > cpus){
+    threads = cpus;
+  }
+  if(threads > BLIT_MAXTHREADS){
+    threads = BLIT_MAXTHREADS;
+  }
+  return threads < 1 ? 1 : threads;
+}
+
+int blitset_cellheight(const struct blitset* bset){
+  // tria_blit() always takes two pixel rows per cell row
+  return bset->blit == tria_blit ? 2 : bset->height;
+}
+
+// every output row depends only on its own input rows, so we can hand each
+// thread a band of rows, expressed as a smaller blit. the blitters don't
+// otherwise share any state, save the egcpool, which they only touch when
+// replacing an extended EGC (all blitter EGCs fit within the cell). if any
+// such EGC is present in the output area, we blit with a single thread.
+int rgba_blit_threaded(ncplane* nc, const struct blitset* bset,
+                       int linesize, const void* data,
+                       int leny, int lenx, const blitterargs* bargs){
+  const int cellh = blitset_cellheight(bset);
+  const int cellw = bset->width;
+  const int placey = bargs->u.cell.placey;
+  const int placex = bargs->u.cell.placex;
+  int dimy, dimx;
+  ncplane_dim_yx(nc, &dimy, &dimx);
+  const int firsty = placey < 0 ? 0 : placey;
+  int lasty = placey + (leny + cellh - 1) / cellh; // exclusive
+  if(lasty > dimy){
+    lasty = dimy;
+  }
+  const int threads = blit_threadcount(lasty - firsty, BLIT_BAND_MINROWS);
+  if(threads < 2){
+    return bset->blit(nc, linesize, data, leny, lenx, bargs);
+  }
+  // this is where the serial blit would leave the cursor, and checks placex
+  if(ncplane_cursor_move_yx(nc, lasty - 1, placex < 0 ? 0 : placex)){
+    return -1;
+  }
+  const int firstx = placex < 0 ? 0 : placex;
+  int lastx = placex + (lenx + cellw - 1) / cellw;
+  if(lastx > dimx){
+    lastx = dimx;
+  }
+  // references to the rows also allocate any tiles, which the blitters'
+  // references mustn't do concurrently.
+  for(int y = firsty ; y < lasty ; ++y){
+    const nccell* row = ncplane_row_ref(nc, y);
+    if(row == NULL){
+      return -1;
+    }
+    for(int x = firstx ; x < lastx ; ++x){
+      if(cell_extended_p(&row[x])){
+        return bset->blit(nc, linesize, data, leny, lenx, bargs);
+      }
+    }
+  }
+  blitband bands[BLIT_MAXTHREADS];
+  const int rows = lasty - firsty;
+  for(int b = 0 ; b < threads ; ++b){
+    blitband* band = &bands[b];
+    const int y0 = firsty + rows * b / threads;
+    const int y1 = firsty + rows * (b + 1) / threads;
+    const int skip = (y0 - placey) * cellh; // input rows preceding the band
+    band->nc = nc;
+    band->blit = bset->blit;
+    band->linesize = linesize;
+    band->data = data;
+    band->leny = leny - skip;
+    if(band->leny > (y1 - y0) * cellh){
+      band->leny = (y1 - y0) * cellh;
+    }
+    band->lenx = lenx;
+    band->bargs = *bargs;
+    band->bargs.begy += skip;
+    band->bargs.leny = band->leny;
+    band->bargs.u.cell.placey = y0;
+    band->bargs.u.cell.banded = true;
+    band->ret = -1;
+  }
+  // we take the first band ourselves. if we can't launch a thread, run its
+  // band here, too.
+  bool launched[BLIT_MAXTHREADS] = { false };
+  for(int b = 1 ; b < threads ; ++b){
+    if(pthread_create(&bands[b].tid, NULL, blitband_thread, &bands[b]) == 0){
+      launched[b] = true;
+    }else{
+      blitband_thread(&bands[b]);
+    }
+  }
+  blitband_thread(&bands[0]);
+  int total = 0;
+  for(int b = 0 ; b < threads ; ++b){
+    if(launched[b]){
+      pthread_join(bands[b].tid, NULL);
+    }
+    if(bands[b].ret < 0){
+      total = -1;
+    }else if(total >= 0){
+      total += bands[b].ret;
+    }
+  }
+  return total;
+}
+
 int notcurses_lex_blitter(const char* op, ncblitter_e* blitfxn){
   const struct blitset* bset = notcurses_blitters;
   while(bset->name){
@@ -1100,7 +1047,7 @@ int ncblit_rgba(const void* data, int linesize, const struct ncvisual_options* v
       },
     },
   };
-  return bset->blit(nc, linesize, data, leny, lenx, &bargs);
+  return rgba_blit_dispatch(nc, bset, linesize, data, leny, lenx, &bargs);
 }
 
 ncblitter_e ncvisual_media_defblitter(const notcurses* nc, ncscale_e scale){
@@ -0,0 +1,629 @@
+#ifndef NOTCURSES_BLITSOLVE
+#define NOTCURSES_BLITSOLVE
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// internal header, not installed
+
+// color solvers for the quadrant and sextant blitters. the scalar solvers
+// handle a single block; the batch solvers handle any number of blocks, in
+// vector lanes where the compiler supports it, with results identical to the
+// scalar solvers. the tester checks the two against one another.
+
+#include "internal.h"
+
+// the reciprocals ceil(2^16 / n) for n of 1 through 8. (x * blit_recips[n]) >>
+// 16 is exactly x / n for any x less than 2^13, which covers any sum of eight
+// 8-bit channels (and its rounding term). this saves us a hardware divide by
+// a variable count for every lerp.
+static const uint32_t blit_recips[9] = {
+  0, 65536, 32768, 21846, 16384, 13108, 10923, 9363, 8192,
+};
+
+static inline unsigned
+blit_div(unsigned x, unsigned n){
+  return (x * blit_recips[n]) >> 16u;
+}
+
+// linearly interpolate a 24-bit RGB value along each 8-bit channel
+static inline uint32_t
+lerp(uint32_t c0, uint32_t c1, unsigned nointerpolate){
+  unsigned r0, g0, b0, r1, g1, b1;
+  uint32_t ret = 0;
+  ncchannel_rgb8(c0, &r0, &g0, &b0);
+  if(!nointerpolate){
+    ncchannel_rgb8(c1, &r1, &g1, &b1);
+    ncchannel_set_rgb8(&ret, (r0 + r1 + 1) >> 1u,
+                          (g0 + g1 + 1) >> 1u,
+                          (b0 + b1 + 1) >> 1u);
+  }else{
+    ncchannel_set_rgb8(&ret, r0, g0, b0);
+  }
+  return ret;
+}
+
+// linearly interpolate a 24-bit RGB value along each 8-bit channel
+static inline uint32_t
+trilerp(uint32_t c0, uint32_t c1, uint32_t c2, unsigned nointerpolate){
+  uint32_t ret = 0;
+  unsigned r0, g0, b0, r1, g1, b1, r2, g2, b2;
+  ncchannel_rgb8(c0, &r0, &g0, &b0);
+  if(!nointerpolate){
+    ncchannel_rgb8(c1, &r1, &g1, &b1);
+    ncchannel_rgb8(c2, &r2, &g2, &b2);
+    ncchannel_set_rgb8(&ret, blit_div(r0 + r1 + r2 + 2, 3),
+                          blit_div(g0 + g1 + g2 + 2, 3),
+                          blit_div(b0 + b1 + b2 + 2, 3));
+  }else{
+    ncchannel_set_rgb8(&ret, r0, g0, b0);
+  }
+  return ret;
+}
+
+// take a sum over channels, and the sample count, write back lerped channel
+static inline uint32_t
+generalerp(unsigned rsum, unsigned gsum, unsigned bsum, int count){
+  if(count == 0){
+    assert(0 == rsum);
+    assert(0 == gsum);
+    assert(0 == bsum);
+    return 0;
+  }
+  return NCCHANNEL_INITIALIZER(blit_div(rsum + (count - 1), count),
+                               blit_div(gsum + (count - 1), count),
+                               blit_div(bsum + (count - 1), count));
+}
+
+// once we find the closest pair of colors, we need look at the other two
+// colors, and determine whether either belongs with us rather with them.
+// if so, take the closer, and trilerp it in with us. otherwise, lerp the
+// two excluded pixels (and retain our original lerp).
+static const struct qdriver {
+  int pair[2];      // indices of contributing pair
+  int others[2];    // indices of excluded pair
+  const char* egc;  // EGC corresponding to contributing pair
+  const char* oth0egc; // EGC upon absorbing others[0]
+  const char* oth1egc; // EGC upon absorbing others[1]
+} quadrant_drivers[6] = {
+  // positional, as this header is included from c++
+  { { 0, 1 }, { 2, 3 }, "▀", "▛", "▜", },
+  { { 0, 2 }, { 1, 3 }, "▌", "▛", "▙", },
+  { { 0, 3 }, { 1, 2 }, "▚", "▜", "▙", },
+  { { 1, 2 }, { 0, 3 }, "▞", "▛", "▟", },
+  { { 1, 3 }, { 0, 2 }, "▐", "▜", "▟", },
+  { { 2, 3 }, { 0, 1 }, "▄", "▙", "▟", },
+};
+
+// get the six distances between four colors. diffs must be an array of
+// at least 6 uint32_t values.
+static inline void
+rgb_4diff(uint32_t* diffs, uint32_t tl, uint32_t tr, uint32_t bl, uint32_t br){
+  struct rgb {
+    unsigned r, g, b;
+  } colors[4];
+  ncchannel_rgb8(tl, &colors[0].r, &colors[0].g, &colors[0].b);
+  ncchannel_rgb8(tr, &colors[1].r, &colors[1].g, &colors[1].b);
+  ncchannel_rgb8(bl, &colors[2].r, &colors[2].g, &colors[2].b);
+  ncchannel_rgb8(br, &colors[3].r, &colors[3].g, &colors[3].b);
+  for(size_t idx = 0 ; idx < sizeof(quadrant_drivers) / sizeof(*quadrant_drivers) ; ++idx){
+    const struct qdriver* qd = quadrant_drivers + idx;
+    const struct rgb* rgb0 = colors + qd->pair[0];
+    const struct rgb* rgb1 = colors + qd->pair[1];
+    diffs[idx] = rgb_diff(rgb0->r, rgb0->g, rgb0->b,
+                          rgb1->r, rgb1->g, rgb1->b);
+  }
+}
+
+// solve for the EGC and two colors to best represent four colors at top
+// left, top right, bot left, bot right
+static inline const char*
+quadrant_solver(uint32_t tl, uint32_t tr, uint32_t bl, uint32_t br,
+                uint32_t* fore, uint32_t* back, unsigned nointerpolate){
+  const uint32_t colors[4] = { tl, tr, bl, br };
+//fprintf(stderr, "%08x/%08x/%08x/%08x\n", tl, tr, bl, br);
+  uint32_t diffs[sizeof(quadrant_drivers) / sizeof(*quadrant_drivers)];
+  rgb_4diff(diffs, tl, tr, bl, br);
+  // compiler can't verify that we'll always be less than 769 somewhere,
+  // so fuck it, just go ahead and initialize to 0 / diffs[0]
+  size_t mindiffidx = 0;
+  unsigned mindiff = diffs[0]; // 3 * 256 + 1; // max distance is 256 * 3
+  // if all diffs are 0, emit a space
+  bool allzerodiffs = (mindiff == 0);
+  for(size_t idx = 1 ; idx < sizeof(diffs) / sizeof(*diffs) ; ++idx){
+    if(diffs[idx] < mindiff){
+      mindiffidx = idx;
+      mindiff = diffs[idx];
+    }
+    if(diffs[idx]){
+      allzerodiffs = false;
+    }
+  }
+  if(allzerodiffs){
+    *fore = *back = tl;
+    return " ";
+  }
+  // at this point, 0 <= mindiffidx <= 5. foreground color will be the
+  // lerp of this nearest pair. we then check the other two. if they are
+  // closer to one another than either is to our lerp, lerp between them.
+  // otherwise, bring the closer one into our lerped fold.
+  const struct qdriver* qd = &quadrant_drivers[mindiffidx];
+  // the diff of the excluded pair is conveniently located at the inverse
+  // location within diffs[] viz mindiffidx.
+  // const uint32_t otherdiff = diffs[5 - mindiffidx];
+  *fore = lerp(colors[qd->pair[0]], colors[qd->pair[1]], nointerpolate);
+  *back = lerp(colors[qd->others[0]], colors[qd->others[1]], nointerpolate);
+//fprintf(stderr, "mindiff: %u[%zu] fore: %08x back: %08x %d+%d/%d+%d\n", mindiff, mindiffidx, *fore, *back, qd->pair[0], qd->pair[1], qd->others[0], qd->others[1]);
+  const char* egc = qd->egc;
+  // break down the excluded pair and lerp
+  unsigned r0, r1, r2, g0, g1, g2, b0, b1, b2;
+  unsigned roth, goth, both, rlerp, glerp, blerp;
+  ncchannel_rgb8(*back, &roth, &goth, &both);
+  ncchannel_rgb8(*fore, &rlerp, &glerp, &blerp);
+//fprintf(stderr, "rgbs: %02x %02x %02x / %02x %02x %02x\n", r0, g0, b0, r1, g1, b1);
+  // get diffs of the excluded two from both lerps
+  ncchannel_rgb8(colors[qd->others[0]], &r0, &g0, &b0);
+  ncchannel_rgb8(colors[qd->others[1]], &r1, &g1, &b1);
+  diffs[0] = rgb_diff(r0, g0, b0, roth, goth, both);
+  diffs[1] = rgb_diff(r1, g1, b1, roth, goth, both);
+  diffs[2] = rgb_diff(r0, g0, b0, rlerp, glerp, blerp);
+  diffs[3] = rgb_diff(r1, g1, b1, rlerp, glerp, blerp);
+  // get diffs of the included two from their lerp
+  ncchannel_rgb8(colors[qd->pair[0]], &r0, &g0, &b0);
+  ncchannel_rgb8(colors[qd->pair[1]], &r1, &g1, &b1);
+  diffs[4] = rgb_diff(r0, g0, b0, rlerp, glerp, blerp);
+  diffs[5] = rgb_diff(r1, g1, b1, rlerp, glerp, blerp);
+  unsigned curdiff = diffs[0] + diffs[1] + diffs[4] + diffs[5];
+  // it might be better to combine three, and leave one totally unchanged.
+  // propose a trilerps; we only need consider the member of the excluded pair
+  // closer to the primary lerp. recalculate total diff; merge if lower.
+  if(diffs[2] < diffs[3]){
+    unsigned tri = trilerp(colors[qd->pair[0]], colors[qd->pair[1]], colors[qd->others[0]],
+                           nointerpolate);
+    ncchannel_rgb8(colors[qd->others[0]], &r2, &g2, &b2);
+    ncchannel_rgb8(tri, &roth, &goth, &both);
+    if(rgb_diff(r0, g0, b0, roth, goth, both) +
+       rgb_diff(r1, g1, b1, roth, goth, both) +
+       rgb_diff(r2, g2, b2, roth, goth, both) < curdiff){
+      egc = qd->oth0egc;
+      *back = colors[qd->others[1]];
+      *fore = tri;
+    }
+//fprintf(stderr, "quadblitter swap type 1\n");
+  }else{
+    unsigned tri = trilerp(colors[qd->pair[0]], colors[qd->pair[1]], colors[qd->others[1]],
+                           nointerpolate);
+    ncchannel_rgb8(colors[qd->others[1]], &r2, &g2, &b2);
+    ncchannel_rgb8(tri, &roth, &goth, &both);
+    if(rgb_diff(r0, g0, b0, roth, goth, both) +
+       rgb_diff(r1, g1, b1, roth, goth, both) +
+       rgb_diff(r2, g2, b2, roth, goth, both) < curdiff){
+      egc = qd->oth1egc;
+      *back = colors[qd->others[0]];
+      *fore = tri;
+    }
+//fprintf(stderr, "quadblitter swap type 2\n");
+  }
+  return egc;
+}
+
+// sextant EGCs, indexed by the partition[] at the same index. each is padded
+// with NULs, so that it can be loaded into a cell with one four-byte copy.
+static const char sex_solver_egcs[32][5] = {
+  " ", "🬀", "🬁", "🬃", "🬇", "🬏", "🬞", "🬂", // 0..7
+  "🬄", "🬈", "🬐", "🬟", "🬅", "🬉", "🬑", "🬠", // 8..15
+  "🬋", "🬓", "🬢", "🬖", "🬦", "🬭", "🬆", "🬊", // 16..23
+  "🬒", "🬡", "🬌", "▌", "🬣", "🬗", "🬧", "🬍", // 24..31
+};
+
+// each element within the set of 64 has an inverse element within the set,
+// for which we would calculate the same total differences, so just handle
+// the first 32. the bit masks represent combinations of sextants, and their
+// indices correspond to sex_solver_egcs[].
+static const unsigned sex_solver_partitions[32] = {
+  0, // 1 way to arrange 0
+  1, 2, 4, 8, 16, 32, // 6 ways to arrange 1
+  3, 5, 9, 17, 33, 6, 10, 18, 34, 12, 20, 36, 24, 40, 48, // 15 ways for 2
+  //  16 ways to arrange 3, *but* six of them are inverses, so 10
+  7, 11, 19, 35, 13, 21, 37, 25, 41, 14 //  10 + 15 + 6 + 1 == 32
+};
+
+// Solve for the cell rendered by this 3x2 sample. None of the input pixels may
+// be transparent (that ought already have been handled). We use exhaustive
+// search, which might be quite computationally intensive for the worst case
+// (all six pixels are different colors). We want to solve for the 2-partition
+// of pixels that minimizes total source distance from the resulting lerps.
+// Returns the index into sex_solver_egcs[], writing the foreground and
+// background channels to '*l0' and '*l1'.
+static inline int
+sex_solver(const uint32_t rgbas[6], uint32_t* l0s, uint32_t* l1s,
+           unsigned nointerpolate){
+  // we loop over the bitstrings, dividing the pixels into two sets, and then
+  // taking a general lerp over each set. we then compute the sum of absolute
+  // differences, and see if it's the new minimum.
+  int best = -1;
+  uint32_t mindiff = UINT_MAX;
+  for(size_t glyph = 0 ; glyph < sizeof(sex_solver_partitions) / sizeof(*sex_solver_partitions) ; ++glyph){
+    const unsigned partition = sex_solver_partitions[glyph];
+    unsigned rsum0 = 0, rsum1 = 0;
+    unsigned gsum0 = 0, gsum1 = 0;
+    unsigned bsum0 = 0, bsum1 = 0;
+    int insum = 0;
+    int outsum = 0;
+    for(unsigned mask = 0 ; mask < 6 ; ++mask){
+      if(partition & (1u << mask)){
+        if(!nointerpolate || !insum){
+          rsum0 += ncpixel_r(rgbas[mask]);
+          gsum0 += ncpixel_g(rgbas[mask]);
+          bsum0 += ncpixel_b(rgbas[mask]);
+          ++insum;
+        }
+      }else{
+        if(!nointerpolate || !outsum){
+          rsum1 += ncpixel_r(rgbas[mask]);
+          gsum1 += ncpixel_g(rgbas[mask]);
+          bsum1 += ncpixel_b(rgbas[mask]);
+          ++outsum;
+        }
+      }
+    }
+    uint32_t l0 = generalerp(rsum0, gsum0, bsum0, insum);
+    uint32_t l1 = generalerp(rsum1, gsum1, bsum1, outsum);
+    uint32_t totaldiff = 0;
+    for(unsigned mask = 0 ; mask < 6 ; ++mask){
+      unsigned r, g, b;
+      if(partition & (1u << mask)){
+        ncchannel_rgb8(l0, &r, &g, &b);
+      }else{
+        ncchannel_rgb8(l1, &r, &g, &b);
+      }
+      uint32_t rdiff = rgb_diff(ncpixel_r(rgbas[mask]), ncpixel_g(rgbas[mask]),
+                                ncpixel_b(rgbas[mask]), r, g, b);
+      totaldiff += rdiff;
+    }
+    if(totaldiff < mindiff){
+      mindiff = totaldiff;
+      best = glyph;
+      *l0s = l0;
+      *l1s = l1;
+    }
+    if(totaldiff == 0){ // can't beat that!
+      break;
+    }
+  }
+  assert(best >= 0 && best < 32);
+  return best;
+}
+
+// quadrant batch results are an index into quadrant_drivers[] times three,
+// plus 0 for its egc, 1 for its oth0egc, or 2 for its oth1egc. an index of
+// QUADRANT_SOLVED_SPACE is a space, for which fore and back are equal.
+#define QUADRANT_SOLVED_SPACE 18
+
+// the EGCs of those results, padded like sex_solver_egcs[]
+static const char quadrant_solved_egcs[QUADRANT_SOLVED_SPACE + 1][5] = {
+  "▀", "▛", "▜",
+  "▌", "▛", "▙",
+  "▚", "▜", "▙",
+  "▞", "▛", "▟",
+  "▐", "▜", "▟",
+  "▄", "▙", "▟",
+  " ",
+};
+
+static inline const char*
+quadrant_solved_egc(uint8_t solved){
+  return quadrant_solved_egcs[solved];
+}
+
+#ifdef __GNUC__
+// solve BLIT_LANES blocks at once, one per lane. the partial sums involved
+// never exceed 16 bits, so 32-bit lanes are sufficient for the products used
+// to divide by small constants.
+#define BLIT_LANES 8
+typedef uint32_t blitvec __attribute__ ((vector_size (BLIT_LANES * sizeof(uint32_t))));
+#if defined(__x86_64__)
+#define BLIT_AVX2
+#endif
+// helpers are macros rather than functions, so that no vectors are passed or
+// returned by value (which would change calling conventions on pre-AVX
+// targets). scalar operands are broadcast to every lane.
+
+// lanes of 'a' where 'mask' is set, and 'b' elsewhere
+#define BLITVEC_SELECT(mask, a, b) (((a) & (mask)) | ((b) & ~(mask)))
+
+#define BLITVEC_ABSDIFF(a, b) BLITVEC_SELECT((blitvec)((a) > (b)), (a) - (b), (b) - (a))
+
+// rgb_diff() across lanes
+#define BLITVEC_RGBDIFF(r0, g0, b0, r1, g1, b1) \
+  (BLITVEC_ABSDIFF(r0, r1) + BLITVEC_ABSDIFF(g0, g1) + BLITVEC_ABSDIFF(b0, b1))
+
+// the rounded-up quotient (x + count - 1) / count, as blit_div()
+#define BLITVEC_DIVUP(x, count) \
+  ((((x) + ((count) - 1)) * blit_recips[count]) >> 16u)
+
+#define BLITVEC_CHANNEL(r, g, b) \
+  (((r) << 16u) | ((g) << 8u) | (b) | (uint32_t)NC_BGDEFAULT_MASK)
+
+// quadrant_solver() across BLIT_LANES blocks, each of (tl, tr, bl, br)
+// always inlined, so that each batch solver compiles it for its own target
+static inline __attribute__ ((always_inline)) void
+quadrant_solve_lanes(const uint32_t (*blocks)[4], uint8_t* solved,
+                     uint32_t* fores, uint32_t* backs, unsigned nointerpolate){
+  blitvec r[4], g[4], b[4];
+  for(int q = 0 ; q < 4 ; ++q){
+    for(int l = 0 ; l < BLIT_LANES ; ++l){
+      r[q][l] = (blocks[l][q] >> 16u) & 0xffu;
+      g[q][l] = (blocks[l][q] >> 8u) & 0xffu;
+      b[q][l] = blocks[l][q] & 0xffu;
+    }
+  }
+  // find the first closest pair, as rgb_4diff() and the scan following it
+  blitvec mindiff = { 0 }, minidx = { 0 }, anydiff = { 0 };
+  for(int d = 0 ; d < 6 ; ++d){
+    const struct qdriver* qd = &quadrant_drivers[d];
+    const int p0 = qd->pair[0], p1 = qd->pair[1];
+    const blitvec diff = BLITVEC_RGBDIFF(r[p0], g[p0], b[p0], r[p1], g[p1], b[p1]);
+    if(d == 0){
+      mindiff = diff;
+    }else{
+      const blitvec less = (blitvec)(diff < mindiff);
+      mindiff = BLITVEC_SELECT(less, diff, mindiff);
+      minidx = BLITVEC_SELECT(less, d, minidx);
+    }
+    anydiff |= diff;
+  }
+  // gather the included pair (a0, a1) and excluded pair (x0, x1) of each lane
+  blitvec ar[2] = { { 0 }, { 0 } }, ag[2] = { { 0 }, { 0 } }, ab[2] = { { 0 }, { 0 } };
+  blitvec xr[2] = { { 0 }, { 0 } }, xg[2] = { { 0 }, { 0 } }, xb[2] = { { 0 }, { 0 } };
+  for(int d = 0 ; d < 6 ; ++d){
+    const struct qdriver* qd = &quadrant_drivers[d];
+    const blitvec m = (blitvec)(minidx == d);
+    for(int i = 0 ; i < 2 ; ++i){
+      ar[i] = BLITVEC_SELECT(m, r[qd->pair[i]], ar[i]);
+      ag[i] = BLITVEC_SELECT(m, g[qd->pair[i]], ag[i]);
+      ab[i] = BLITVEC_SELECT(m, b[qd->pair[i]], ab[i]);
+      xr[i] = BLITVEC_SELECT(m, r[qd->others[i]], xr[i]);
+      xg[i] = BLITVEC_SELECT(m, g[qd->others[i]], xg[i]);
+      xb[i] = BLITVEC_SELECT(m, b[qd->others[i]], xb[i]);
+    }
+  }
+  // lerp each pair
+  blitvec fr = ar[0], fg = ag[0], fb = ab[0];
+  blitvec br = xr[0], bg = xg[0], bb = xb[0];
+  if(!nointerpolate){
+    fr = (ar[0] + ar[1] + 1) >> 1u;
+    fg = (ag[0] + ag[1] + 1) >> 1u;
+    fb = (ab[0] + ab[1] + 1) >> 1u;
+    br = (xr[0] + xr[1] + 1) >> 1u;
+    bg = (xg[0] + xg[1] + 1) >> 1u;
+    bb = (xb[0] + xb[1] + 1) >> 1u;
+  }
+  const blitvec curdiff = BLITVEC_RGBDIFF(xr[0], xg[0], xb[0], br, bg, bb) +
+                          BLITVEC_RGBDIFF(xr[1], xg[1], xb[1], br, bg, bb) +
+                          BLITVEC_RGBDIFF(ar[0], ag[0], ab[0], fr, fg, fb) +
+                          BLITVEC_RGBDIFF(ar[1], ag[1], ab[1], fr, fg, fb);
+  // propose absorbing whichever excluded member is closer to our lerp
+  const blitvec first = (blitvec)(BLITVEC_RGBDIFF(xr[0], xg[0], xb[0], fr, fg, fb) <
+                                  BLITVEC_RGBDIFF(xr[1], xg[1], xb[1], fr, fg, fb));
+  const blitvec abr = BLITVEC_SELECT(first, xr[0], xr[1]);
+  const blitvec abg = BLITVEC_SELECT(first, xg[0], xg[1]);
+  const blitvec abb = BLITVEC_SELECT(first, xb[0], xb[1]);
+  blitvec tr = ar[0], tg = ag[0], tb = ab[0];
+  if(!nointerpolate){
+    tr = BLITVEC_DIVUP(ar[0] + ar[1] + abr, 3);
+    tg = BLITVEC_DIVUP(ag[0] + ag[1] + abg, 3);
+    tb = BLITVEC_DIVUP(ab[0] + ab[1] + abb, 3);
+  }
+  const blitvec tridiff = BLITVEC_RGBDIFF(ar[0], ag[0], ab[0], tr, tg, tb) +
+                          BLITVEC_RGBDIFF(ar[1], ag[1], ab[1], tr, tg, tb) +
+                          BLITVEC_RGBDIFF(abr, abg, abb, tr, tg, tb);
+  const blitvec swap = (blitvec)(tridiff < curdiff);
+  blitvec fore = BLITVEC_CHANNEL(fr, fg, fb);
+  blitvec back = BLITVEC_CHANNEL(br, bg, bb);
+  fore = BLITVEC_SELECT(swap, BLITVEC_CHANNEL(tr, tg, tb), fore);
+  back = BLITVEC_SELECT(swap, BLITVEC_CHANNEL(BLITVEC_SELECT(first, xr[1], xr[0]),
+                                              BLITVEC_SELECT(first, xg[1], xg[0]),
+                                              BLITVEC_SELECT(first, xb[1], xb[0])), back);
+  blitvec variant = BLITVEC_SELECT(swap, BLITVEC_SELECT(first, 1, 2),
+                                   0);
+  blitvec result = minidx * 3 + variant;
+  // if all diffs are 0, emit a space in the top left color
+  const blitvec space = (blitvec)(anydiff == 0);
+  const blitvec tl = BLITVEC_CHANNEL(r[0], g[0], b[0]);
+  fore = BLITVEC_SELECT(space, tl, fore);
+  back = BLITVEC_SELECT(space, tl, back);
+  result = BLITVEC_SELECT(space, QUADRANT_SOLVED_SPACE, result);
+  for(int l = 0 ; l < BLIT_LANES ; ++l){
+    solved[l] = result[l];
+    fores[l] = fore[l];
+    backs[l] = back[l];
+  }
+}
+
+// sex_solver() across BLIT_LANES blocks, each of six RGBA pixels
+static inline __attribute__ ((always_inline)) void
+sex_solve_lanes(const uint32_t (*blocks)[6], uint8_t* solved,
+                uint32_t* l0s, uint32_t* l1s, unsigned nointerpolate){
+  blitvec r[6], g[6], b[6];
+  for(int p = 0 ; p < 6 ; ++p){
+    for(int l = 0 ; l < BLIT_LANES ; ++l){
+      r[p][l] = ncpixel_r(blocks[l][p]);
+      g[p][l] = ncpixel_g(blocks[l][p]);
+      b[p][l] = ncpixel_b(blocks[l][p]);
+    }
+  }
+  blitvec mindiff = { 0 };
+  mindiff = ~mindiff;
+  blitvec best = { 0 }, best0 = { 0 }, best1 = { 0 };
+  for(unsigned glyph = 0 ; glyph < 32 ; ++glyph){
+    const unsigned partition = sex_solver_partitions[glyph];
+    // the partition is the same in every lane, so we can branch on it
+    blitvec rs0 = { 0 }, gs0 = { 0 }, bs0 = { 0 };
+    blitvec rs1 = { 0 }, gs1 = { 0 }, bs1 = { 0 };
+    unsigned insum = 0, outsum = 0;
+    for(unsigned p = 0 ; p < 6 ; ++p){
+      if(partition & (1u << p)){
+        if(!nointerpolate || !insum){
+          rs0 += r[p];
+          gs0 += g[p];
+          bs0 += b[p];
+          ++insum;
+        }
+      }else if(!nointerpolate || !outsum){
+        rs1 += r[p];
+        gs1 += g[p];
+        bs1 += b[p];
+        ++outsum;
+      }
+    }
+    // generalerp() of an empty set is 0, not a color
+    blitvec l0r = { 0 }, l0g = { 0 }, l0b = { 0 }, l0 = { 0 };
+    blitvec l1r = { 0 }, l1g = { 0 }, l1b = { 0 }, l1 = { 0 };
+    if(insum){
+      l0r = BLITVEC_DIVUP(rs0, insum);
+      l0g = BLITVEC_DIVUP(gs0, insum);
+      l0b = BLITVEC_DIVUP(bs0, insum);
+      l0 = BLITVEC_CHANNEL(l0r, l0g, l0b);
+    }
+    if(outsum){
+      l1r = BLITVEC_DIVUP(rs1, outsum);
+      l1g = BLITVEC_DIVUP(gs1, outsum);
+      l1b = BLITVEC_DIVUP(bs1, outsum);
+      l1 = BLITVEC_CHANNEL(l1r, l1g, l1b);
+    }
+    blitvec totaldiff = { 0 };
+    for(unsigned p = 0 ; p < 6 ; ++p){
+      if(partition & (1u << p)){
+        totaldiff += BLITVEC_RGBDIFF(r[p], g[p], b[p], l0r, l0g, l0b);
+      }else{
+        totaldiff += BLITVEC_RGBDIFF(r[p], g[p], b[p], l1r, l1g, l1b);
+      }
+    }
+    const blitvec less = (blitvec)(totaldiff < mindiff);
+    mindiff = BLITVEC_SELECT(less, totaldiff, mindiff);
+    best = BLITVEC_SELECT(less, glyph, best);
+    best0 = BLITVEC_SELECT(less, l0, best0);
+    best1 = BLITVEC_SELECT(less, l1, best1);
+    // nothing beats 0 in every lane
+    uint32_t anydiff = 0;
+    for(int l = 0 ; l < BLIT_LANES ; ++l){
+      anydiff |= mindiff[l];
+    }
+    if(anydiff == 0){
+      break;
+    }
+  }
+  for(int l = 0 ; l < BLIT_LANES ; ++l){
+    solved[l] = best[l];
+    l0s[l] = best0[l];
+    l1s[l] = best1[l];
+  }
+}
+
+// run a lane solver over 'count' blocks, padding out any partial set of
+// lanes with black blocks.
+#define BLIT_SOLVE_BATCH(lanefxn, pixels, blocks, count, solved, c0s, c1s, nointerpolate) \
+  do{ \
+    unsigned i_; \
+    for(i_ = 0 ; i_ + BLIT_LANES <= (count) ; i_ += BLIT_LANES){ \
+      lanefxn((blocks) + i_, (solved) + i_, (c0s) + i_, (c1s) + i_, (nointerpolate)); \
+    } \
+    if(i_ < (count)){ \
+      uint32_t pad_[BLIT_LANES][pixels]; \
+      uint8_t psolved_[BLIT_LANES]; \
+      uint32_t pc0s_[BLIT_LANES], pc1s_[BLIT_LANES]; \
+      memset(pad_, 0, sizeof(pad_)); \
+      memcpy(pad_, (blocks) + i_, sizeof(*pad_) * ((count) - i_)); \
+      lanefxn((const uint32_t (*)[pixels])pad_, psolved_, pc0s_, pc1s_, (nointerpolate)); \
+      memcpy((solved) + i_, psolved_, sizeof(*psolved_) * ((count) - i_)); \
+      memcpy((c0s) + i_, pc0s_, sizeof(*pc0s_) * ((count) - i_)); \
+      memcpy((c1s) + i_, pc1s_, sizeof(*pc1s_) * ((count) - i_)); \
+    } \
+  }while(0)
+
+// the same lane solvers, compiled for the baseline target (SSE2 on x86-64,
+// NEON on aarch64) and, where we can detect it at runtime, for AVX2.
+static void
+quadrant_solve_vec(const uint32_t (*blocks)[4], unsigned count, uint8_t* solved,
+                   uint32_t* fores, uint32_t* backs, unsigned nointerpolate){
+  BLIT_SOLVE_BATCH(quadrant_solve_lanes, 4, blocks, count, solved, fores, backs, nointerpolate);
+}
+
+static void
+sex_solve_vec(const uint32_t (*blocks)[6], unsigned count, uint8_t* solved,
+              uint32_t* l0s, uint32_t* l1s, unsigned nointerpolate){
+  BLIT_SOLVE_BATCH(sex_solve_lanes, 6, blocks, count, solved, l0s, l1s, nointerpolate);
+}
+
+#ifdef BLIT_AVX2
+__attribute__ ((target ("avx2"))) static void
+quadrant_solve_avx2(const uint32_t (*blocks)[4], unsigned count, uint8_t* solved,
+                    uint32_t* fores, uint32_t* backs, unsigned nointerpolate){
+  BLIT_SOLVE_BATCH(quadrant_solve_lanes, 4, blocks, count, solved, fores, backs, nointerpolate);
+}
+
+__attribute__ ((target ("avx2"))) static void
+sex_solve_avx2(const uint32_t (*blocks)[6], unsigned count, uint8_t* solved,
+               uint32_t* l0s, uint32_t* l1s, unsigned nointerpolate){
+  BLIT_SOLVE_BATCH(sex_solve_lanes, 6, blocks, count, solved, l0s, l1s, nointerpolate);
+}
+
+static inline bool
+blit_avx2_p(void){
+  return __builtin_cpu_supports("avx2");
+}
+#endif
+#endif
+
+// solve 'count' quadrant blocks, each of four 24-bit channels (tl, tr, bl,
+// br), writing the results as described for QUADRANT_SOLVED_SPACE, and the
+// foreground and background channels.
+static inline void
+quadrant_solve_batch(const uint32_t (*blocks)[4], unsigned count, uint8_t* solved,
+                     uint32_t* fores, uint32_t* backs, unsigned nointerpolate){
+#ifdef __GNUC__
+#ifdef BLIT_AVX2
+  if(blit_avx2_p()){
+    quadrant_solve_avx2(blocks, count, solved, fores, backs, nointerpolate);
+    return;
+  }
+#endif
+  quadrant_solve_vec(blocks, count, solved, fores, backs, nointerpolate);
+#else
+  for(unsigned i = 0 ; i < count ; ++i){
+    const char* egc = quadrant_solver(blocks[i][0], blocks[i][1], blocks[i][2],
+                                      blocks[i][3], &fores[i], &backs[i],
+                                      nointerpolate);
+    for(solved[i] = 0 ; strcmp(quadrant_solved_egc(solved[i]), egc) ; ++solved[i]){
+    }
+  }
+#endif
+}
+
+// solve 'count' sextant blocks, each of six RGBA pixels, writing indices into
+// sex_solver_egcs[], and the foreground and background channels.
+static inline void
+sex_solve_batch(const uint32_t (*blocks)[6], unsigned count, uint8_t* solved,
+                uint32_t* l0s, uint32_t* l1s, unsigned nointerpolate){
+#ifdef __GNUC__
+#ifdef BLIT_AVX2
+  if(blit_avx2_p()){
+    sex_solve_avx2(blocks, count, solved, l0s, l1s, nointerpolate);
+    return;
+  }
+#endif
+  sex_solve_vec(blocks, count, solved, l0s, l1s, nointerpolate);
+#else
+  for(unsigned i = 0 ; i < count ; ++i){
+    solved[i] = sex_solver(blocks[i], &l0s[i], &l1s[i], nointerpolate);
+  }
+#endif
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
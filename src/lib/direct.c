@@ -742,6 +742,9 @@ ncdirect_render_visual(ncdirect* n, ncvisual* ncv,
   }
   if(bset->geom == NCBLIT_PIXEL){
     bargs.u.pixel.colorregs = n->tcache.color_registers;
+    bargs.u.pixel.budget = ncv->pxbudget;
+    bargs.u.pixel.budgetregs = &ncv->sixelregs;
+    bargs.u.pixel.kittymedium = n->tcache.kittymedium;
     if((bargs.u.pixel.spx = sprixel_alloc(&n->tcache, ncdv, nopts.rows, nopts.cols)) == NULL){
       free_plane(ncdv);
       return NULL;
@@ -883,7 +886,7 @@ ncdirect* ncdirect_core_init(const char* termtype, FILE* outfp, uint64_t flags){
   if(outfp == NULL){
     outfp = stdout;
   }
-  if(flags > (NCDIRECT_OPTION_VERY_VERBOSE << 1)){ // allow them through with warning
+  if(flags > (NCDIRECT_OPTION_NO_KITTY_SHM << 1)){ // allow them through with warning
     logwarn("Passed unsupported flags 0x%016jx\n", (uintmax_t)flags);
   }
   ncdirect* ret = malloc(sizeof(ncdirect));
@@ -919,7 +922,9 @@ ncdirect* ncdirect_core_init(const char* termtype, FILE* outfp, uint64_t flags){
   int cursor_x = -1;
   if(interrogate_terminfo(&ret->tcache, termtype, ret->ttyfp, utf8,
                           1, flags & NCDIRECT_OPTION_INHIBIT_CBREAK,
-                          TERMINAL_UNKNOWN, &cursor_y, &cursor_x, NULL)){
+                          TERMINAL_UNKNOWN,
+                          flags & NCDIRECT_OPTION_NO_KITTY_SHM,
+                          &cursor_y, &cursor_x, NULL)){
     goto err;
   }
   if(cursor_y >= 0){
@@ -1422,7 +1427,7 @@ int ncdirect_stream(ncdirect* n, const char* filename, ncstreamcb streamer,
       if(n->tcache.pixel_remove){
         fbuf f = {};
         fbuf_init_small(&f);
-        if(n->tcache.pixel_remove(lastid, &f) || fwrite(f.buf, f.used, 1, n->ttyfp) != 1){
+        if(n->tcache.pixel_remove(lastid, lastid, &f) || fwrite(f.buf, f.used, 1, n->ttyfp) != 1){
           fbuf_free(&f);
           ncvisual_destroy(ncv);
           return -1;
@@ -82,8 +82,44 @@ utf8_codepoint_length(unsigned char c){
   }
 }
 
+// two-level table of per-codepoint properties, indexed by the codepoint's
+// page (its high bits) and then its offset within the page. each entry holds
+// wcwidth() + 1 in its low two bits (0 is a prohibited or invalid codepoint),
+// and a reduced grapheme break class in the next two bits. pages are built
+// lazily from wcwidth() and libunistring, so results match direct calls.
+#define UCS_PAGESIZE 256u
+#define UCS_PAGECOUNT (0x110000u / UCS_PAGESIZE)
+#define UCS_GB_SHIFT 2u
+#define UCS_GB_OTHER 0u   // breaks on both sides unless a neighbor forbids it
+#define UCS_GB_EXTEND 1u  // Extend, ZWJ, SpacingMark: never break before
+#define UCS_GB_PREPEND 2u // Prepend: never break after
+#define UCS_GB_COMPLEX 3u // anything else: ask uc_is_grapheme_break()
+
+extern const uint8_t* ucs_pages[UCS_PAGECOUNT];
+
+// build and publish the page, returning it. returns NULL if the page can't
+// (or oughtn't yet) be built, in which case callers use the slow path.
+const uint8_t* ucs_page_populate(uint32_t page);
+
+// look up the table entry for 'wc', or return -1 if it isn't available.
+static inline int
+ucs_props(wchar_t wc){
+  uint32_t u = (uint32_t)wc;
+  if(u >= 0x110000u){
+    return -1;
+  }
+  const uint8_t* page = __atomic_load_n(&ucs_pages[u / UCS_PAGESIZE], __ATOMIC_ACQUIRE);
+  if(page == NULL){
+    if((page = ucs_page_populate(u / UCS_PAGESIZE)) == NULL){
+      return -1;
+    }
+  }
+  return page[u % UCS_PAGESIZE];
+}
+
 // Eat an EGC from the UTF-8 string input, counting bytes and columns. We use
-// libunistring's uc_is_grapheme_break() to segment EGCs. Writes the number of
+// the property table (falling back to libunistring's uc_is_grapheme_break()
+// and wcwidth()) to segment EGCs. Writes the number of
 // columns to '*colcount'. Returns the number of bytes consumed, not including
 // any NUL terminator. Neither the number of bytes nor columns is necessarily
 // equal to the number of decoded code points. Such are the ways of Unicode.
@@ -97,6 +133,7 @@ utf8_egc_len(const char* gcluster, int* colcount){
   mbstate_t mbt;
   memset(&mbt, 0, sizeof(mbt));
   wchar_t wc, prevw = 0;
+  int prevprops = -1;
   bool injoin = false;
   do{
     r = mbrtowc(&wc, gcluster, MB_CUR_MAX, &mbt);
@@ -105,10 +142,27 @@ utf8_egc_len(const char* gcluster, int* colcount){
       logerror("Invalid UTF8: %s\n", gcluster);
       return -1;
     }
-    if(prevw && !injoin && uc_is_grapheme_break(prevw, wc)){
-      break; // starts a new EGC, exit and do not claim
+    // prefer the property table, deciding the common cases (GB9, GB9a, GB9b,
+    // and GB999) from the classes alone.
+    int props = ucs_props(wc);
+    if(prevw && !injoin){
+      bool brk;
+      if(props < 0 || prevprops < 0){
+        brk = uc_is_grapheme_break(prevw, wc);
+      }else{
+        unsigned pclass = (unsigned)prevprops >> UCS_GB_SHIFT;
+        unsigned cclass = (unsigned)props >> UCS_GB_SHIFT;
+        if(pclass == UCS_GB_COMPLEX || cclass == UCS_GB_COMPLEX){
+          brk = uc_is_grapheme_break(prevw, wc);
+        }else{
+          brk = pclass != UCS_GB_PREPEND && cclass != UCS_GB_EXTEND;
+        }
+      }
+      if(brk){
+        break; // starts a new EGC, exit and do not claim
+      }
     }
-    int cols = wcwidth(wc);
+    int cols = props < 0 ? wcwidth(wc) : (props & 0x3) - 1;
     if(cols < 0){
       if(iswspace(wc)){ // newline or tab
         return ret + 1;
@@ -121,6 +175,7 @@ utf8_egc_len(const char* gcluster, int* colcount){
     ret += r;
     gcluster += r;
     prevw = wc;
+    prevprops = props;
   }while(r);
   return ret;
 }
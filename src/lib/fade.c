@@ -35,7 +35,7 @@ alloc_ncplane_palette(ncplane* n, ncfadectx* pp, const struct timespec* ts){
   int y, x;
   for(y = 0 ; y < pp->rows ; ++y){
     for(x = 0 ; x < pp->cols ; ++x){
-      channels = n->fb[nfbcellidx(n, y, x)].channels;
+      channels = ncplane_cell_peek_yx(n, y, x)->channels;
       pp->channels[y * pp->cols + x] = channels;
       ncchannels_fg_rgb8(channels, &r, &g, &b);
       if(r > pp->maxr){
@@ -114,12 +114,17 @@ int ncplane_fadein_iteration(ncplane* n, ncfadectx* nctx, int iter,
   int dimy, dimx;
   ncplane_dim_yx(n, &dimy, &dimx);
   for(y = 0 ; y < nctx->rows && y < dimy ; ++y){
+    // unallocated tiles hold only default colors, which we don't fade
+    nccell* row = ncplane_row_peek(n, y);
+    if(row == NULL){
+      continue;
+    }
     for(x = 0 ; x < nctx->cols && x < dimx; ++x){
       unsigned r, g, b;
       ncchannels_fg_rgb8(nctx->channels[nctx->cols * y + x], &r, &g, &b);
       unsigned br, bg, bb;
       ncchannels_bg_rgb8(nctx->channels[nctx->cols * y + x], &br, &bg, &bb);
-      nccell* c = &n->fb[dimx * y + x];
+      nccell* c = &row[x];
       if(!nccell_fg_default_p(c)){
         r = r * iter / nctx->maxsteps;
         g = g * iter / nctx->maxsteps;
@@ -181,8 +186,13 @@ int ncplane_fadeout_iteration(ncplane* n, ncfadectx* nctx, int iter,
   int dimy, dimx;
   ncplane_dim_yx(n, &dimy, &dimx);
   for(y = 0 ; y < nctx->rows && y < dimy ; ++y){
+    // unallocated tiles hold only default colors, which we don't fade
+    nccell* row = ncplane_row_peek(n, y);
+    if(row == NULL){
+      continue;
+    }
     for(x = 0 ; x < nctx->cols && x < dimx; ++x){
-      nccell* c = &n->fb[dimx * y + x];
+      nccell* c = &row[x];
       if(!nccell_fg_default_p(c)){
         ncchannels_fg_rgb8(nctx->channels[nctx->cols * y + x], &r, &g, &b);
         r = r * (nctx->maxsteps - iter) / nctx->maxsteps;
@@ -2,8 +2,13 @@
 
 void ncplane_greyscale(ncplane *n){
   for(int y = 0 ; y < n->leny ; ++y){
+    // unallocated tiles hold only default colors, which we leave alone
+    nccell* row = ncplane_row_peek(n, y);
+    if(row == NULL){
+      continue;
+    }
     for(int x = 0 ; x < n->lenx ; ++x){
-      nccell* c = &n->fb[nfbcellidx(n, y, x)];
+      nccell* c = &row[x];
       unsigned r, g, b;
       nccell_fg_rgb8(c, &r, &g, &b);
       int gy = rgb_greyscale(r, g, b);
@@ -27,13 +32,13 @@ ncplane_polyfill_recurse(ncplane* n, int y, int x, const nccell* c, const char*
   if(y < 0 || x < 0){
     return 0; // not fillable
   }
-  nccell* cur = &n->fb[nfbcellidx(n, y, x)];
-  const char* glust = nccell_extended_gcluster(n, cur);
+  const char* glust = nccell_extended_gcluster(n, ncplane_cell_peek_yx(n, y, x));
 //fprintf(stderr, "checking %d/%d (%s) for [%s]\n", y, x, glust, filltarg);
   if(strcmp(glust, filltarg)){
     return 0;
   }
-  if(nccell_duplicate(n, cur, c) < 0){
+  nccell* cur = ncplane_cell_ref_yx(n, y, x);
+  if(cur == NULL || nccell_duplicate(n, cur, c) < 0){
     return -1;
   }
   int r, ret = 1;
@@ -68,7 +73,7 @@ int ncplane_polyfill_yx(ncplane* n, int y, int x, const nccell* c){
       if(y < 0 || x < 0){
         return -1; // not fillable
       }
-      const nccell* cur = &n->fb[nfbcellidx(n, y, x)];
+      const nccell* cur = ncplane_cell_peek_yx(n, y, x);
       const char* targ = nccell_extended_gcluster(n, cur);
       const char* fillegc = nccell_extended_gcluster(n, c);
 //fprintf(stderr, "checking %d/%d (%s) for [%s]\n", y, x, targ, fillegc);
@@ -178,6 +183,9 @@ int ncplane_highgradient(ncplane* n, uint32_t ul, uint32_t ur,
   for(int y = yoff ; y <= ystop ; ++y){
     for(int x = xoff ; x <= xstop ; ++x){
       nccell* targc = ncplane_cell_ref_yx(n, y, x);
+      if(targc == NULL){
+        return -1;
+      }
       targc->channels = 0;
       if(pool_blit_direct(&n->pool, targc, "▀", strlen("▀"), 1) <= 0){
         return -1;
@@ -251,6 +259,9 @@ int ncplane_gradient(ncplane* n, const char* egc, uint32_t stylemask,
   for(int y = yoff ; y <= ystop ; ++y){
     for(int x = xoff ; x <= xstop ; ++x){
       nccell* targc = ncplane_cell_ref_yx(n, y, x);
+      if(targc == NULL){
+        return -1;
+      }
       targc->channels = 0;
       if(nccell_load(n, targc, egc) < 0){
         return -1;
@@ -292,8 +303,9 @@ int ncplane_stain(ncplane* n, int ystop, int xstop,
   int total = 0;
   for(int y = yoff ; y <= ystop ; ++y){
     for(int x = xoff ; x <= xstop ; ++x){
-      nccell* targc = ncplane_cell_ref_yx(n, y, x);
-      if(targc->gcluster){
+      // unallocated tiles have no glyphs to stain
+      nccell* targc = ncplane_row_peek(n, y);
+      if(targc && (targc += x)->gcluster){
         calc_gradient_channels(&targc->channels, tl, tr, bl, br,
                                y - yoff, x - xoff, ylen, xlen);
       }
@@ -322,6 +334,9 @@ int ncplane_format(ncplane* n, int ystop, int xstop, uint32_t stylemask){
   for(int y = yoff ; y < ystop + 1 ; ++y){
     for(int x = xoff ; x < xstop + 1 ; ++x){
       nccell* targc = ncplane_cell_ref_yx(n, y, x);
+      if(targc == NULL){
+        return -1;
+      }
       targc->stylemask = stylemask;
       ++total;
     }
@@ -465,9 +480,9 @@ rotate_merge(ncplane* n, ncplane* newp){
   if(ret == 0){
     for(int y = 0 ; y < dimy ; ++y){
       for(int x = 0 ; x < dimx ; ++x){
-        const nccell* src = &newp->fb[fbcellidx(y, dimx, x)];
-        nccell* targ = &n->fb[fbcellidx(y, dimx, x)];
-        if(cell_duplicate_far(&n->pool, targ, newp, src) < 0){
+        const nccell* src = ncplane_cell_peek_yx(newp, y, x);
+        nccell* targ = ncplane_cell_ref_yx(n, y, x);
+        if(targ == NULL || cell_duplicate_far(&n->pool, targ, newp, src) < 0){
           return -1;
         }
       }
@@ -0,0 +1,267 @@
+#include <fcntl.h>
+#include <unistd.h>
+#ifndef __MINGW64__
+#include <sys/mman.h>
+#endif
+#include "internal.h"
+
+// header of each row record in the history file
+typedef struct histrow {
+  uint32_t cols;     // cells in the record, 0 for a blank row
+  uint32_t egcbytes; // bytes of EGC tail following the cells
+} histrow;
+
+// records are padded out to this alignment, so that the header and cells of
+// every record can be read in place from the mapping.
+#define HISTORY_ALIGN 8u
+// the backing file is grown by at least this much at a time
+#define HISTORY_MINGROW (1u << 20u)
+
+#ifndef __MINGW64__
+// ensure at least 'len' bytes past 'used' are mapped, growing the file (and
+// remapping it) if necessary.
+static int
+history_reserve(nchistory* h, size_t len){
+  if(h->used + len <= h->maplen){
+    return 0;
+  }
+  size_t newlen = h->maplen * 2;
+  if(newlen < h->used + len){
+    newlen = h->used + len;
+  }
+  if(newlen < HISTORY_MINGROW){
+    newlen = HISTORY_MINGROW;
+  }
+  if(ftruncate(h->fd, newlen)){
+    logerror("Couldn't grow history to %zuB (%s)\n", newlen, strerror(errno));
+    return -1;
+  }
+  char* map = mmap(NULL, newlen, PROT_READ | PROT_WRITE, MAP_SHARED, h->fd, 0);
+  if(map == MAP_FAILED){
+    logerror("Couldn't map %zuB of history (%s)\n", newlen, strerror(errno));
+    return -1;
+  }
+  if(h->map){
+    munmap(h->map, h->maplen);
+  }
+  h->map = map;
+  h->maplen = newlen;
+  return 0;
+}
+
+static int
+history_index(nchistory* h, uint64_t offset){
+  if(h->rowcount == INT_MAX){
+    return -1;
+  }
+  if(h->rowcount == h->rowalloc){
+    unsigned newalloc = h->rowalloc ? h->rowalloc * 2 : 1024;
+    uint64_t* tmp = realloc(h->rows, sizeof(*tmp) * newalloc);
+    if(tmp == NULL){
+      return -1;
+    }
+    h->rows = tmp;
+    h->rowalloc = newalloc;
+  }
+  h->rows[h->rowcount++] = offset;
+  return 0;
+}
+
+// write logical row 'y' of 'n' (or a blank row, if 'y' is negative) as a new
+// record at the end of the history.
+static int
+history_append_row(ncplane* n, int y){
+  nchistory* h = n->history;
+  const nccell* row = y >= 0 ? ncplane_row_peek(n, y) : NULL;
+  histrow hr = { .cols = 0, .egcbytes = 0, };
+  if(row){
+    hr.cols = n->lenx;
+    for(int x = 0 ; x < n->lenx ; ++x){
+      if(cell_extended_p(&row[x])){
+        hr.egcbytes += strlen(nccell_extended_gcluster(n, &row[x])) + 1;
+      }
+    }
+  }
+  size_t len = sizeof(hr) + sizeof(*row) * hr.cols + hr.egcbytes;
+  len = (len + HISTORY_ALIGN - 1) / HISTORY_ALIGN * HISTORY_ALIGN;
+  if(history_reserve(h, len)){
+    return -1;
+  }
+  char* rec = h->map + h->used;
+  memcpy(rec, &hr, sizeof(hr));
+  nccell* cells = (nccell*)(rec + sizeof(hr));
+  char* tail = rec + sizeof(hr) + sizeof(*row) * hr.cols;
+  uint32_t egcoff = 0;
+  for(unsigned x = 0 ; x < hr.cols ; ++x){
+    cells[x] = row[x];
+    if(cell_extended_p(&row[x])){
+      const char* egc = nccell_extended_gcluster(n, &row[x]);
+      size_t elen = strlen(egc) + 1;
+      memcpy(tail + egcoff, egc, elen);
+      set_gcluster_egc(&cells[x], egcoff);
+      egcoff += elen;
+    }
+  }
+  if(history_index(h, h->used)){
+    return -1;
+  }
+  h->used += len;
+  return 0;
+}
+
+int nchistory_append(ncplane* n, int rows){
+  for(int y = 0 ; y < rows ; ++y){
+    if(history_append_row(n, y < n->leny ? y : -1)){
+      return -1;
+    }
+  }
+  return 0;
+}
+
+void nchistory_drop_view(ncplane* n){
+  nchistory* h = n->history;
+  for(int i = 0 ; i < h->viewrows * n->lenx ; ++i){
+    nccell_release(n, &h->view[i]);
+  }
+  free(h->view);
+  h->view = NULL;
+  h->viewrows = 0;
+}
+
+// decode record 'r' into the 'n'->lenx cells at 'dst', stashing any extended
+// EGCs in the pool of 'n'. cells beyond the width of the record are blank.
+static int
+history_decode_row(ncplane* n, unsigned r, nccell* dst){
+  const nchistory* h = n->history;
+  const char* rec = h->map + h->rows[r];
+  histrow hr;
+  memcpy(&hr, rec, sizeof(hr));
+  const nccell* cells = (const nccell*)(rec + sizeof(hr));
+  const char* tail = rec + sizeof(hr) + sizeof(*cells) * hr.cols;
+  for(int x = 0 ; x < n->lenx && (unsigned)x < hr.cols ; ++x){
+    dst[x] = cells[x];
+    if(cell_extended_p(&cells[x])){
+      const char* egc = tail + cell_egc_idx(&cells[x]);
+      int eoffset = egcpool_stash(&n->pool, egc, strlen(egc));
+      if(eoffset < 0){
+        dst[x].gcluster = 0;
+        return -1;
+      }
+      set_gcluster_egc(&dst[x], eoffset);
+    }
+  }
+  return 0;
+}
+
+int nchistory_refresh(ncplane* n){
+  nchistory* h = n->history;
+  nchistory_drop_view(n);
+  if(h->seek == 0){
+    return 0;
+  }
+  const int viewrows = h->seek > (unsigned)n->leny ? n->leny : (int)h->seek;
+  if((h->view = calloc(viewrows * n->lenx, sizeof(*h->view))) == NULL){
+    h->seek = 0;
+    return -1;
+  }
+  h->viewrows = viewrows;
+  // the top row of the view is 'seek' rows back from the plane's top row
+  const unsigned first = h->rowcount - h->seek;
+  for(int y = 0 ; y < viewrows ; ++y){
+    if(history_decode_row(n, first + y, h->view + y * n->lenx)){
+      // fall back to the live view, which we can always show
+      nchistory_drop_view(n);
+      h->seek = 0;
+      return -1;
+    }
+  }
+  return 0;
+}
+
+void nchistory_free(ncplane* n){
+  nchistory* h = n->history;
+  if(h){
+    nchistory_drop_view(n);
+    if(h->map){
+      munmap(h->map, h->maplen);
+    }
+    // trim the file to its records, dropping the growth slack
+    if(ftruncate(h->fd, h->used)){
+      logwarn("Couldn't trim history to %zuB\n", h->used);
+    }
+    close(h->fd);
+    free(h->rows);
+    free(h);
+    n->history = NULL;
+  }
+}
+
+int ncplane_set_history(ncplane* n, const char* path){
+  if(n->history){
+    nchistory_free(n);
+  }
+  if(path == NULL){
+    return 0;
+  }
+  nchistory* h = malloc(sizeof(*h));
+  if(h == NULL){
+    return -1;
+  }
+  memset(h, 0, sizeof(*h));
+  if((h->fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600)) < 0){
+    logerror("Couldn't open history at %s (%s)\n", path, strerror(errno));
+    free(h);
+    return -1;
+  }
+  n->history = h;
+  return 0;
+}
+#else
+int nchistory_append(ncplane* n, int rows){
+  (void)n;
+  (void)rows;
+  return -1;
+}
+
+int nchistory_refresh(ncplane* n){
+  (void)n;
+  return -1;
+}
+
+void nchistory_drop_view(ncplane* n){
+  (void)n;
+}
+
+void nchistory_free(ncplane* n){
+  (void)n;
+}
+
+int ncplane_set_history(ncplane* n, const char* path){
+  (void)n;
+  if(path){
+    logerror("Scrollback history is not yet supported on Windows\n");
+    return -1;
+  }
+  return 0;
+}
+#endif
+
+int ncplane_history_rows(const ncplane* n){
+  if(n->history == NULL){
+    return 0;
+  }
+  return n->history->rowcount;
+}
+
+int ncplane_history_seek(ncplane* n, int rows){
+  if(n->history == NULL){
+    logerror("No history on plane %p\n", n);
+    return -1;
+  }
+  if(rows < 0 || (unsigned)rows > n->history->rowcount){
+    logerror("Can't seek %d rows into %u of history\n", rows, n->history->rowcount);
+    return -1;
+  }
+  n->history->seek = rows;
+  return nchistory_refresh(n);
+}
@@ -0,0 +1,56 @@
+#ifndef NOTCURSES_HISTORY
+#define NOTCURSES_HISTORY
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// internal header, not installed
+
+#include <stdint.h>
+#include <stddef.h>
+#include "notcurses/notcurses.h"
+
+struct ncplane;
+
+// rows scrolled off the top of a plane with history enabled are appended to
+// a memory-mapped file. each row is a record made up of a header, the row's
+// cells, and the EGCs referenced by any of its extended cells (such cells
+// have their gcluster rewritten as an offset into this tail). records are
+// padded to 8 bytes. only the offsets of the records are kept in memory.
+typedef struct nchistory {
+  int fd;             // backing file, opened by ncplane_set_history()
+  char* map;          // mapping of the entire backing file
+  size_t maplen;      // size of the mapping (and of the file)
+  size_t used;        // bytes of the file holding records
+  uint64_t* rows;     // file offset of each record, oldest first
+  unsigned rowcount;  // records in the file
+  unsigned rowalloc;  // entries allocated in 'rows'
+  // when the view is sought back into history, the top 'seek' rows of the
+  // plane (up to its height) come from history, decoded into 'view' (with
+  // any extended EGCs stashed in the plane's pool), and the live rows are
+  // shown shifted down by 'seek'. nothing is decoded while 'seek' is 0.
+  unsigned seek;
+  nccell* view;       // decoded history rows, viewrows x lenx
+  int viewrows;
+} nchistory;
+
+// append the top 'rows' logical rows of 'n' to its history. if 'rows'
+// exceeds the height of the plane, the remainder are appended as blank rows.
+// called by scroll_lines() prior to rotating the framebuffer.
+int nchistory_append(struct ncplane* n, int rows);
+
+// release the view's cells, and decode it anew according to the seek.
+int nchistory_refresh(struct ncplane* n);
+
+// release the view's cells, without decoding anything.
+void nchistory_drop_view(struct ncplane* n);
+
+// unmap and close the history of 'n', if it has any.
+void nchistory_free(struct ncplane* n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1020,6 +1020,7 @@ typedef enum {
   STATE_APC,        // application programming command, starts with \x1b_
   STATE_APC_DRAIN,  // looking for \x1b
   STATE_APC_ST,     // looking for ST
+  STATE_KITTY_GRAPHICS, // kitty graphics reply (APC G), reading to ST
   STATE_BG1,        // got '1'
   STATE_BG2,        // got second '1'
   STATE_BGSEMI,     // got '11;', draining string to ESC ST
@@ -1055,7 +1056,8 @@ typedef struct query_state {
   queried_terminals_e qterm;
   char* version;        // terminal version, if detected. heap-allocated.
   // stringstate is the state at which this string was initialized, and can be
-  // one of STATE_XTVERSION1, STATE_XTGETTCAP_TERMNAME1, STATE_TDA1, and STATE_BG1
+  // one of STATE_XTVERSION1, STATE_XTGETTCAP_TERMNAME1, STATE_TDA1, STATE_BG1,
+  // and STATE_KITTY_GRAPHICS
   initstates_e state, stringstate;
   int numeric;           // currently-lexed numeric
   char runstring[80];    // running string
@@ -1154,6 +1156,16 @@ extract_xtversion(query_state* qstate, size_t slen, char suffix){
   return extract_version(qstate, slen);
 }
 
+// a reply to one of our medium probes. prefer the best medium accepted.
+static void
+kitty_graphics_reply(query_state* inits){
+  kitty_medium_e m = kitty_medium_reply(inits->tcache->kittymedium, inits->runstring);
+  if(m != inits->tcache->kittymedium){
+    loginfo("kitty accepted medium %d\n", m);
+    inits->tcache->kittymedium = m;
+  }
+}
+
 static int
 stash_string(query_state* inits){
 //fprintf(stderr, "string terminator after %d [%s]\n", inits->stringstate, inits->runstring);
@@ -1217,7 +1229,10 @@ stash_string(query_state* inits){
       }
       inits->bg = (r << 16u) | (g << 8u) | b;
       break;
-    }default:
+    }case STATE_KITTY_GRAPHICS:
+      kitty_graphics_reply(inits);
+      break;
+    default:
 // don't generally enable this -- XTerm terminates TDA with ST
 //fprintf(stderr, "invalid string [%s] stashed %d\n", inits->runstring, inits->stringstate);
       break;
@@ -1288,8 +1303,19 @@ pump_control_read(query_state* inits, unsigned char c){
     case STATE_APC:
       if(c == 'G'){
         inits->kittygraphics = true;
+        inits->stridx = 0;
+        inits->runstring[0] = '\0';
+        inits->stringstate = STATE_KITTY_GRAPHICS;
+        inits->state = STATE_KITTY_GRAPHICS;
+      }else{
+        inits->state = STATE_APC_DRAIN;
+      }
+      break;
+    case STATE_KITTY_GRAPHICS:
+      if(inits->stridx + 1 < sizeof(inits->runstring)){
+        inits->runstring[inits->stridx] = c;
+        inits->runstring[++inits->stridx] = '\0';
       }
-      inits->state = STATE_APC_DRAIN;
       break;
     case STATE_APC_DRAIN:
       if(c == '\x1b'){
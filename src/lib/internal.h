@@ -37,11 +37,13 @@ extern "C" {
 #include "lib/sprite.h"
 #include "lib/fbuf.h"
 #include "lib/gpm.h"
+#include "lib/history.h"
 
 #define API __attribute__((visibility("default")))
 #define ALLOC __attribute__((malloc)) __attribute__((warn_unused_result))
 
 struct sixelmap;
+struct sixelpalette;
 struct ncvisual_details;
 
 // Was this glyph drawn as part of an ncvisual? If so, we need to honor
@@ -65,8 +67,15 @@ struct ncvisual_details;
 // The framebuffer 'fb' is a set of rows. For scrolling, we interpret it as a
 // circular buffer of rows. 'logrow' is the index of the row at the logical top
 // of the plane. It only changes from 0 if the plane is scrollable.
+//
+// Tiled planes (NCPLANE_OPTION_TILED) have no 'fb'. Their (virtual) rows are
+// instead grouped into tiles of NCPLANE_TILEROWS full-width rows, each of
+// which is allocated upon the first write to one of its rows. Always go
+// through ncplane_row_ref()/ncplane_row_peek() (or their cell equivalents)
+// rather than indexing 'fb' directly.
 typedef struct ncplane {
-  nccell* fb;            // "framebuffer" of character cells
+  nccell* fb;            // "framebuffer" of character cells, NULL if tiled
+  nccell** tiles;        // tiled framebuffer, NULL if not tiled
   int logrow;            // logical top row, starts at 0, add one for each scroll
   int x, y;              // current cursor location within this plane
   // ncplane_yx() etc. use coordinates relative to the plane to which this
@@ -107,6 +116,7 @@ typedef struct ncplane {
   int margin_b, margin_r;// bottom and right margins, stored for resize
   bool scrolling;        // is scrolling enabled? always disabled by default
   bool fixedbound;       // are we fixed relative to the parent's scrolling?
+  nchistory* history;    // scrollback history, NULL unless enabled
 } ncplane;
 
 // current presentation state of the terminal. it is carried across render
@@ -326,6 +336,12 @@ typedef struct ncpile {
   size_t crenderlen;          // size of crender vector
   int dimy, dimx;             // rows and cols at time of render
   int scrolls;                // how many real lines need be scrolled at raster
+  // a scrolling plane spanning full rows can be scrolled by the terminal
+  // within a scrolling region (DECSTBM) rather than being redrawn. we track
+  // a single such region (pile rows, inclusive) per render; -1 means several
+  // regions were scrolled, and we fall back to redrawing them.
+  int rscrolls;               // how many lines to scroll within the region
+  int rscrolltop, rscrollbot; // bounds of the scrolling region
   sprixel* sprixelcache;      // list of sprixels
 } ncpile;
 
@@ -363,6 +379,7 @@ typedef struct notcurses {
   int cursorx;    // -1 is don't-care, otherwise moved here after each render.
 
   ncsharedstats stats;   // some statistics across the lifetime of the context
+  struct kittycache* kittycache; // kitty images shared among sprixels
   ncstats stashed_stats; // retain across a context reset, for closing banner
 
   FILE* ttyfp;    // FILE* for writing rasterized data
@@ -392,10 +409,17 @@ typedef struct blitterargs {
     struct {
       int placey;      // placement within ncplane
       int placex;
+      bool banded;     // one band of a threaded blit; leave the cursor alone
     } cell;            // for cells
     struct {
       int colorregs;   // number of color registers
       sprixel* spx;    // sprixel object
+      struct sixelpalette** spal; // palette carried by the ncvisual, or NULL
+      size_t budget;   // if non-zero, target bound on encoded bytes
+      int* budgetregs; // registers last chosen to meet budget, or NULL
+      kitty_medium_e kittymedium; // best medium for kitty payloads
+      uint64_t ttybps; // observed tty throughput (B/s), 0 if unknown
+      struct kittycache* kittycache; // shared kitty images, or NULL
     } pixel;           // for pixels
   } u;
 } blitterargs;
@@ -440,6 +464,10 @@ void update_render_stats(const struct timespec* time1, const struct timespec* ti
 void update_render_bytes(ncstats* stats, int bytes);
 void update_write_stats(const struct timespec* time1, const struct timespec* time0, ncstats* stats, int bytes);
 
+// don't estimate the tty's throughput until we've written this much
+#define TTYBPS_MINBYTES (256 * 1024)
+uint64_t tty_bytes_per_sec(struct notcurses* nc);
+
 void sigwinch_handler(int signo);
 
 void init_lang(void);
@@ -495,6 +523,88 @@ nfbcellidx(const ncplane* n, int row, int col){
   return fbcellidx(logical_to_virtual(n, row), n->lenx, col);
 }
 
+#define NCPLANE_TILEROWS 64
+
+static inline bool
+ncplane_tiled_p(const ncplane* n){
+  return n->tiles != NULL;
+}
+
+static inline int
+ncplane_tilecount(int leny){
+  return (leny + NCPLANE_TILEROWS - 1) / NCPLANE_TILEROWS;
+}
+
+// number of rows in tile 't' of a plane having 'leny' rows
+static inline int
+ncplane_tilerows(int leny, int t){
+  int rows = leny - t * NCPLANE_TILEROWS;
+  return rows > NCPLANE_TILEROWS ? NCPLANE_TILEROWS : rows;
+}
+
+// allocate (zeroed) tile 't' of tiled plane 'n'. returns NULL on failure.
+nccell* ncplane_tile_alloc(const ncplane* n, int t);
+
+// free all tiles of tiled plane 'n', leaving it entirely empty. does not
+// touch the egcpool.
+void ncplane_tiles_free(ncplane* n);
+
+// get a writable reference to the first cell of virtual row 'vrow', allocating
+// its tile if necessary. NULL is only returned on allocation failure.
+static inline nccell*
+ncplane_vrow_ref(const ncplane* n, int vrow){
+  if(n->fb){
+    return n->fb + fbcellidx(vrow, n->lenx, 0);
+  }
+  const int t = vrow / NCPLANE_TILEROWS;
+  nccell* tile = n->tiles[t];
+  if(tile == NULL){
+    if((tile = ncplane_tile_alloc(n, t)) == NULL){
+      return NULL;
+    }
+  }
+  return tile + fbcellidx(vrow % NCPLANE_TILEROWS, n->lenx, 0);
+}
+
+// get a reference to the first cell of virtual row 'vrow' without allocating.
+// returns NULL if the row lives in an unallocated tile (i.e. all its cells are
+// zero), in which case there is nothing to read or clear.
+static inline nccell*
+ncplane_vrow_peek(const ncplane* n, int vrow){
+  if(n->fb){
+    return n->fb + fbcellidx(vrow, n->lenx, 0);
+  }
+  nccell* tile = n->tiles[vrow / NCPLANE_TILEROWS];
+  if(tile == NULL){
+    return NULL;
+  }
+  return tile + fbcellidx(vrow % NCPLANE_TILEROWS, n->lenx, 0);
+}
+
+// logical row equivalents of ncplane_vrow_ref() and ncplane_vrow_peek()
+static inline nccell*
+ncplane_row_ref(const ncplane* n, int y){
+  return ncplane_vrow_ref(n, logical_to_virtual(n, y));
+}
+
+static inline nccell*
+ncplane_row_peek(const ncplane* n, int y){
+  return ncplane_vrow_peek(n, logical_to_virtual(n, y));
+}
+
+// the row shown at row 'y' of 'n' when rendered, taking into account any seek
+// into its history. like ncplane_row_peek(), returns NULL for a blank row.
+static inline const nccell*
+ncplane_view_row(const ncplane* n, int y){
+  if(n->history && n->history->seek){
+    if(y < n->history->viewrows){
+      return n->history->view + y * n->lenx;
+    }
+    y -= n->history->seek;
+  }
+  return ncplane_row_peek(n, y);
+}
+
 // is the rgb value greyish? note that pure white and pure black are both
 // considered greyish according to the definition of this function =].
 static inline bool
@@ -598,9 +708,24 @@ pool_extended_gcluster(const egcpool* pool, const nccell* c){
   return egcpool_extended_gcluster(pool, c);
 }
 
+// get a writable reference to the cell at y, x. this can only fail (returning
+// NULL) for tiled planes, when the cell's tile cannot be allocated.
 static inline nccell*
 ncplane_cell_ref_yx(const ncplane* n, int y, int x){
-  return &n->fb[nfbcellidx(n, y, x)];
+  nccell* row = ncplane_row_ref(n, y);
+  return row ? row + x : NULL;
+}
+
+// every cell of an unallocated tile reads as this zeroed cell
+static const nccell ncplane_blankcell = { .gcluster = 0, .gcluster_backstop = 0,
+                                          .width = 0, .stylemask = 0, .channels = 0, };
+
+// get a read-only reference to the cell at y, x. never fails; cells of
+// unallocated tiles are represented by ncplane_blankcell.
+static inline const nccell*
+ncplane_cell_peek_yx(const ncplane* n, int y, int x){
+  const nccell* row = ncplane_row_peek(n, y);
+  return row ? row + x : &ncplane_blankcell;
 }
 
 static inline void
@@ -618,7 +743,7 @@ plane_debug(const ncplane* n, bool details){
   if(details){
     for(int y = 0 ; y < 1 ; ++y){
       for(int x = 0 ; x < 10 ; ++x){
-        const nccell* c = &n->fb[fbcellidx(y, dimx, x)];
+        const nccell* c = ncplane_cell_peek_yx(n, y, x);
         fprintf(stderr, "[%03d/%03d] ", y, x);
         cell_debug(&n->pool, c);
       }
@@ -681,6 +806,8 @@ void sprixel_hide(sprixel* s);
 // dimy and dimx are cell geometry, not pixel.
 sprixel* sprixel_alloc(const tinfo* ti, ncplane* n, int dimy, int dimx);
 sprixel* sprixel_recycle(ncplane* n);
+// a fresh sprixel id, also usable as a kitty image id
+uint32_t sprixel_newid(void);
 int sprite_init(const tinfo* t, int fd);
 int sprite_clear_all(const tinfo* t, fbuf* f);
 // these three all use absolute coordinates
@@ -688,6 +815,7 @@ void sprixel_invalidate(sprixel* s, int y, int x);
 void sprixel_movefrom(sprixel* s, int y, int x);
 void sprixel_debug(const sprixel* s, FILE* out);
 void sixelmap_free(struct sixelmap *s);
+void sixelpalette_free(struct sixelpalette* spal);
 
 // create an auxiliary vector suitable for a sprixcell, and zero it out. there
 // are two bytes per pixel in the cell. kitty uses only one (for an alpha
@@ -1440,6 +1568,17 @@ pool_blit_direct(egcpool* pool, nccell* c, const char* gcluster, int bytes, int
   return bytes;
 }
 
+// Load the inline EGC 'egc' into 'c', as pool_blit_direct() would, releasing
+// any extended EGC it held. 'egc' must be four bytes, padded with NULs, and
+// must be a single column wide; none of the checks of pool_blit_direct() are
+// made, as this is meant for the precomputed glyphs of the blitters.
+static inline void
+pool_blit_packed(egcpool* pool, nccell* c, const char* egc){
+  pool_release(pool, c);
+  c->width = 1;
+  memcpy(&c->gcluster, egc, sizeof(c->gcluster));
+}
+
 // Do an RTL-check, reset the quadrant occupancy bits, and pass the cell down to
 // pool_blit_direct(). Returns the number of bytes loaded.
 static inline int
@@ -1465,6 +1604,9 @@ cell_load_direct(ncplane* n, nccell* c, const char* gcluster, int bytes, int col
 // increment y by 1 and rotate the framebuffer up one line. x moves to 0.
 void scroll_down(ncplane* n);
 
+// as scroll_down(), 'r' times, but in a single pass.
+void scroll_lines(ncplane* n, int r);
+
 static inline bool
 islinebreak(wchar_t wchar){
   // UC_LINE_SEPARATOR + UC_PARAGRAPH_SEPARATOR
@@ -1610,10 +1752,28 @@ int term_fg_rgb8(const tinfo* ti, fbuf* f, unsigned r, unsigned g, unsigned b);
 
 const struct blitset* lookup_blitset(const tinfo* tcache, ncblitter_e setid, bool may_degrade);
 
+// the number of pixel rows a cell blitter consumes per row of cells. this is
+// not always the blitset's height.
+int blitset_cellheight(const struct blitset* bset);
+
+// the number of threads over which to split |units| of work, giving each at
+// least |minunits|, and using no more than the online CPUs. at least 1.
+int blit_threadcount(int units, int minunits);
+
+// blit using a cell blitter, splitting the output into bands of rows which
+// are blitted in parallel. falls back to a single thread if the output is
+// small, or if the cells being replaced hold EGCs in the plane's pool.
+int rgba_blit_threaded(ncplane* nc, const struct blitset* bset,
+                       int linesize, const void* data,
+                       int leny, int lenx, const blitterargs* bargs);
+
 static inline int
 rgba_blit_dispatch(ncplane* nc, const struct blitset* bset,
                    int linesize, const void* data,
                    int leny, int lenx, const blitterargs* bargs){
+  if((bargs->flags & NCVISUAL_OPTION_THREADED) && bset->geom != NCBLIT_PIXEL){
+    return rgba_blit_threaded(nc, bset, linesize, data, leny, lenx, bargs);
+  }
   return bset->blit(nc, linesize, data, leny, lenx, bargs);
 }
 
@@ -1,6 +1,9 @@
 #include <zlib.h>
+#include <fcntl.h>
+#include <stdatomic.h>
 #include "internal.h"
 #include "base64.h"
+#include "kittyz.h"
 
 // Kitty has its own bitmap graphics protocol, rather superior to DEC Sixel.
 // A header is written with various directives, followed by a number of
@@ -34,6 +37,21 @@
 //  to annihilation. we never need retransmit the original RGBA on
 //  restore, as we can instead use composition with reflection.
 //
+// from 0.20.0 onwards, the initial upload is never edited in place. when the
+// terminal shares our machine, it can thus be handed over uncompressed in a
+// POSIX shared memory object or temporary file (t=s or t=t), rather than as
+// deflated base64 through the tty. pre-0.20.0 uploads are retransmitted from
+// the glyph, and always travel through the tty.
+//
+// the deflate level for uploads through the tty is chosen per upload, trading
+// measured time spent compressing against the time it takes to write the
+// result (see kitty_zlevel_pick()). large threaded uploads are deflated in
+// pieces, in parallel, yielding a single stream.
+//
+// from 0.20.0 onwards, reblitting a sprixel with pixels mostly like its old
+// ones edits the old image in place, transmitting only the rectangles which
+// changed (see kitty_image_update()).
+//
 // if a graphic needs be moved, we can move it with a control operation,
 // rather than erasing it and redrawing it manually.
 //
@@ -346,13 +364,15 @@ uint8_t* kitty_trans_auxvec(const tinfo* ti){
   return a;
 }
 
+static int kitty_image_detach(sprixel* s);
+
 // just dump the wipe into the fbuf -- don't manipulate any state. used both
 // by the wipe proper, and when blitting a new frame with annihilations.
 static int
 kitty_blit_wipe_selfref(sprixel* s, fbuf* f, int ycell, int xcell){
-  if(fbuf_printf(f, "\x1b_Ga=f,x=%d,y=%d,s=%d,v=%d,i=%d,X=1,r=2,c=1,q=2;",
+  if(fbuf_printf(f, "\x1b_Ga=f,x=%d,y=%d,s=%d,v=%d,i=%u,X=1,r=2,c=1,q=2;",
                  xcell * s->cellpxx, ycell * s->cellpxy,
-                 s->cellpxx, s->cellpxy, s->id) < 0){
+                 s->cellpxx, s->cellpxy, s->imgid) < 0){
     return -1;
   }
   // FIXME ought be smaller around the fringes!
@@ -379,7 +399,7 @@ kitty_blit_wipe_selfref(sprixel* s, fbuf* f, int ycell, int xcell){
   #undef DUONULLALPHA
   }
   // FIXME need chunking for cells of 768+ pixels
-  if(fbuf_printf(f, "\x1b\\\x1b_Ga=a,i=%d,c=2,q=2\x1b\\", s->id) < 0){
+  if(fbuf_printf(f, "\x1b\\\x1b_Ga=a,i=%u,c=2,q=2\x1b\\", s->imgid) < 0){
     return -1;
   }
   return 0;
@@ -389,6 +409,9 @@ kitty_blit_wipe_selfref(sprixel* s, fbuf* f, int ycell, int xcell){
 // cell id with which we can delete it in O(1) for a rebuild. this
 // way, we needn't delete and redraw the entire sprixel.
 int kitty_wipe_animation(sprixel* s, int ycell, int xcell){
+  if(kitty_image_detach(s)){
+    return -1;
+  }
   if(init_sprixel_animation(s)){
     return -1;
   }
@@ -402,6 +425,9 @@ int kitty_wipe_animation(sprixel* s, int ycell, int xcell){
 }
 
 int kitty_wipe_selfref(sprixel* s, int ycell, int xcell){
+  if(kitty_image_detach(s)){
+    return -1;
+  }
   if(init_sprixel_animation(s)){
     return -1;
   }
@@ -514,8 +540,9 @@ int kitty_wipe(sprixel* s, int ycell, int xcell){
 }
 
 int kitty_commit(fbuf* f, sprixel* s, unsigned noscroll){
-  loginfo("Committing Kitty graphic id %u\n", s->id);
-  fbuf_printf(f, "\e_Ga=p,i=%u,p=1,q=2%s\e\\", s->id, noscroll ? ",C=1" : "");
+  loginfo("Committing Kitty graphic id %u (image %u)\n", s->id, s->imgid);
+  fbuf_printf(f, "\e_Ga=p,i=%u,p=%u,q=2%s\e\\", s->imgid, s->id,
+              noscroll ? ",C=1" : "");
   s->invalidated = SPRIXEL_QUIESCENT;
   return 0;
 }
@@ -529,19 +556,24 @@ cleanup_tam(tament* tam, int ydim, int xdim){
   }
 }
 
-static inline void*
-zctx_origbuf(z_stream* zctx, int pixy, int pixx){
-  size_t blen = pixx * pixy * 4;
-  unsigned long b = deflateBound(zctx, blen);
-  return (unsigned char *)zctx->next_out - (b - zctx->avail_out);
+// base64-encode |len| bytes of |src| directly into |f|
+static inline int
+fbuf_putbase64(fbuf* f, const void* src, size_t len){
+  size_t b64len = (len + 2) / 3 * 4;
+  if(fbuf_reserve(f, b64len)){
+    return -1;
+  }
+  base64_encode(src, len, f->buf + f->used);
+  f->used += b64len;
+  return 0;
 }
 
+// complete the control block, and write the |len|-byte payload |buf| as
+// base64 in chunks of no more than 4096B.
 static int
-encode_and_chunkify(fbuf* f, z_stream* zctx, int pixy, int pixx){
-  unsigned long totw = zctx->total_out;
-  unsigned char* buf = zctx_origbuf(zctx, pixy, pixx);
+encode_and_chunkify(fbuf* f, const unsigned char* buf, size_t len){
   // need to terminate the header, requiring semicolon
-  if(totw > 4096 * 3 / 4){
+  if(len > 4096 * 3 / 4){
     if(fbuf_putn(f, ",m=1", 4) < 0){
       return -1;
     }
@@ -550,22 +582,17 @@ encode_and_chunkify(fbuf* f, z_stream* zctx, int pixy, int pixx){
     return -1;
   }
   bool first = true;
-  unsigned long i = 0;
-  char b64d[4];
-  while(totw - i > 4096 * 3 / 4){
+  size_t i = 0;
+  while(len - i > 4096 * 3 / 4){
     if(!first){
       if(fbuf_putn(f, "\x1b_Gm=1;", 7) < 0){
         return -1;
       }
     }
-    unsigned long max = i + 4096 * 3 / 4;
-    while(i < max){
-      base64x3(buf + i, b64d);
-      if(fbuf_putn(f, b64d, 4) < 0){
-        return -1;
-      }
-      i += 3;
+    if(fbuf_putbase64(f, buf + i, 4096 * 3 / 4)){
+      return -1;
     }
+    i += 4096 * 3 / 4;
     first = false;
     if(fbuf_putn(f, "\x1b\\", 2) < 0){
       return -1;
@@ -576,109 +603,438 @@ encode_and_chunkify(fbuf* f, z_stream* zctx, int pixy, int pixx){
       return -1;
     }
   }
-  while(i < totw){
-    if(totw - i < 3){
-      base64final(buf + i, b64d, totw - i);
-      if(fbuf_putn(f, b64d, 4) < 0){
-        return -1;
-      }
-      i += totw - i;
-    }else{
-      base64x3(buf + i, b64d);
-      if(fbuf_putn(f, b64d, 4) < 0){
-        return -1;
+  if(fbuf_putbase64(f, buf + i, len - i)){
+    return -1;
+  }
+  if(fbuf_putn(f, "\x1b\\", 2) < 0){
+    return -1;
+  }
+  return 0;
+}
+
+// copy |encodeable| pixels to |dst|, zeroing the alpha of those which are
+// wiped or transparent.
+static inline void
+kitty_prep_pixels(uint32_t* dst, const uint32_t* src, int encodeable,
+                  const bool wipe[3]){
+  for(int e = 0 ; e < encodeable ; ++e){
+    dst[e] = src[e];
+    if(wipe[e] || rgba_trans_p(dst[e], 0)){
+      ncpixel_set_a(&dst[e], 0);
+    }
+  }
+}
+
+// the zlib levels among which we choose for uploads through the tty. level 0
+// means we don't compress at all (and don't write o=z).
+static const int kitty_zlevels[] = { 0, 1, 2, 4, 6 };
+#define KITTY_ZLEVELS (sizeof(kitty_zlevels) / sizeof(*kitty_zlevels))
+// until we know how fast the tty is, use level 2. it seems to work well for
+// things that are going to compress up meaningfully at all, while not taking
+// too much time.
+#define KITTY_ZLEVEL_DEFAULT 2
+// every this many uploads, try a neighbor of the best known level
+#define KITTY_ZLEVEL_PROBE 8
+
+// measurements of each level across all contexts. compression ratio and cost
+// are (roughly) properties of the images we're sent and the machine we're on;
+// the tty's throughput is supplied with each upload. for each level, we keep
+// moving averages of output bytes per input byte, and nanoseconds spent per
+// input byte. an upload through the tty then costs, per input byte, the time
+// spent deflating plus the time spent writing its base64 (4/3 of its output).
+// we pick the cheapest level we've measured, climbing to unmeasured levels
+// above it, and now and then retry its neighbors as the images change.
+static struct kittyztuner {
+  pthread_mutex_t lock;
+  unsigned uploads;
+  bool measured[KITTY_ZLEVELS];
+  double ratio[KITTY_ZLEVELS];
+  double nspb[KITTY_ZLEVELS];
+} ztuner = {
+  .lock = PTHREAD_MUTEX_INITIALIZER,
+  .measured = { true, },
+  .ratio = { 1, },
+};
+
+// the index of zlib |level| within kitty_zlevels, which must hold it
+static inline unsigned
+kitty_zlevel_index(int level){
+  for(unsigned i = 0 ; i < KITTY_ZLEVELS ; ++i){
+    if(kitty_zlevels[i] == level){
+      return i;
+    }
+  }
+  return 0;
+}
+
+static inline double
+kitty_zlevel_cost(unsigned idx, uint64_t ttybps){
+  return ztuner.nspb[idx] + ztuner.ratio[idx] * 4 / 3 * NANOSECS_IN_SEC / ttybps;
+}
+
+// choose an index into kitty_zlevels for an upload through a tty moving
+// |ttybps| bytes per second (0 if unknown).
+static unsigned
+kitty_zlevel_pick(uint64_t ttybps){
+  if(ttybps == 0){
+    return kitty_zlevel_index(KITTY_ZLEVEL_DEFAULT);
+  }
+  pthread_mutex_lock(&ztuner.lock);
+  unsigned best = 0;
+  double bestcost = kitty_zlevel_cost(0, ttybps);
+  for(unsigned i = 1 ; i < KITTY_ZLEVELS ; ++i){
+    if(ztuner.measured[i]){
+      double cost = kitty_zlevel_cost(i, ttybps);
+      if(cost < bestcost){
+        bestcost = cost;
+        best = i;
       }
-      i += 3;
     }
   }
-  if(fbuf_putn(f, "\x1b\\", 2) < 0){
+  unsigned pick = best;
+  if(best + 1 < KITTY_ZLEVELS && !ztuner.measured[best + 1]){
+    pick = best + 1;
+  }else if(++ztuner.uploads % KITTY_ZLEVEL_PROBE == 0){
+    if((ztuner.uploads / KITTY_ZLEVEL_PROBE) % 2 && best + 1 < KITTY_ZLEVELS){
+      pick = best + 1;
+    }else if(best){
+      pick = best - 1;
+    }
+  }
+  pthread_mutex_unlock(&ztuner.lock);
+  return pick;
+}
+
+// fold a deflate of |inlen| bytes to |outlen| bytes taking |ns| into the
+// measurements for level index |idx|.
+static void
+kitty_zlevel_record(unsigned idx, size_t inlen, size_t outlen, uint64_t ns){
+  const double ratio = (double)outlen / inlen;
+  const double nspb = (double)ns / inlen;
+  pthread_mutex_lock(&ztuner.lock);
+  if(!ztuner.measured[idx]){
+    ztuner.ratio[idx] = ratio;
+    ztuner.nspb[idx] = nspb;
+    ztuner.measured[idx] = true;
+  }else{
+    ztuner.ratio[idx] += (ratio - ztuner.ratio[idx]) / 4;
+    ztuner.nspb[idx] += (nspb - ztuner.nspb[idx]) / 4;
+  }
+  pthread_mutex_unlock(&ztuner.lock);
+}
+
+// a threaded deflate gives each piece at least this many KiB of input
+#define KITTY_ZPIECE_MINKIB 256
+
+// compress |len| bytes of |src| at |level| into a zlib stream, splitting the
+// work across threads if |threaded| (see kittyz.h). returns a heap-allocated
+// buffer, writing its length to |*outlen| and the cpu time spent on it to
+// |*cpuns|, or NULL on error.
+static unsigned char*
+kitty_deflate(const unsigned char* src, size_t len, int level, bool threaded,
+              size_t* outlen, uint64_t* cpuns){
+  int count = 1;
+  if(threaded){
+    count = blit_threadcount(len / 1024, KITTY_ZPIECE_MINKIB);
+  }
+  unsigned char* z = kitty_deflate_pieces(src, len, level, count, outlen, cpuns);
+  if(z == NULL){
+    logerror("Error deflating %zuB at level %d\n", len, level);
+  }
+  return z;
+}
+
+// the RGBA of an animated upload, written either into a shared memory object
+// or temporary file, or into a heap buffer to go through the tty (possibly
+// deflated). |medium| is KITTY_MEDIUM_DIRECT in the latter case. legacy
+// uploads are encoded directly into the glyph, and have no map.
+typedef struct kittyupload {
+  kitty_medium_e medium;
+  uint32_t* map;      // mapping or buffer, NULL once finalized
+  size_t len;         // bytes in the upload
+  size_t used;        // bytes written thus far
+  unsigned zlevel;    // index into kitty_zlevels, for KITTY_MEDIUM_DIRECT
+  char tagged[KITTY_MEDIUM_TAGLEN]; // 's' or 't', followed by the name
+} kittyupload;
+
+// payloads smaller than this aren't worth a trip through the filesystem
+#define KITTY_MEDIUM_MINLEN 4096
+
+#ifndef __MINGW64__
+static atomic_uint medium_nonce;
+#endif
+
+void kitty_unlink_medium(const char* tagged){
+#ifndef __MINGW64__
+  if(tagged[0] == 's'){
+    shm_unlink(tagged + 1);
+  }else if(tagged[0] == 't'){
+    unlink(tagged + 1);
+  }
+#else
+  (void)tagged;
+#endif
+}
+
+// create a medium of |len| bytes, writing its tagged name to |tagged|.
+// kitty will only delete temporary files having "tty-graphics-protocol" in
+// their path, and living in a known temporary directory: we use $TMPDIR,
+// falling back to /tmp. returns an open file descriptor, or -1 on failure.
+static int
+create_medium(kitty_medium_e medium, size_t len, char* tagged, size_t tlen){
+#ifndef __MINGW64__
+  unsigned nonce = atomic_fetch_add(&medium_nonce, 1);
+  int r;
+  if(medium == KITTY_MEDIUM_SHM){
+    r = snprintf(tagged, tlen, "s/tty-graphics-protocol-%d-%u", (int)getpid(), nonce);
+  }else{
+    const char* tmpdir = getenv("TMPDIR");
+    if(tmpdir == NULL || *tmpdir == '\0'){
+      tmpdir = "/tmp";
+    }
+    int dirlen = strlen(tmpdir);
+    while(dirlen && tmpdir[dirlen - 1] == '/'){
+      --dirlen;
+    }
+    r = snprintf(tagged, tlen, "t%.*s/tty-graphics-protocol-%d-%u",
+                 dirlen, tmpdir, (int)getpid(), nonce);
+  }
+  if(r < 0 || (size_t)r >= tlen){
+    tagged[0] = '\0';
+    return -1;
+  }
+  int fd;
+  if(medium == KITTY_MEDIUM_SHM){
+    fd = shm_open(tagged + 1, O_RDWR | O_CREAT | O_EXCL, 0600);
+  }else{
+    fd = open(tagged + 1, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+  }
+  if(fd < 0){
+    logwarn("Couldn't create %s (%s)\n", tagged + 1, strerror(errno));
+    tagged[0] = '\0';
+    return -1;
+  }
+  if(ftruncate(fd, len)){
+    logwarn("Couldn't size %s to %zuB (%s)\n", tagged + 1, len, strerror(errno));
+    close(fd);
+    kitty_unlink_medium(tagged);
+    tagged[0] = '\0';
+    return -1;
+  }
+  return fd;
+#else
+  (void)medium;
+  (void)len;
+  (void)tlen;
+  tagged[0] = '\0';
+  return -1;
+#endif
+}
+
+// try to map |medium| for the upload. returns 0 if the upload ought be
+// written to ku->map, or -1 if it ought go through the tty.
+static int
+prep_medium(kittyupload* ku, kitty_medium_e medium){
+  if(medium == KITTY_MEDIUM_DIRECT || ku->len < KITTY_MEDIUM_MINLEN){
+    return -1;
+  }
+#ifndef __MINGW64__
+  int fd = create_medium(medium, ku->len, ku->tagged, sizeof(ku->tagged));
+  if(fd < 0){
     return -1;
   }
+  void* map = mmap(NULL, ku->len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if(map == MAP_FAILED){
+    logwarn("Couldn't map %zuB of %s (%s)\n", ku->len, ku->tagged + 1, strerror(errno));
+    kitty_unlink_medium(ku->tagged);
+    return -1;
+  }
+  ku->map = map;
+  ku->medium = medium;
   return 0;
+#else
+  return -1;
+#endif
 }
 
+// set up |ku| for a (pixy * pixx) RGBA upload at |level|. animated uploads
+// use the best medium available, falling back to a buffer which we'll send
+// through the tty, deflated at a level chosen for its throughput.
 static int
-finalize_deflator(z_stream* zctx, fbuf* f, int dimy, int dimx){
-  assert(0 == zctx->avail_in);
-  int zret = deflate(zctx, Z_FINISH);
-  if(zret != Z_STREAM_END){
-    logerror("Error deflating (%d)\n", zret);
+prep_upload(kittyupload* ku, const blitterargs* bargs, kitty_graphics_e level,
+            int pixy, int pixx){
+  ku->medium = KITTY_MEDIUM_DIRECT;
+  ku->map = NULL;
+  ku->len = (size_t)pixy * pixx * 4;
+  ku->used = 0;
+  ku->zlevel = 0;
+  ku->tagged[0] = '\0';
+  if(level < KITTY_ANIMATION){
+    return 0;
+  }
+  if(prep_medium(ku, bargs->u.pixel.kittymedium) == 0){
+    return 0;
+  }
+  if((ku->map = malloc(ku->len)) == NULL){
     return -1;
   }
-  if(encode_and_chunkify(f, zctx, dimy, dimx)){
+  ku->zlevel = kitty_zlevel_pick(bargs->u.pixel.ttybps);
+  return 0;
+}
+
+// are we writing o=z for this upload?
+static inline bool
+upload_deflated(const kittyupload* ku){
+  return ku->map && ku->medium == KITTY_MEDIUM_DIRECT && kitty_zlevels[ku->zlevel];
+}
+
+// copy |encodeable| pixels to the upload
+static inline void
+add_to_upload(kittyupload* ku, const uint32_t* src, int encodeable, bool wipe[static 3]){
+  kitty_prep_pixels(ku->map + ku->used / 4, src, encodeable, wipe);
+  ku->used += encodeable * 4;
+}
+
+// the medium is referenced by the glyph, and thus owned by |s| until drawn
+static int
+track_medium(sprixel* s, const char* tagged){
+  size_t len = strlen(tagged) + 1;
+  char* tmp = realloc(s->media, s->medialen + len);
+  if(tmp == NULL){
     return -1;
   }
+  memcpy(tmp + s->medialen, tagged, len);
+  s->media = tmp;
+  s->medialen += len;
   return 0;
 }
 
-// copy |encodeable| pixels to the deflate state
+// the terminal has been handed everything in the glyph, and will delete the
+// mediums after reading them.
+static void
+forget_media(sprixel* s){
+  free(s->media);
+  s->media = NULL;
+  s->medialen = 0;
+}
+
+// unlink each of the |medialen| bytes of tagged names in |media|
+static void
+unlink_media(const char* media, size_t medialen){
+  for(size_t off = 0 ; off < medialen ; off += strlen(media + off) + 1){
+    loginfo("Unlinking undrawn %s\n", media + off + 1);
+    kitty_unlink_medium(media + off);
+  }
+}
+
+void kitty_release_media(sprixel* s){
+  unlink_media(s->media, s->medialen);
+  forget_media(s);
+}
+
+// unmap the medium, hand it to |s|, and complete the control block by naming
+// it (the name, like any payload, is base64-encoded).
 static int
-add_to_deflator(z_stream* zctx, const uint32_t* src, int encodeable, bool wipe[static 3]){
-  assert(0 == zctx->avail_in);
-  uint32_t dst[3];
-  zctx->next_in = (void*)dst;
-  dst[0] = *src++;
-  if(wipe[0] || rgba_trans_p(dst[0], 0)){
-    ncpixel_set_a(&dst[0], 0);
-  }
-  if(encodeable > 1){
-    dst[1] = *src++;
-    if(wipe[1] || rgba_trans_p(dst[1], 0)){
-      ncpixel_set_a(&dst[1], 0);
-    }
-    if(encodeable > 2){
-      dst[2] = *src++;
-      if(wipe[2] || rgba_trans_p(dst[2], 0)){
-        ncpixel_set_a(&dst[2], 0);
-      }
-    }
+finalize_medium(kittyupload* ku, fbuf* f, sprixel* s){
+#ifndef __MINGW64__
+  munmap(ku->map, ku->len);
+#endif
+  ku->map = NULL;
+  if(track_medium(s, ku->tagged)){
+    kitty_unlink_medium(ku->tagged);
+    return -1;
+  }
+  if(fbuf_printf(f, ",t=%c,S=%zu;", ku->tagged[0], ku->len) < 0){
+    return -1;
+  }
+  if(fbuf_putbase64(f, ku->tagged + 1, strlen(ku->tagged + 1))){
+    return -1;
   }
-  zctx->avail_in = encodeable * 4;
-  int zret = deflate(zctx, Z_NO_FLUSH);
-  if(zret != Z_OK){
-    logerror("Error deflating (%d)\n", zret);
+  if(fbuf_putn(f, "\x1b\\", 2) < 0){
     return -1;
   }
   return 0;
 }
 
-// writes to |*animated| based on normalized |level|
+// deflate the buffer (unless we chose level 0), and write it through the tty
 static int
-prep_deflator(kitty_graphics_e level, z_stream* zctx, int pixy, int pixx,
-              unsigned* animated){
-  memset(zctx, 0, sizeof(*zctx));
-  if(level >= KITTY_ANIMATION){
-    int zret;
-    // 2 seems to work well for things that are going to compress up
-    // meaningfully at all, while not taking too much time.
-    if((zret = deflateInit(zctx, 2)) != Z_OK){
-      logerror("Couldn't get a deflate context (%d)\n", zret);
-      return -1;
-    }
-    size_t blen = pixx * pixy * 4;
-    unsigned long b = deflateBound(zctx, blen);
-    unsigned char* buf = malloc(b);
-    if(buf == NULL){
-      deflateEnd(zctx);
+finalize_direct(kittyupload* ku, fbuf* f, bool threaded){
+  const unsigned char* payload = (const unsigned char*)ku->map;
+  size_t plen = ku->len;
+  unsigned char* z = NULL;
+  if(kitty_zlevels[ku->zlevel]){
+    // charge the level with cpu time, not wall time; a threaded deflate
+    // finishes sooner, but costs as much (or more).
+    uint64_t cpuns;
+    z = kitty_deflate(payload, plen, kitty_zlevels[ku->zlevel], threaded, &plen, &cpuns);
+    if(z == NULL){
       return -1;
     }
-    zctx->avail_out = b;
-    zctx->next_out = buf;
-    *animated = true;
-  }else{
-    *animated = false;
+    kitty_zlevel_record(ku->zlevel, ku->len, plen, cpuns);
+    payload = z;
   }
-  return 0;
+  int ret = encode_and_chunkify(f, payload, plen);
+  free(z);
+  free(ku->map);
+  ku->map = NULL;
+  return ret;
+}
+
+static int
+finalize_upload(kittyupload* ku, fbuf* f, sprixel* s, bool threaded){
+  assert(ku->used == ku->len);
+  if(ku->medium != KITTY_MEDIUM_DIRECT){
+    return finalize_medium(ku, f, s);
+  }
+  return finalize_direct(ku, f, threaded);
 }
 
+// release an upload which was never finalized
 static void
-destroy_deflator(unsigned animated, z_stream* zctx, int pixy, int pixx){
-  if(animated){
-    free(zctx_origbuf(zctx, pixy, pixx));
-    deflateEnd(zctx);
+destroy_upload(kittyupload* ku){
+  if(ku->map){
+    if(ku->medium == KITTY_MEDIUM_DIRECT){
+      free(ku->map);
+    }else{
+#ifndef __MINGW64__
+      munmap(ku->map, ku->len);
+#endif
+      kitty_unlink_medium(ku->tagged);
+    }
+    ku->map = NULL;
   }
 }
 
+int kitty_probe_medium(fbuf* f, kitty_medium_e medium, char* tagged, size_t tlen){
+  static const unsigned char pixel[3] = { 0, 0, 0 };
+  int fd = create_medium(medium, sizeof(pixel), tagged, tlen);
+  if(fd < 0){
+    return -1;
+  }
+  ssize_t w = write(fd, pixel, sizeof(pixel));
+  close(fd);
+  if(w != sizeof(pixel)){
+    goto err;
+  }
+  if(fbuf_printf(f, "\x1b_Gi=%d,s=1,v=1,a=q,t=%c,f=24,S=%zu;",
+                 KITTY_MEDIUM_QID(medium), tagged[0], sizeof(pixel)) < 0){
+    goto err;
+  }
+  if(fbuf_putbase64(f, tagged + 1, strlen(tagged + 1))){
+    goto err;
+  }
+  if(fbuf_putn(f, "\x1b\\", 2) < 0){
+    goto err;
+  }
+  return 0;
+
+err:
+  kitty_unlink_medium(tagged);
+  tagged[0] = '\0';
+  return -1;
+}
+
 // if we're KITTY_SELFREF, and we're blitting a secondary frame, we need
 // carry through the TAM's annihilation entires...but we also need load the
 // frame *without* annihilations, lest we be unable to build it. we thus go
@@ -704,6 +1060,38 @@ finalize_multiframe_selfref(sprixel* s, fbuf* f){
   return 0;
 }
 
+// the number of pixels from |x| on row |y| (which starts at |line|), to a
+// maximum of |maxpix| and never beyond the row, which are opaque and lie in
+// intact cells, rounded down to a multiple of three. such pixels need no
+// alpha rewriting, so their base64 can be generated directly from the
+// source. their cells' TAM entries are updated just as they would be
+// pixel by pixel.
+static int
+kitty_opaque_run(const uint32_t* line, int y, int x, int maxpix, int lenx,
+                 int cols, int cdimy, int cdimx, tament* tam,
+                 uint32_t transcolor){
+  int end = x + maxpix;
+  if(end > lenx){
+    end = lenx;
+  }
+  tament* trow = tam + (y / cdimy) * cols;
+  int px = x;
+  while(px < end && trow[px / cdimx].state < SPRIXCELL_ANNIHILATED &&
+        !rgba_trans_p(line[px], transcolor)){
+    ++px;
+  }
+  const int run = (px - x) - (px - x) % 3;
+  for(px = x ; px < x + run ; px += cdimx - px % cdimx){
+    tament* t = &trow[px / cdimx];
+    if(px % cdimx == 0 && y % cdimy == 0){
+      t->state = SPRIXCELL_OPAQUE_KITTY;
+    }else if(t->state == SPRIXCELL_TRANSPARENT){
+      t->state = SPRIXCELL_MIXED_KITTY;
+    }
+  }
+  return run;
+}
+
 // we can only write 4KiB at a time. we're writing base64-encoded RGBA. each
 // pixel is 4B raw (32 bits). each chunk of three pixels is then 12 bytes, or
 // 16 base64-encoded bytes. 4096 / 16 == 256 3-pixel groups, or 768 pixels.
@@ -718,15 +1106,17 @@ write_kitty_data(fbuf* f, int linesize, int leny, int lenx, int cols,
     return -1;
   }
   // we only deflate if we're using animation, since otherwise we need be able
-  // to edit the encoded bitmap in-place for wipes/restores.
-  z_stream zctx;
-  unsigned animated;
-  if(prep_deflator(level, &zctx, leny, lenx, &animated)){
+  // to edit the encoded bitmap in-place for wipes/restores. for the same
+  // reason, only animated uploads are buffered, whether in a shared medium
+  // (which we don't deflate at all) or on the heap.
+  kittyupload ku;
+  const bool animated = level >= KITTY_ANIMATION;
+  if(prep_upload(&ku, bargs, level, leny, lenx)){
     return -1;
   }
   bool translucent = bargs->flags & NCVISUAL_OPTION_BLEND;
   sprixel* s = bargs->u.pixel.spx;
-  int sprixelid = s->id;
+  uint32_t imgid = s->imgid;
   int cdimy = s->cellpxy;
   int cdimx = s->cellpxx;
   uint32_t transcolor = bargs->transcolor;
@@ -749,17 +1139,18 @@ write_kitty_data(fbuf* f, int linesize, int leny, int lenx, int cols,
       // older versions of kitty will delete uploaded images when scrolling,
       // alas. see https://github.com/dankamongmen/notcurses/issues/1910 =[.
       // parse_start isn't used in animation mode, so no worries there.
-      *parse_start = fbuf_printf(f, "\e_Gf=32,s=%d,v=%d,i=%d,p=1,a=t,%s",
-                                 lenx, leny, sprixelid,
-                                 animated ? "o=z,q=2" : chunks ? "m=1;" : "q=2;");
+      *parse_start = fbuf_printf(f, "\e_Gf=32,s=%d,v=%d,i=%u,p=1,a=t,%s",
+                                 lenx, leny, imgid,
+                                 upload_deflated(&ku) ? "o=z,q=2" : animated ? "q=2" :
+                                  chunks ? "m=1;" : "q=2;");
       if(*parse_start < 0){
         goto err;
       }
       // so if we're animated, we've printed q=2, but no semicolon to close
-      // the control block, since we're not yet sure what m= to write. we've
-      // otherwise written q=2; if we're the only chunk, and m=1; otherwise.
-      // if we're *not* animated, we'll get q=2,m=0; below. otherwise, it's
-      // handled following deflate.
+      // the control block, since we're not yet sure what m= (or t=) to
+      // write. we've otherwise written q=2; if we're the only chunk, and m=1;
+      // otherwise. if we're *not* animated, we'll get q=2,m=0; below.
+      // otherwise, it's handled when we finalize the upload.
     }else{
       if(!animated){
         if(fbuf_printf(f, "\e_G%sm=%d;", chunks ? "" : "q=2,", chunks ? 1 : 0) < 0){
@@ -771,6 +1162,23 @@ write_kitty_data(fbuf* f, int linesize, int leny, int lenx, int cols,
       targetout = total;
     }
     while(totalout < targetout){
+      if(!animated && !translucent){
+        if(x == lenx){
+          x = 0;
+          ++y;
+        }
+        const uint32_t* line = data + (linesize / sizeof(*data)) * y;
+        int run = kitty_opaque_run(line, y, x, targetout - totalout, lenx,
+                                   cols, cdimy, cdimx, tam, transcolor);
+        if(run){
+          if(fbuf_putbase64(f, line + x, run * sizeof(*line))){
+            goto err;
+          }
+          x += run;
+          totalout += run;
+          continue;
+        }
+      }
       int encodeable = targetout - totalout;
       if(encodeable > 3){
         encodeable = 3;
@@ -867,9 +1275,7 @@ write_kitty_data(fbuf* f, int linesize, int leny, int lenx, int cols,
       }
       totalout += encodeable;
       if(animated){
-        if(add_to_deflator(&zctx, source, encodeable, wipe)){
-          goto err;
-        }
+        add_to_upload(&ku, source, encodeable, wipe);
       }else{
         // we already took transcolor to alpha 0; there's no need to
         // check it again, so pass 0.
@@ -886,7 +1292,7 @@ write_kitty_data(fbuf* f, int linesize, int leny, int lenx, int cols,
     }
   }
   if(animated){
-    if(finalize_deflator(&zctx, f, leny, lenx)){
+    if(finalize_upload(&ku, f, s, bargs->flags & NCVISUAL_OPTION_THREADED)){
       goto err;
     }
     if(selfref_annihilated){
@@ -896,18 +1302,594 @@ write_kitty_data(fbuf* f, int linesize, int leny, int lenx, int cols,
     }
   }
   scrub_tam_boundaries(tam, leny, lenx, cdimy, cdimx);
-  destroy_deflator(animated, &zctx, leny, lenx);
   return 0;
 
 err:
   cleanup_tam(tam, (leny + cdimy - 1) / cdimy, (lenx + cdimx - 1) / cdimx);
-  destroy_deflator(animated, &zctx, leny, lenx);
+  destroy_upload(&ku);
   return -1;
 }
 
+// identical RGBA blitted at an animated level is uploaded only once per
+// context. the sprixel which uploads it lends its id to the image, and any
+// other sprixel drawing the same pixels (with the same options and cell
+// geometry) simply places that image. the upload itself is held by the cache
+// entry, and written out by whichever of its sprixels is first drawn. each
+// sprixel holds a reference, dropped when the sprixel is freed; its placement
+// is deleted in kitty_remove(). we keep a copy of the source pixels, both to
+// verify hits and so that a sprixel needing to wipe cells of a shared image
+// can upload its own copy first (see kitty_image_detach()).
+typedef struct kittyimage {
+  struct kittycache* cache;
+  struct kittyimage* next;
+  uint64_t hash;          // over the source RGBA
+  int leny, lenx;         // pixel geometry
+  int cellpxy, cellpxx;   // cell-pixel geometry at time of upload
+  kitty_graphics_e level;
+  uint64_t flags;         // the NCVISUAL_OPTION_BLEND bit of the blit
+  uint32_t transcolor;
+  int medium;             // kittymedium of the blit, reused for copies
+  uint32_t* pixels;       // packed copy of the source RGBA
+  sprixcell_e* states;    // resulting TAM states, one per cell
+  uint32_t imgid;         // kitty image id (that of the uploading sprixel)
+  unsigned refs;          // sprixels holding this image
+  fbuf upload;            // transmission, until first written out
+  char* media;            // mediums referenced by the upload
+  size_t medialen;
+} kittyimage;
+
+typedef struct kittycache {
+  pthread_mutex_t lock;   // piles might be blitted and rendered concurrently
+  kittyimage* images;
+} kittycache;
+
+// sources larger than this aren't cached, lest we hold too much memory
+#define KITTY_CACHE_MAXLEN (8u << 20u)
+
+kittycache* kitty_cache_create(void){
+  kittycache* kc = malloc(sizeof(*kc));
+  if(kc == NULL){
+    return NULL;
+  }
+  if(pthread_mutex_init(&kc->lock, NULL)){
+    free(kc);
+    return NULL;
+  }
+  kc->images = NULL;
+  return kc;
+}
+
+static void
+kitty_image_free(kittyimage* ki){
+  unlink_media(ki->media, ki->medialen);
+  free(ki->media);
+  fbuf_free(&ki->upload);
+  free(ki->states);
+  free(ki->pixels);
+  free(ki);
+}
+
+// all sprixels ought have been freed by now, releasing their images
+void kitty_cache_free(kittycache* kc){
+  if(kc){
+    while(kc->images){
+      kittyimage* ki = kc->images;
+      kc->images = ki->next;
+      logwarn("Image %u still had %u references\n", ki->imgid, ki->refs);
+      kitty_image_free(ki);
+    }
+    pthread_mutex_destroy(&kc->lock);
+    free(kc);
+  }
+}
+
+// call with the cache locked
+static void
+kitty_image_unlink(kittyimage* ki){
+  for(kittyimage** pki = &ki->cache->images ; *pki ; pki = &(*pki)->next){
+    if(*pki == ki){
+      *pki = ki->next;
+      break;
+    }
+  }
+  ki->next = NULL;
+}
+
+void kitty_release_image(sprixel* s){
+  kittyimage* ki = s->kimg;
+  if(ki == NULL){
+    return;
+  }
+  s->kimg = NULL;
+  kittycache* kc = ki->cache;
+  pthread_mutex_lock(&kc->lock);
+  const bool last = --ki->refs == 0;
+  if(last){
+    kitty_image_unlink(ki);
+  }
+  pthread_mutex_unlock(&kc->lock);
+  if(last){
+    loginfo("Releasing cached image %u\n", ki->imgid);
+    kitty_image_free(ki);
+  }
+}
+
+static uint64_t
+kitty_rgba_hash(const uint32_t* data, int linesize, int leny, int lenx){
+  uint64_t h = 0xcbf29ce484222325ull ^ ((uint64_t)leny << 32u) ^ lenx;
+  for(int y = 0 ; y < leny ; ++y){
+    const uint32_t* row = data + (linesize / sizeof(*data)) * y;
+    int x = 0;
+    for( ; x + 2 <= lenx ; x += 2){
+      uint64_t w;
+      memcpy(&w, row + x, sizeof(w));
+      h = (h ^ w) * 0x100000001b3ull;
+      h ^= h >> 29u;
+    }
+    if(x < lenx){
+      h = (h ^ row[x]) * 0x100000001b3ull;
+      h ^= h >> 29u;
+    }
+  }
+  return h;
+}
+
+static bool
+kitty_image_matches(const kittyimage* ki, uint64_t hash, const uint32_t* data,
+                    int linesize, int leny, int lenx, const sprixel* s,
+                    const blitterargs* bargs, kitty_graphics_e level){
+  if(ki->hash != hash || ki->leny != leny || ki->lenx != lenx ||
+     ki->cellpxy != s->cellpxy || ki->cellpxx != s->cellpxx ||
+     ki->level != level || ki->transcolor != bargs->transcolor ||
+     ki->flags != (bargs->flags & NCVISUAL_OPTION_BLEND)){
+    return false;
+  }
+  for(int y = 0 ; y < leny ; ++y){
+    if(memcmp(ki->pixels + y * lenx, data + (linesize / sizeof(*data)) * y,
+              lenx * sizeof(*data))){
+      return false;
+    }
+  }
+  return true;
+}
+
+// find a cached image matching the blit, taking a reference to it.
+static kittyimage*
+kitty_image_lookup(kittycache* kc, uint64_t hash, const uint32_t* data,
+                   int linesize, int leny, int lenx, const sprixel* s,
+                   const blitterargs* bargs, kitty_graphics_e level){
+  pthread_mutex_lock(&kc->lock);
+  kittyimage* ki;
+  for(ki = kc->images ; ki ; ki = ki->next){
+    if(kitty_image_matches(ki, hash, data, linesize, leny, lenx, s, bargs, level)){
+      ++ki->refs;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&kc->lock);
+  return ki;
+}
+
+// |s| has just written its upload of |data|. move the upload (and any mediums
+// it references) into a new cache entry, referenced by |s|. on failure, |s|
+// is left as it was, and the image simply isn't cached.
+static void
+kitty_image_insert(kittycache* kc, sprixel* s, uint64_t hash, const uint32_t* data,
+                   int linesize, int leny, int lenx, const tament* tam,
+                   const blitterargs* bargs, kitty_graphics_e level){
+  kittyimage* ki = malloc(sizeof(*ki));
+  if(ki == NULL){
+    return;
+  }
+  const int cells = s->dimy * s->dimx;
+  ki->pixels = malloc(sizeof(*ki->pixels) * leny * lenx);
+  ki->states = malloc(sizeof(*ki->states) * cells);
+  if(ki->pixels == NULL || ki->states == NULL || fbuf_init_small(&ki->upload)){
+    free(ki->states);
+    free(ki->pixels);
+    free(ki);
+    return;
+  }
+  for(int y = 0 ; y < leny ; ++y){
+    memcpy(ki->pixels + y * lenx, data + (linesize / sizeof(*data)) * y,
+           lenx * sizeof(*data));
+  }
+  for(int i = 0 ; i < cells ; ++i){
+    ki->states[i] = tam[i].state;
+  }
+  fbuf tmp = ki->upload;
+  ki->upload = s->glyph;
+  s->glyph = tmp;
+  ki->media = s->media;
+  ki->medialen = s->medialen;
+  s->media = NULL;
+  s->medialen = 0;
+  ki->cache = kc;
+  ki->hash = hash;
+  ki->leny = leny;
+  ki->lenx = lenx;
+  ki->cellpxy = s->cellpxy;
+  ki->cellpxx = s->cellpxx;
+  ki->level = level;
+  ki->flags = bargs->flags & NCVISUAL_OPTION_BLEND;
+  ki->transcolor = bargs->transcolor;
+  ki->medium = bargs->u.pixel.kittymedium;
+  ki->imgid = s->imgid;
+  ki->refs = 1;
+  s->kimg = ki;
+  pthread_mutex_lock(&kc->lock);
+  ki->next = kc->images;
+  kc->images = ki;
+  pthread_mutex_unlock(&kc->lock);
+}
+
+// write out the cached image's upload, if no other sprixel has yet done so.
+// returns the number of bytes written, or -1 on error.
+static int
+kitty_image_draw(kittyimage* ki, fbuf* f){
+  int ret = 0;
+  pthread_mutex_lock(&ki->cache->lock);
+  if(ki->upload.used){
+    if(fbuf_putn(f, ki->upload.buf, ki->upload.used) < 0){
+      ret = -1;
+    }else{
+      ret = ki->upload.used;
+      fbuf_free(&ki->upload);
+      // the terminal now owns the mediums
+      free(ki->media);
+      ki->media = NULL;
+      ki->medialen = 0;
+    }
+  }
+  pthread_mutex_unlock(&ki->cache->lock);
+  return ret;
+}
+
+// |s| is about to modify its image, which it must thus have to itself. if it
+// uploaded the image, and no other sprixel holds it, we just pull it from the
+// cache, taking back any upload not yet written. otherwise, we upload a copy
+// of the cached pixels under a fresh image id (the shared id must keep naming
+// the shared image, even if |s| uploaded it), and delete our placement of the
+// shared image. only the uploader's TAM has the auxiliary vectors wipes need.
+static int
+kitty_image_detach(sprixel* s){
+  kittyimage* ki = s->kimg;
+  if(ki == NULL){
+    return 0;
+  }
+  kittycache* kc = ki->cache;
+  pthread_mutex_lock(&kc->lock);
+  if(ki->refs == 1 && ki->imgid == s->id){
+    kitty_image_unlink(ki);
+    pthread_mutex_unlock(&kc->lock);
+    if(ki->upload.used){
+      if(ki->medialen){
+        char* media = realloc(s->media, s->medialen + ki->medialen);
+        if(media == NULL){
+          return -1;
+        }
+        memcpy(media + s->medialen, ki->media, ki->medialen);
+        s->media = media;
+        s->medialen += ki->medialen;
+        free(ki->media);
+        ki->media = NULL;
+        ki->medialen = 0;
+      }
+      if(s->glyph.used && fbuf_putn(&ki->upload, s->glyph.buf, s->glyph.used) < 0){
+        return -1;
+      }
+      fbuf tmp = s->glyph;
+      s->glyph = ki->upload;
+      ki->upload = tmp;
+    }
+    loginfo("Sprixel %u took back image %u\n", s->id, ki->imgid);
+    s->kimg = NULL;
+    kitty_image_free(ki);
+    return 0;
+  }
+  pthread_mutex_unlock(&kc->lock);
+  if(init_sprixel_animation(s)){
+    return -1;
+  }
+  // we hold a reference, so the pixels can't go anywhere
+  blitterargs bargs;
+  memset(&bargs, 0, sizeof(bargs));
+  bargs.flags = ki->flags;
+  bargs.transcolor = ki->transcolor;
+  bargs.u.pixel.spx = s;
+  bargs.u.pixel.kittymedium = ki->medium;
+  s->imgid = sprixel_newid();
+  int parse_start;
+  if(write_kitty_data(&s->glyph, ki->lenx * sizeof(*ki->pixels), ki->leny, ki->lenx,
+                      s->dimx, ki->pixels, &bargs, s->n->tam, &parse_start, ki->level)){
+    s->imgid = ki->imgid;
+    return -1;
+  }
+  if(fbuf_printf(&s->glyph, "\e_Ga=d,d=i,i=%u,p=%u,q=2\e\\", ki->imgid, s->id) < 0){
+    s->imgid = ki->imgid;
+    return -1;
+  }
+  loginfo("Sprixel %u uploaded its own copy of image %u as %u\n",
+          s->id, ki->imgid, s->imgid);
+  kitty_release_image(s);
+  s->invalidated = SPRIXEL_INVALIDATED;
+  return 0;
+}
+
+// only animated uploads, which we never edit in place, can be shared. if
+// we're reusing a TAM with annihilated cells, they must be carried into the
+// new upload, which then doesn't reflect the source.
+static bool
+kitty_cacheable(const kittycache* kc, const tament* tam, bool reuse, int cells,
+                int leny, int lenx, kitty_graphics_e level){
+  if(kc == NULL || level < KITTY_ANIMATION){
+    return false;
+  }
+  if((size_t)leny * lenx * 4 > KITTY_CACHE_MAXLEN){
+    return false;
+  }
+  if(reuse){
+    for(int i = 0 ; i < cells ; ++i){
+      if(tam[i].state >= SPRIXCELL_ANNIHILATED){
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// a sprixel replacing another on the same plane inherits its image (see
+// sprixel_recycle()). if nobody else holds that image, its upload has been
+// written, and the new blit has the same geometry and options, we can edit
+// the image's root frame in place (a=f,r=1), uploading only what changed.
+// we compare cell-sized tiles against the retained pixels, join dirty tiles
+// into runs along each row of cells, and grow a run downwards while the row
+// below it has a run of the same extent. each rectangle costs a control block
+// (and possibly a medium), so if there are too many, or they don't save at
+// least half of a full upload, we upload the image whole.
+#define KITTY_DELTA_MAXRECTS 64
+#define KITTY_DELTA_RECTCOST 1024 // bytes charged for each rectangle
+
+typedef struct kittyrect {
+  int y, x;       // origin, in cells
+  int leny, lenx; // geometry, in cells
+} kittyrect;
+
+// can |s| edit its inherited image |ki| to reflect this blit?
+static bool
+kitty_image_updatable(kittyimage* ki, const sprixel* s, int leny, int lenx,
+                      const blitterargs* bargs, kitty_graphics_e level){
+  if(ki->leny != leny || ki->lenx != lenx ||
+     ki->cellpxy != s->cellpxy || ki->cellpxx != s->cellpxx ||
+     ki->level != level || ki->transcolor != bargs->transcolor ||
+     ki->flags != (bargs->flags & NCVISUAL_OPTION_BLEND)){
+    return false;
+  }
+  pthread_mutex_lock(&ki->cache->lock);
+  const bool ret = ki->refs == 1 && ki->upload.used == 0;
+  pthread_mutex_unlock(&ki->cache->lock);
+  return ret;
+}
+
+// the pixel geometry of |r|, clipped to the image
+static inline void
+kitty_rect_pixels(const kittyimage* ki, const kittyrect* r, int* py, int* px,
+                  int* pleny, int* plenx){
+  *py = r->y * ki->cellpxy;
+  *px = r->x * ki->cellpxx;
+  *pleny = r->leny * ki->cellpxy;
+  if(*py + *pleny > ki->leny){
+    *pleny = ki->leny - *py;
+  }
+  *plenx = r->lenx * ki->cellpxx;
+  if(*px + *plenx > ki->lenx){
+    *plenx = ki->lenx - *px;
+  }
+}
+
+// do the pixels of cell |ycell|/|xcell| differ from those retained?
+static bool
+kitty_tile_dirty(const kittyimage* ki, const uint32_t* data, int linesize,
+                 int ycell, int xcell){
+  const kittyrect r = { ycell, xcell, 1, 1, };
+  int py, px, pleny, plenx;
+  kitty_rect_pixels(ki, &r, &py, &px, &pleny, &plenx);
+  for(int y = py ; y < py + pleny ; ++y){
+    if(memcmp(ki->pixels + y * ki->lenx + px,
+              data + (linesize / sizeof(*data)) * y + px,
+              plenx * sizeof(*data))){
+      return true;
+    }
+  }
+  return false;
+}
+
+// find the rectangles of cells in which |data| differs from |ki|'s pixels.
+// returns the number of rectangles, or -1 if there are too many.
+static int
+kitty_delta_rects(const kittyimage* ki, const uint32_t* data, int linesize,
+                  kittyrect* rects){
+  const int rows = (ki->leny + ki->cellpxy - 1) / ki->cellpxy;
+  const int cols = (ki->lenx + ki->cellpxx - 1) / ki->cellpxx;
+  int count = 0;
+  for(int y = 0 ; y < rows ; ++y){
+    int x = 0;
+    while(x < cols){
+      if(!kitty_tile_dirty(ki, data, linesize, y, x)){
+        ++x;
+        continue;
+      }
+      const int startx = x;
+      while(++x < cols && kitty_tile_dirty(ki, data, linesize, y, x)){
+        ;
+      }
+      int r;
+      for(r = 0 ; r < count ; ++r){
+        if(rects[r].y + rects[r].leny == y && rects[r].x == startx &&
+           rects[r].lenx == x - startx){
+          ++rects[r].leny;
+          break;
+        }
+      }
+      if(r == count){
+        if(count == KITTY_DELTA_MAXRECTS){
+          return -1;
+        }
+        rects[count].y = y;
+        rects[count].x = startx;
+        rects[count].leny = 1;
+        rects[count].lenx = x - startx;
+        ++count;
+      }
+    }
+  }
+  return count;
+}
+
+// write the pixels of |r| over the root frame of |ki|, using the same medium
+// and encoding as a full upload would.
+static int
+kitty_delta_write(fbuf* f, sprixel* s, const kittyimage* ki, const kittyrect* r,
+                  const uint32_t* data, int linesize, const blitterargs* bargs){
+  int py, px, pleny, plenx;
+  kitty_rect_pixels(ki, r, &py, &px, &pleny, &plenx);
+  kittyupload ku;
+  if(prep_upload(&ku, bargs, ki->level, pleny, plenx)){
+    return -1;
+  }
+  if(fbuf_printf(f, "\e_Ga=f,r=1,x=%d,y=%d,s=%d,v=%d,i=%u,X=1,%s",
+                 px, py, plenx, pleny, ki->imgid,
+                 upload_deflated(&ku) ? "o=z,q=2" : "q=2") < 0){
+    destroy_upload(&ku);
+    return -1;
+  }
+  const bool translucent = bargs->flags & NCVISUAL_OPTION_BLEND;
+  for(int y = py ; y < py + pleny ; ++y){
+    const uint32_t* line = data + (linesize / sizeof(*data)) * y + px;
+    uint32_t* dst = ku.map + ku.used / 4;
+    for(int x = 0 ; x < plenx ; ++x){
+      uint32_t pixel = line[x];
+      if(translucent){
+        ncpixel_set_a(&pixel, ncpixel_a(pixel) / 2);
+      }
+      if(rgba_trans_p(pixel, bargs->transcolor)){
+        ncpixel_set_a(&pixel, 0);
+      }
+      dst[x] = pixel;
+    }
+    ku.used += plenx * 4;
+  }
+  if(finalize_upload(&ku, f, s, bargs->flags & NCVISUAL_OPTION_THREADED)){
+    destroy_upload(&ku);
+    return -1;
+  }
+  return 0;
+}
+
+// the state of cell |ycell|/|xcell| in |data|, as write_kitty_data() would
+// determine it for an intact cell.
+static sprixcell_e
+kitty_cell_state(const kittyimage* ki, const uint32_t* data, int linesize,
+                 int ycell, int xcell){
+  const kittyrect r = { ycell, xcell, 1, 1, };
+  int py, px, pleny, plenx;
+  kitty_rect_pixels(ki, &r, &py, &px, &pleny, &plenx);
+  bool trans = false;
+  bool opaque = false;
+  for(int y = py ; y < py + pleny ; ++y){
+    const uint32_t* line = data + (linesize / sizeof(*data)) * y;
+    for(int x = px ; x < px + plenx ; ++x){
+      uint32_t pixel = line[x];
+      if(ki->flags & NCVISUAL_OPTION_BLEND){
+        ncpixel_set_a(&pixel, ncpixel_a(pixel) / 2);
+      }
+      if(rgba_trans_p(pixel, ki->transcolor)){
+        trans = true;
+      }else{
+        opaque = true;
+      }
+    }
+  }
+  if(trans && opaque){
+    return SPRIXCELL_MIXED_KITTY;
+  }
+  return trans ? SPRIXCELL_TRANSPARENT : SPRIXCELL_OPAQUE_KITTY;
+}
+
+// try to bring |s|'s inherited image up to date with |data| by writing only
+// the rectangles which changed to its glyph, updating |tam| to match. returns
+// 1 if the image was updated (possibly with no changes at all), 0 if it ought
+// be uploaded whole instead, or -1 on error. the auxvecs are left alone: the
+// image was uploaded by some other sprixel, so any wipe by |s| first uploads
+// a copy of its own (see kitty_image_detach()), rebuilding them.
+static int
+kitty_image_update(sprixel* s, tament* tam, const uint32_t* data, int linesize,
+                   int leny, int lenx, const blitterargs* bargs,
+                   kitty_graphics_e level){
+  kittyimage* ki = s->kimg;
+  if(!kitty_image_updatable(ki, s, leny, lenx, bargs, level)){
+    return 0;
+  }
+  kittyrect rects[KITTY_DELTA_MAXRECTS];
+  const int count = kitty_delta_rects(ki, data, linesize, rects);
+  if(count < 0){
+    loginfo("Too many changes to update image %u\n", ki->imgid);
+    return 0;
+  }
+  size_t cost = 0;
+  for(int r = 0 ; r < count ; ++r){
+    int py, px, pleny, plenx;
+    kitty_rect_pixels(ki, &rects[r], &py, &px, &pleny, &plenx);
+    cost += (size_t)pleny * plenx * 4 + KITTY_DELTA_RECTCOST;
+  }
+  if(cost * 2 > (size_t)leny * lenx * 4){
+    loginfo("Updating image %u would cost %zuB in %d rects\n", ki->imgid, cost, count);
+    return 0;
+  }
+  for(int r = 0 ; r < count ; ++r){
+    if(kitty_delta_write(&s->glyph, s, ki, &rects[r], data, linesize, bargs)){
+      return -1;
+    }
+  }
+  if(count){
+    // nobody else may now find the image by its old pixels
+    pthread_mutex_lock(&ki->cache->lock);
+    kitty_image_unlink(ki);
+    pthread_mutex_unlock(&ki->cache->lock);
+  }
+  const int cols = s->dimx;
+  for(int r = 0 ; r < count ; ++r){
+    int py, px, pleny, plenx;
+    kitty_rect_pixels(ki, &rects[r], &py, &px, &pleny, &plenx);
+    for(int y = py ; y < py + pleny ; ++y){
+      memcpy(ki->pixels + y * lenx + px, data + (linesize / sizeof(*data)) * y + px,
+             plenx * sizeof(*data));
+    }
+    for(int y = rects[r].y ; y < rects[r].y + rects[r].leny ; ++y){
+      for(int x = rects[r].x ; x < rects[r].x + rects[r].lenx ; ++x){
+        ki->states[y * cols + x] = kitty_cell_state(ki, data, linesize, y, x);
+      }
+    }
+  }
+  const int cells = s->dimy * s->dimx;
+  for(int i = 0 ; i < cells ; ++i){
+    tam[i].state = ki->states[i];
+  }
+  scrub_tam_boundaries(tam, leny, lenx, s->cellpxy, s->cellpxx);
+  for(int i = 0 ; i < cells ; ++i){
+    ki->states[i] = tam[i].state;
+  }
+  s->imgid = ki->imgid;
+  loginfo("Sprixel %u updated image %u with %d rects (%zuB)\n", s->id, ki->imgid, count, cost);
+  return 1;
+}
+
 // with t=z, we can reference the original frame, and say "redraw this region",
 // thus avoiding the need to carry the original data around in our auxvecs.
 int kitty_rebuild_selfref(sprixel* s, int ycell, int xcell, uint8_t* auxvec){
+  if(kitty_image_detach(s)){
+    return -1;
+  }
   if(init_sprixel_animation(s)){
     return -1;
   }
@@ -917,10 +1899,10 @@ int kitty_rebuild_selfref(sprixel* s, int ycell, int xcell, uint8_t* auxvec){
   const int xlen = xstart + s->cellpxx > s->pixx ? s->pixx - xstart : s->cellpxx;
   const int ylen = ystart + s->cellpxy > s->pixy ? s->pixy - ystart : s->cellpxy;
   logdebug("rematerializing %u at %d/%d (%dx%d)\n", s->id, ycell, xcell, ylen, xlen);
-  fbuf_printf(f, "\e_Ga=c,x=%d,y=%d,X=%d,Y=%d,w=%d,h=%d,i=%d,r=1,c=2,q=2;\x1b\\",
+  fbuf_printf(f, "\e_Ga=c,x=%d,y=%d,X=%d,Y=%d,w=%d,h=%d,i=%u,r=1,c=2,q=2;\x1b\\",
               xcell * s->cellpxx, ycell * s->cellpxy,
               xcell * s->cellpxx, ycell * s->cellpxy,
-              xlen, ylen, s->id);
+              xlen, ylen, s->imgid);
   const int tyx = xcell + ycell * s->dimx;
   memcpy(&s->n->tam[tyx].state, auxvec, sizeof(s->n->tam[tyx].state));
   s->invalidated = SPRIXEL_INVALIDATED;
@@ -928,6 +1910,9 @@ int kitty_rebuild_selfref(sprixel* s, int ycell, int xcell, uint8_t* auxvec){
 }
 
 int kitty_rebuild_animation(sprixel* s, int ycell, int xcell, uint8_t* auxvec){
+  if(kitty_image_detach(s)){
+    return -1;
+  }
   if(init_sprixel_animation(s)){
     return -1;
   }
@@ -950,9 +1935,9 @@ int kitty_rebuild_animation(sprixel* s, int ycell, int xcell, uint8_t* auxvec){
   logdebug("placing %d/%d at %d/%d\n", ylen, xlen, ycell * s->cellpxy, xcell * s->cellpxx);
   while(chunks--){
     if(totalout == 0){
-      if(fbuf_printf(f, "\e_Ga=f,x=%d,y=%d,s=%d,v=%d,i=%d,X=1,r=1,%s;",
+      if(fbuf_printf(f, "\e_Ga=f,x=%d,y=%d,s=%d,v=%d,i=%u,X=1,r=1,%s;",
                      xcell * s->cellpxx, ycell * s->cellpxy, xlen, ylen,
-                     s->id, chunks ? "m=1" : "q=2") < 0){
+                     s->imgid, chunks ? "m=1" : "q=2") < 0){
         return -1;
       }
     }else{
@@ -1056,11 +2041,51 @@ kitty_blit_core(ncplane* n, int linesize, const void* data, int leny, int lenx,
     }
     memset(tam, 0, sizeof(*tam) * rows * cols);
   }
+  kittycache* kc = bargs->u.pixel.kittycache;
+  const bool cacheable = kitty_cacheable(kc, tam, reuse, rows * cols, leny, lenx, level);
+  // we might have inherited the image of the sprixel we're replacing
+  if(s->kimg){
+    if(cacheable && reuse){
+      int r = kitty_image_update(s, tam, data, linesize, leny, lenx, bargs, level);
+      if(r < 0){
+        goto error;
+      }else if(r > 0){
+        if(plane_blit_sixel(s, &s->glyph, leny, lenx, 0, tam, SPRIXEL_UNSEEN) < 0){
+          goto error;
+        }
+        return 1;
+      }
+    }
+    kitty_release_image(s);
+  }
+  uint64_t hash = 0;
+  if(cacheable){
+    hash = kitty_rgba_hash(data, linesize, leny, lenx);
+    kittyimage* ki = kitty_image_lookup(kc, hash, data, linesize, leny, lenx,
+                                        s, bargs, level);
+    if(ki){
+      loginfo("Sprixel %u places cached image %u\n", s->id, ki->imgid);
+      s->kimg = ki;
+      s->imgid = ki->imgid;
+      for(int i = 0 ; i < rows * cols ; ++i){
+        tam[i].state = ki->states[i];
+      }
+      if(plane_blit_sixel(s, &s->glyph, leny, lenx, 0, tam, SPRIXEL_UNSEEN) < 0){
+        goto error;
+      }
+      return 1;
+    }
+  }
+  // a fresh upload goes out under our own id
+  s->imgid = s->id;
   fbuf* f = &s->glyph;
   if(write_kitty_data(f, linesize, leny, lenx, cols, data,
                       bargs, tam, &parse_start, level)){
     goto error;
   }
+  if(cacheable){
+    kitty_image_insert(kc, s, hash, data, linesize, leny, lenx, tam, bargs, level);
+  }
   if(level == KITTY_ALWAYS_SCROLLS){
     s->animating = false;
   }
@@ -1074,6 +2099,9 @@ error:
   if(!reuse){
     free(tam);
   }
+  kitty_release_media(s);
+  kitty_release_image(s);
+  s->imgid = s->id;
   fbuf_free(&s->glyph);
   return -1;
 }
@@ -1096,9 +2124,11 @@ int kitty_blit_selfref(ncplane* n, int linesize, const void* data,
                          KITTY_SELFREF);
 }
 
-int kitty_remove(int id, fbuf* f){
-  loginfo("Removing graphic %u\n", id);
-  if(fbuf_printf(f, "\e_Ga=d,d=i,i=%d\e\\", id) < 0){
+// each sprixel places its image with its own id as the placement id, so we
+// can remove it without disturbing any other placements of a shared image.
+int kitty_remove(int id, int imgid, fbuf* f){
+  loginfo("Removing graphic %u (image %u)\n", id, imgid);
+  if(fbuf_printf(f, "\e_Ga=d,d=i,i=%d,p=%d\e\\", imgid, id) < 0){
     return -1;
   }
   return 0;
@@ -1146,15 +2176,26 @@ int kitty_draw(const tinfo* ti, const ncpile* p, sprixel* s, fbuf* f,
     s->animating = false;
     animated = true;
   }
-  int ret = s->glyph.used;
+  int ret = 0;
+  // a shared image's upload must precede anything in our glyph
+  if(s->kimg){
+    ret = kitty_image_draw(s->kimg, f);
+  }
   logdebug("Writing out %zub for %u\n", s->glyph.used, s->id);
-  if(ret){
+  if(ret >= 0 && s->glyph.used){
     if(fbuf_putn(f, s->glyph.buf, s->glyph.used) < 0){
       ret = -1;
+    }else{
+      ret += s->glyph.used;
     }
   }
   if(animated){
     fbuf_free(&s->glyph);
+    if(ret < 0){
+      kitty_release_media(s);
+    }else{
+      forget_media(s);
+    }
   }
   s->invalidated = SPRIXEL_LOADED;
   return ret;
@@ -1165,7 +2206,7 @@ int kitty_move(sprixel* s, fbuf* f, unsigned noscroll){
   int ret = 0;
   if(goto_location(ncplane_notcurses(s->n), f, s->n->absy, s->n->absx)){
     ret = -1;
-  }else if(fbuf_printf(f, "\e_Ga=p,i=%d,p=1,q=2%s\e\\", s->id,
+  }else if(fbuf_printf(f, "\e_Ga=p,i=%u,p=%u,q=2%s\e\\", s->imgid, s->id,
                        noscroll ? ",C=1" : "") < 0){
     ret = -1;
   }
@@ -0,0 +1,186 @@
+#ifndef NOTCURSES_KITTYZ
+#define NOTCURSES_KITTYZ
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// piecewise deflate of kitty uploads through the tty (o=z). kept in a header
+// of its own (and free of the rest of the library) so the tester can check
+// its streams against inflate().
+
+#include <zlib.h>
+#include <time.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+// each piece after the first is primed with this much of the preceding input
+#define KITTY_ZDICTLEN 32768
+
+// one piece of a deflate. pieces are compressed independently as raw deflate
+// streams, each ending on a byte boundary (Z_SYNC_FLUSH) save the last, which
+// finishes the stream. concatenated, they form a single deflate stream. each
+// piece is primed with the input preceding it, so the split costs us little.
+typedef struct kittyzpiece {
+  const unsigned char* src; // input (the dictionary precedes it)
+  size_t len;               // bytes of input
+  size_t dictlen;           // bytes of dictionary
+  int level;
+  bool last;                // finish the stream
+  unsigned char* out;       // output
+  size_t outcap;            // space available at out
+  size_t outlen;            // bytes written to out
+  uLong adler;              // adler32 of the input
+  uint64_t cpuns;           // cpu time spent by the deflating thread
+  int ret;                  // 0 on success, otherwise a zlib error
+  bool launched;
+  pthread_t tid;
+} kittyzpiece;
+
+static inline uint64_t
+kittyz_thread_ns(void){
+  struct timespec ts;
+  if(clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts)){
+    return 0;
+  }
+  return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static inline void*
+kittyzpiece_thread(void* vpiece){
+  kittyzpiece* p = (kittyzpiece*)vpiece;
+  const uint64_t t0 = kittyz_thread_ns();
+  z_stream zctx;
+  memset(&zctx, 0, sizeof(zctx));
+  int zret = deflateInit2(&zctx, p->level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY);
+  if(zret != Z_OK){
+    p->ret = zret;
+    return NULL;
+  }
+  if(p->dictlen){
+    if((zret = deflateSetDictionary(&zctx, p->src - p->dictlen, p->dictlen)) != Z_OK){
+      p->ret = zret;
+      deflateEnd(&zctx);
+      return NULL;
+    }
+  }
+  zctx.next_in = (Bytef*)p->src;
+  zctx.avail_in = p->len;
+  zctx.next_out = p->out;
+  zctx.avail_out = p->outcap;
+  zret = deflate(&zctx, p->last ? Z_FINISH : Z_SYNC_FLUSH);
+  if(zret != (p->last ? Z_STREAM_END : Z_OK) || zctx.avail_in || !zctx.avail_out){
+    p->ret = zret == Z_OK || zret == Z_STREAM_END ? Z_BUF_ERROR : zret;
+    deflateEnd(&zctx);
+    return NULL;
+  }
+  p->outlen = p->outcap - zctx.avail_out;
+  p->adler = adler32(adler32(0, NULL, 0), p->src, p->len);
+  deflateEnd(&zctx);
+  p->cpuns = kittyz_thread_ns() - t0;
+  p->ret = 0;
+  return NULL;
+}
+
+// compress |len| bytes of |src| at |level| into a zlib stream, splitting the
+// work across |count| pieces, all but the first of which get threads of their
+// own. returns a heap-allocated buffer, writing its length to |*outlen|, and
+// the cpu time spent across all pieces to |*cpuns|, or NULL on error.
+static inline unsigned char*
+kitty_deflate_pieces(const unsigned char* src, size_t len, int level, int count,
+                     size_t* outlen, uint64_t* cpuns){
+  if(len == 0 || len > UINT_MAX / 2 || count < 1){
+    return NULL;
+  }
+  if((size_t)count > len){
+    count = len;
+  }
+  kittyzpiece* pieces = (kittyzpiece*)malloc(sizeof(*pieces) * count);
+  if(pieces == NULL){
+    return NULL;
+  }
+  // each piece gets its own region of the output, which we compact once
+  // they're all done. we need a 2-byte zlib header and 4-byte trailer.
+  size_t cap = 2 + 4;
+  for(int i = 0 ; i < count ; ++i){
+    kittyzpiece* p = &pieces[i];
+    size_t start = len / count * i;
+    p->src = src + start;
+    p->len = i + 1 == count ? len - start : len / count;
+    p->dictlen = start < KITTY_ZDICTLEN ? start : KITTY_ZDICTLEN;
+    p->level = level;
+    p->last = (i + 1 == count);
+    // compressBound() covers a zlib stream; leave room for the sync marker
+    p->outcap = compressBound(p->len) + 16;
+    p->outlen = 0;
+    p->cpuns = 0;
+    p->ret = Z_STREAM_ERROR;
+    p->launched = false;
+    cap += p->outcap;
+  }
+  unsigned char* out = (unsigned char*)malloc(cap);
+  if(out == NULL){
+    free(pieces);
+    return NULL;
+  }
+  size_t off = 2;
+  for(int i = 0 ; i < count ; ++i){
+    pieces[i].out = out + off;
+    off += pieces[i].outcap;
+  }
+  // run the first piece on the calling thread. if a thread can't be
+  // launched, its piece runs here.
+  for(int i = 1 ; i < count ; ++i){
+    if(pthread_create(&pieces[i].tid, NULL, kittyzpiece_thread, &pieces[i]) == 0){
+      pieces[i].launched = true;
+    }else{
+      kittyzpiece_thread(&pieces[i]);
+    }
+  }
+  kittyzpiece_thread(&pieces[0]);
+  int ret = 0;
+  *cpuns = 0;
+  for(int i = 0 ; i < count ; ++i){
+    if(pieces[i].launched){
+      pthread_join(pieces[i].tid, NULL);
+    }
+    if(pieces[i].ret){
+      ret = -1;
+    }
+    *cpuns += pieces[i].cpuns;
+  }
+  if(ret){
+    free(pieces);
+    free(out);
+    return NULL;
+  }
+  // zlib header: 32KiB window, deflate, default compression, no dictionary
+  out[0] = 0x78;
+  out[1] = 0x9c;
+  off = 2;
+  uLong adler = pieces[0].adler;
+  for(int i = 0 ; i < count ; ++i){
+    memmove(out + off, pieces[i].out, pieces[i].outlen);
+    off += pieces[i].outlen;
+    if(i){
+      adler = adler32_combine(adler, pieces[i].adler, pieces[i].len);
+    }
+  }
+  out[off++] = adler >> 24u;
+  out[off++] = adler >> 16u;
+  out[off++] = adler >> 8u;
+  out[off++] = adler;
+  free(pieces);
+  *outlen = off;
+  return out;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -28,12 +28,158 @@ puttext_advance_line(ncplane* n){
   return 0;
 }
 
-// put up to a line of text down at the current cursor position. returns the
-// number of columns consumed, or -1 on error. the number of bytes consumed is
-// added to '*bytes', if 'bytes' is not NULL. any alignment is done relative to
-// the current cursor position. any line-breaking character will immediately
-// end the output, and move the cursor to the beginning of the next row. on an
-// error, '*bytes' is not updated, and nothing is printed.
+// text is analyzed into tokens, each being a run of codepoints which are
+// neither word- nor line-breaking, or a single breaking codepoint. lines are
+// filled from tokens, rather than codepoints, except when a word must be split.
+#define LAYOUT_WORD    0 // run of ordinary codepoints
+#define LAYOUT_SPACE   1 // a single wordbreaker
+#define LAYOUT_NEWLINE 2 // a single linebreaker
+
+typedef struct layout_token {
+  uint32_t bytes;
+  uint32_t cols;     // columns, counting nonprinting codepoints as 0
+  unsigned kind;
+} layout_token;
+
+// the outcome of filling a single row
+typedef struct layout_line {
+  size_t offset;     // byte offset of the line's text
+  uint32_t printed;  // bytes to print
+  uint32_t consumed; // bytes consumed, including any linebreaker
+  int cols;          // columns read, used for alignment
+  int colsreturn;    // columns reported as written
+  bool print;        // call ncplane_putline(), even for 0 bytes
+  bool advance;      // move to the next row afterwards
+} layout_line;
+
+// a position within the tokens, possibly in the middle of a word
+typedef struct layout_pos {
+  size_t offset;     // byte offset into the text
+  unsigned tok;      // current token
+  uint32_t skip;     // bytes of the current token already consumed
+  uint32_t skipcols; // columns of the current token already consumed
+} layout_pos;
+
+// a layout holds the text, its tokens, and the lines as most recently filled
+// for some geometry. lines never cross a linebreaker, so the lines of all
+// but the last (unterminated) paragraph survive nclayout_append().
+typedef struct nclayout {
+  char* text;              // NUL-terminated; borrowed if 'alloc' is 0
+  size_t len;              // bytes of text, not including the NUL
+  size_t alloc;            // bytes allocated for text
+  layout_token* tokens;
+  unsigned tokcount, tokalloc;
+  size_t paraoff;          // byte offset of the last, unterminated paragraph
+  unsigned paratok;        // index of its first token
+  layout_line* rows;
+  unsigned rowcount, rowalloc;
+  int rowdimx, rowcursx;   // geometry of 'rows', -1 if they're invalid
+  layout_pos resume;       // where filling lines resumes
+  bool rowsdone;           // 'rows' run through the end of text
+  bool stuck;              // the final line can't make progress
+} nclayout;
+
+// classify the codepoint at 'text', writing its length, columns, and token
+// kind. returns -1 on invalid UTF-8.
+static inline int
+layout_classify(const char* text, size_t avail, size_t* consumed, int* cols, unsigned* kind){
+  const unsigned char c = *text;
+  if(c < 0x80){
+    *consumed = 1;
+    *cols = (c >= 0x20 && c < 0x7f);
+    if(c == '\n' || c == '\v' || c == '\f'){
+      *kind = LAYOUT_NEWLINE;
+    }else if(c == ' '){
+      *kind = LAYOUT_SPACE;
+    }else{
+      *kind = LAYOUT_WORD;
+    }
+    return 0;
+  }
+  mbstate_t mbstate = {};
+  wchar_t w;
+  *consumed = mbrtowc(&w, text, avail, &mbstate);
+  if(*consumed == (size_t)-2 || *consumed == (size_t)-1 || *consumed == 0){
+    return -1;
+  }
+  int props = ucs_props(w);
+  *cols = props < 0 ? wcwidth(w) : (props & 0x3) - 1;
+  if(*cols < 0){
+    *cols = 0; // FIXME
+  }
+  if(islinebreak(w)){
+    *kind = LAYOUT_NEWLINE;
+  }else if(iswordbreak(w)){
+    *kind = LAYOUT_SPACE;
+  }else{
+    *kind = LAYOUT_WORD;
+  }
+  return 0;
+}
+
+static int
+layout_push_token(nclayout* l, unsigned kind, uint32_t bytes, uint32_t cols){
+  if(l->tokcount == l->tokalloc){
+    unsigned newalloc = l->tokalloc ? l->tokalloc * 2 : 64;
+    layout_token* tmp = realloc(l->tokens, sizeof(*tmp) * newalloc);
+    if(tmp == NULL){
+      return -1;
+    }
+    l->tokens = tmp;
+    l->tokalloc = newalloc;
+  }
+  layout_token* t = &l->tokens[l->tokcount++];
+  t->kind = kind;
+  t->bytes = bytes;
+  t->cols = cols;
+  return 0;
+}
+
+// tokenize the text from the start of the last paragraph through its end.
+static int
+layout_tokenize(nclayout* l){
+  size_t off = l->paraoff;
+  l->tokcount = l->paratok;
+  uint32_t wbytes = 0, wcols = 0; // word being accumulated
+  while(off < l->len){
+    size_t consumed;
+    unsigned kind;
+    int cols;
+    if(layout_classify(l->text + off, l->len - off, &consumed, &cols, &kind)){
+      logerror("Invalid UTF-8 after %zu bytes\n", off);
+      return -1;
+    }
+    off += consumed;
+    if(kind == LAYOUT_WORD){
+      wbytes += consumed;
+      wcols += cols;
+      continue;
+    }
+    if(wbytes){
+      if(layout_push_token(l, LAYOUT_WORD, wbytes, wcols)){
+        return -1;
+      }
+      wbytes = wcols = 0;
+    }
+    if(layout_push_token(l, kind, consumed, cols)){
+      return -1;
+    }
+    if(kind == LAYOUT_NEWLINE){
+      l->paraoff = off;
+      l->paratok = l->tokcount;
+    }
+  }
+  if(wbytes){
+    if(layout_push_token(l, LAYOUT_WORD, wbytes, wcols)){
+      return -1;
+    }
+  }
+  return 0;
+}
+
+// fill a line of 'dimx' columns, starting at column 'cursx' and position
+// 'pos' (which is advanced past the consumed text). this is a row of output
+// from ncplane_puttext():
 //
 // an input with C columns available on the row can be one of a few things:
 //  * text wholly within C columns -- print it, advance x
@@ -45,111 +191,185 @@ puttext_advance_line(ncplane* n){
 //      * leading whitespace? dump it, ++y, x = 0
 //      * C == dimx: print through C, ++y, x = 0
 //      * C < dimx: ++y, x = 0
-static int
-puttext_line(ncplane* n, ncalign_e align, const char* text, size_t* bytes){
-  int cursx; // current cursor location
-  ncplane_cursor_yx(n, NULL, &cursx);
-  const int dimx = ncplane_dim_x(n);
+static void
+layout_fill_line(const nclayout* l, int dimx, int cursx, layout_pos* pos,
+                 layout_line* line){
   const int avail = dimx - cursx - 1;
-//fprintf(stderr, "LINE %d starts at %d, len %d, avail %d\n", n->y, cursx, dimx, avail);
-  int bytes_leading_ws;    // bytes thus far of leading whitespace
-  int cols_leading_ws;     // cols thus far of leading whitespace
-  int bytes_leading_break; // bytes through last wordbreaker, 0 for no break yet
-  int cols_leading_break;  // cols through last wordbreaker, 0 for no break yet
-  int cols = 0;            // columns consumed thus far, cols > cols_leading_ws -> got_glyph
-  int b = 0;               // bytes consumed thus far
-  bytes_leading_ws = cols_leading_ws = 0;
-  bytes_leading_break = cols_leading_break = 0;
-  while(cols <= avail){    // we can print everything we've read, if desired
-    mbstate_t mbstate = {};
-    wchar_t w;
-    const size_t consumed = mbrtowc(&w, text + b, MB_CUR_MAX, &mbstate);
-    if(consumed == (size_t)-2 || consumed == (size_t)-1){
-      logerror("Invalid UTF-8 after %d bytes\n", b);
-      return -1;
-    }
-//fprintf(stderr, "converted [%s] -> %lc\n", text + b, w);
-    if(consumed == 0){ // text was wholly within destination row, print it
-      if(ncplane_putline(n, align, cols, text, b) < 0){
-        return -1;
-      }
-      if(bytes){
-        *bytes = b;
-      }
-      return cols;
-    }
-    // if w is a linebreaker, print what we have, advance, and return
-    if(islinebreak(w)){
-//fprintf(stderr, "LINEBREAK at %d/%d\n", n->y, n->x);
-      if(b){
-        if(ncplane_putline(n, align, cols, text, b) < 0){
-          return -1;
-        }
-      }
-      if(puttext_advance_line(n)){
-        return -1;
-      }
-      if(bytes){
-        *bytes += b + consumed;
-      }
-      return cols;
+  layout_pos p = *pos;
+  layout_pos atbreak = p, atws = p;
+  uint32_t bytes_leading_ws = 0;    // bytes thus far of leading whitespace
+  int cols_leading_ws = 0;          // cols thus far of leading whitespace
+  uint32_t bytes_leading_break = 0; // bytes through last wordbreaker, 0 for no break yet
+  int cols_leading_break = 0;       // cols through last wordbreaker, 0 for no break yet
+  int cols = 0;                     // columns consumed thus far, cols > cols_leading_ws -> got_glyph
+  uint32_t b = 0;                   // bytes consumed thus far
+  line->offset = pos->offset;
+  line->print = true;
+  while(cols <= avail){ // we can print everything we've read, if desired
+    if(p.tok == l->tokcount){ // text was wholly within destination row
+      line->printed = line->consumed = b;
+      line->cols = line->colsreturn = cols;
+      line->advance = false;
+      *pos = p;
+      return;
     }
-    b += consumed;
-    int width = wcwidth(w);
-    if(width < 0){
-      width = 0; // FIXME
+    const layout_token* t = &l->tokens[p.tok];
+    if(t->kind == LAYOUT_NEWLINE){ // print what we have, and advance
+      line->printed = b;
+      line->consumed = b + t->bytes;
+      line->cols = line->colsreturn = cols;
+      line->print = b;
+      line->advance = true;
+      p.offset += t->bytes;
+      ++p.tok;
+      *pos = p;
+      return;
     }
-    cols += width;
-    if(iswordbreak(w)){
+    if(t->kind == LAYOUT_SPACE){
+      b += t->bytes;
+      cols += t->cols;
+      p.offset += t->bytes;
+      ++p.tok;
       if(cols > cols_leading_ws){
         bytes_leading_break = b;
         cols_leading_break = cols;
+        atbreak = p;
       }else{
         bytes_leading_ws = b;
         cols_leading_ws = cols;
+        atws = p;
       }
+      continue;
+    }
+    const uint32_t wbytes = t->bytes - p.skip;
+    const int wcols = t->cols - p.skipcols;
+    if(cols + wcols <= avail){ // the entire word fits
+      b += wbytes;
+      cols += wcols;
+      p.offset += wbytes;
+      p.skip = p.skipcols = 0;
+      ++p.tok;
+      continue;
+    }
+    // the word doesn't fit; find the codepoint at which we overflow. the text
+    // was already validated, so this can't fail.
+    while(cols <= avail){
+      size_t consumed = 1;
+      unsigned kind;
+      int w = 0;
+      layout_classify(l->text + p.offset, l->len - p.offset, &consumed, &w, &kind);
+      b += consumed;
+      cols += w;
+      p.offset += consumed;
+      p.skip += consumed;
+      p.skipcols += w;
     }
-//fprintf(stderr, "%d approved [%lc] (tbytes: %d tcols: %d)\n", n->y, w, b, cols);
   }
-  int colsreturn = 0;
+  line->cols = cols;
+  line->advance = true;
   if(bytes_leading_break){
-    if(ncplane_putline(n, align, cols, text, bytes_leading_break) < 0){
+    line->printed = line->consumed = bytes_leading_break;
+    line->colsreturn = cols_leading_break;
+    *pos = atbreak;
+  }else if(bytes_leading_ws){
+    line->printed = line->consumed = bytes_leading_ws;
+    line->colsreturn = cols_leading_ws;
+    *pos = atws;
+  }else if(cols == dimx){
+    line->printed = line->consumed = b;
+    line->colsreturn = cols;
+    *pos = p;
+  }else{
+    line->printed = line->consumed = 0;
+    line->colsreturn = 0;
+    line->print = false;
+  }
+}
+
+static int
+layout_push_line(nclayout* l, const layout_line* line){
+  if(l->rowcount == l->rowalloc){
+    unsigned newalloc = l->rowalloc ? l->rowalloc * 2 : 64;
+    layout_line* tmp = realloc(l->rows, sizeof(*tmp) * newalloc);
+    if(tmp == NULL){
       return -1;
     }
-    if(bytes){
-      *bytes += bytes_leading_break;
-    }
-    colsreturn = cols_leading_break;
-  }else if(bytes_leading_ws){
-    if(ncplane_putline(n, align, cols, text, bytes_leading_ws) < 0){
+    l->rows = tmp;
+    l->rowalloc = newalloc;
+  }
+  l->rows[l->rowcount++] = *line;
+  return 0;
+}
+
+// ensure the lines of 'l' are filled for 'dimx' columns, with the first row
+// starting at column 'cursx'. lines are reused when the geometry is unchanged.
+static int
+layout_fill(nclayout* l, int dimx, int cursx){
+  if(l->rowdimx != dimx || l->rowcursx != cursx){
+    l->rowcount = 0;
+    l->rowdimx = dimx;
+    l->rowcursx = cursx;
+    memset(&l->resume, 0, sizeof(l->resume));
+    l->rowsdone = false;
+    l->stuck = false;
+  }
+  while(!l->rowsdone){
+    layout_line line;
+    // only the very first row starts anywhere other than column 0
+    const int x = l->rowcount ? 0 : cursx;
+    layout_fill_line(l, dimx, x, &l->resume, &line);
+    if(layout_push_line(l, &line)){
+      l->rowdimx = -1; // don't trust a partial fill
       return -1;
     }
-    if(bytes){
-      *bytes += bytes_leading_ws;
+    // having advanced past the end of the text, there's nothing left to put
+    if(!line.advance || l->resume.offset == l->len){
+      l->rowsdone = true;
+    }else if(line.consumed == 0 && x == 0){
+      // we'll never fit this glyph, no matter how many rows we advance
+      l->rowsdone = true;
+      l->stuck = true;
     }
-    colsreturn = cols_leading_ws;
-  }else if(cols == dimx){
-    if(ncplane_putline(n, align, cols, text, b) < 0){
-      return -1;
+  }
+  return 0;
+}
+
+// write the lines of 'l' to 'n', starting at its current cursor.
+static int
+layout_emit(ncplane* n, ncalign_e align, nclayout* l, size_t* bytes){
+  if(layout_fill(l, ncplane_dim_x(n), n->x)){
+    return -1;
+  }
+  int totalcols = 0;
+  for(unsigned i = 0 ; i < l->rowcount ; ++i){
+    const layout_line* line = &l->rows[i];
+    if(line->print){
+      if(ncplane_putline(n, align, line->cols, l->text + line->offset, line->printed) < 0){
+        return -1;
+      }
     }
+    if(line->advance){
+      if(puttext_advance_line(n)){
+        return -1;
+      }
+    }
+    totalcols += line->colsreturn;
     if(bytes){
-      *bytes = b;
+      *bytes += line->consumed;
     }
-    colsreturn = cols;
   }
-//fprintf(stderr, "FELL OFF line %d after %d cols %dB returning %d\n", n->y, cols, b, colsreturn);
-  if(puttext_advance_line(n)){
+  if(l->stuck){
+    logerror("Couldn't fit text at %zu in %d columns\n",
+             l->rows[l->rowcount - 1].offset, l->rowdimx);
     return -1;
   }
-  return colsreturn;
+  return totalcols;
 }
 
-// FIXME probably best to use u8_wordbreaks() and get all wordbreaks at once...
 int ncplane_puttext(ncplane* n, int y, ncalign_e align, const char* text, size_t* bytes){
   if(bytes){
     *bytes = 0;
   }
-  int totalcols = 0;
   // text points to the text we have *not* yet output. at each step, we see
   // how much space we have available, and begin iterating from text. remember
   // the most recent linebreaker that we see. when we exhaust our line, print
@@ -159,25 +379,111 @@ int ncplane_puttext(ncplane* n, int y, ncalign_e align, const char* text, size_t
   // try moving to the next line first. FIXME this ought actually apply to all
   // alignments, which ought be taken relative to n->x. no change for
   // NCALIGN_RIGHT, but NCALIGN_CENTER needs explicitly handle it...
-  do{
-    if(y != -1){
-      if(ncplane_cursor_move_yx(n, y, -1)){
-        return -1;
-      }
+  if(y != -1){
+    if(ncplane_cursor_move_yx(n, y, -1)){
+      return -1;
     }
-    size_t linebytes = 0;
-    int cols = puttext_line(n, align, text, &linebytes);
-    if(cols < 0){
+  }
+  // a one-shot layout, borrowing the text
+  nclayout l = {
+    .text = (char*)text,
+    .len = strlen(text),
+    .rowdimx = -1,
+    .rowcursx = -1,
+  };
+  int ret = -1;
+  if(layout_tokenize(&l) == 0){
+    ret = layout_emit(n, align, &l, bytes);
+  }
+  free(l.tokens);
+  free(l.rows);
+  return ret;
+}
+
+nclayout* nclayout_create(const char* text){
+  nclayout* l = malloc(sizeof(*l));
+  if(l == NULL){
+    return NULL;
+  }
+  memset(l, 0, sizeof(*l));
+  l->rowdimx = l->rowcursx = -1;
+  if((l->text = malloc(BUFSIZ)) == NULL){
+    free(l);
+    return NULL;
+  }
+  l->alloc = BUFSIZ;
+  l->text[0] = '\0';
+  if(text && nclayout_append(l, text)){
+    nclayout_destroy(l);
+    return NULL;
+  }
+  return l;
+}
+
+int nclayout_append(nclayout* l, const char* text){
+  const size_t tlen = strlen(text);
+  if(tlen >= UINT32_MAX - l->len){
+    logerror("Can't lay out %zuB more than %zuB\n", tlen, l->len);
+    return -1;
+  }
+  if(l->len + tlen + 1 > l->alloc){
+    size_t newalloc = l->alloc * 2;
+    if(newalloc < l->len + tlen + 1){
+      newalloc = l->len + tlen + 1;
+    }
+    char* tmp = realloc(l->text, newalloc);
+    if(tmp == NULL){
       return -1;
     }
-    totalcols += cols;
-    if(bytes){
-      *bytes += linebytes;
+    l->text = tmp;
+    l->alloc = newalloc;
+  }
+  const size_t oldlen = l->len;
+  const size_t oldparaoff = l->paraoff;
+  const unsigned oldparatok = l->paratok;
+  memcpy(l->text + l->len, text, tlen + 1);
+  l->len += tlen;
+  if(layout_tokenize(l)){
+    // restore the prior text and its tokens, which we know to be valid
+    l->len = oldlen;
+    l->text[oldlen] = '\0';
+    l->paraoff = oldparaoff;
+    l->paratok = oldparatok;
+    layout_tokenize(l);
+    return -1;
+  }
+  // lines of the last paragraph (and the final, unadvanced line) must be
+  // refilled. lines of prior paragraphs are unaffected.
+  if(l->rowdimx >= 0 && !(l->stuck && l->rows[l->rowcount - 1].offset < oldparaoff)){
+    while(l->rowcount && l->rows[l->rowcount - 1].offset >= oldparaoff){
+      --l->rowcount;
     }
-    text += linebytes;
-//fprintf(stderr, "new cursor: %d/%d consumed: %zu\n", n->y, n->x, linebytes);
-    y = n->y;
-  }while(*text);
-  return totalcols;
+    l->resume.offset = oldparaoff;
+    l->resume.tok = oldparatok;
+    l->resume.skip = l->resume.skipcols = 0;
+    l->rowsdone = false;
+    l->stuck = false;
+  }
+  return 0;
 }
 
+int ncplane_putlayout(ncplane* n, int y, ncalign_e align, nclayout* l, size_t* bytes){
+  if(bytes){
+    *bytes = 0;
+  }
+  if(y != -1){
+    if(ncplane_cursor_move_yx(n, y, -1)){
+      return -1;
+    }
+  }
+  return layout_emit(n, align, l, bytes);
+}
+
+void nclayout_destroy(nclayout* l){
+  if(l){
+    free(l->text);
+    free(l->tokens);
+    free(l->rows);
+    free(l);
+  }
+}
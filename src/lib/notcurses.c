@@ -196,7 +196,7 @@ char* ncplane_at_cursor(ncplane* n, uint16_t* stylemask, uint64_t* channels){
 char* ncplane_at_yx(const ncplane* n, int y, int x, uint16_t* stylemask, uint64_t* channels){
   if(y < n->leny && x < n->lenx){
     if(y >= 0 && x >= 0){
-      const cell* yx = &n->fb[nfbcellidx(n, y, x)];
+      const cell* yx = ncplane_cell_peek_yx(n, y, x);
       // if we're the right side of a wide glyph, we return the main glyph
       if(nccell_wide_right_p(yx)){
         return ncplane_at_yx(n, y, x - 1, stylemask, channels);
@@ -230,7 +230,7 @@ int ncplane_at_cursor_cell(ncplane* n, nccell* c){
 int ncplane_at_yx_cell(ncplane* n, int y, int x, nccell* c){
   if(y < n->leny && x < n->lenx){
     if(y >= 0 && x >= 0){
-      nccell* targ = ncplane_cell_ref_yx(n, y, x);
+      const nccell* targ = ncplane_cell_peek_yx(n, y, x);
       if(nccell_duplicate(n, c, targ) == 0){
         // FIXME take base cell into account where necessary!
         return strlen(nccell_extended_gcluster(n, targ));
@@ -364,6 +364,44 @@ ncpile_destroy(ncpile* pile){
   }
 }
 
+nccell* ncplane_tile_alloc(const ncplane* n, int t){
+  const size_t tsize = sizeof(nccell) * ncplane_tilerows(n->leny, t) * n->lenx;
+  nccell* tile = calloc(1, tsize);
+  if(tile == NULL){
+    logerror("Error allocating tile %d (%zuB)\n", t, tsize);
+    return NULL;
+  }
+  n->tiles[t] = tile;
+  if(ncplane_pile_const(n)){
+    notcurses* nc = ncplane_pile_const(n)->nc;
+    pthread_mutex_lock(&nc->stats.lock);
+      nc->stats.s.fbbytes += tsize;
+    pthread_mutex_unlock(&nc->stats.lock);
+  }
+  return tile;
+}
+
+void ncplane_tiles_free(ncplane* n){
+  if(!ncplane_tiled_p(n)){
+    return;
+  }
+  size_t freed = 0;
+  const int tcount = ncplane_tilecount(n->leny);
+  for(int t = 0 ; t < tcount ; ++t){
+    if(n->tiles[t]){
+      freed += sizeof(nccell) * ncplane_tilerows(n->leny, t) * n->lenx;
+      free(n->tiles[t]);
+      n->tiles[t] = NULL;
+    }
+  }
+  if(freed && ncplane_pile(n)){
+    notcurses* nc = ncplane_notcurses(n);
+    pthread_mutex_lock(&nc->stats.lock);
+      nc->stats.s.fbbytes -= freed;
+    pthread_mutex_unlock(&nc->stats.lock);
+  }
+}
+
 void free_plane(ncplane* p){
   if(p){
     // ncdirect fakes an ncplane with no ->pile
@@ -371,8 +409,11 @@ void free_plane(ncplane* p){
       notcurses* nc = ncplane_notcurses(p);
       pthread_mutex_lock(&nc->stats.lock);
         --ncplane_notcurses(p)->stats.s.planes;
-        ncplane_notcurses(p)->stats.s.fbbytes -= sizeof(*p->fb) * p->leny * p->lenx;
+        if(!ncplane_tiled_p(p)){
+          ncplane_notcurses(p)->stats.s.fbbytes -= sizeof(*p->fb) * p->leny * p->lenx;
+        }
       pthread_mutex_unlock(&nc->stats.lock);
+      ncplane_tiles_free(p);
       if(p->above == NULL && p->below == NULL){
         pthread_mutex_lock(&nc->pilelock);
           ncpile_destroy(ncplane_pile(p));
@@ -391,9 +432,11 @@ void free_plane(ncplane* p){
       }
     }
     free(p->tam);
+    nchistory_free(p);
     egcpool_dump(&p->pool);
     free(p->name);
     free(p->fb);
+    free(p->tiles);
     free(p);
   }
 }
@@ -426,6 +469,7 @@ make_ncpile(notcurses* nc, ncplane* n){
     ret->crenderlen = 0;
     ret->sprixelcache = NULL;
     ret->scrolls = 0;
+    ret->rscrolls = 0;
   }
   return ret;
 }
@@ -444,7 +488,7 @@ make_ncpile(notcurses* nc, ncplane* n){
 // (as once more is n).
 ncplane* ncplane_new_internal(notcurses* nc, ncplane* n,
                               const ncplane_options* nopts){
-  if(nopts->flags >= (NCPLANE_OPTION_MARGINALIZED << 1u)){
+  if(nopts->flags >= (NCPLANE_OPTION_TILED << 1u)){
     logwarn("Provided unsupported flags %016jx\n", (uintmax_t)nopts->flags);
   }
   if(nopts->flags & NCPLANE_OPTION_HORALIGNED || nopts->flags & NCPLANE_OPTION_VERALIGNED){
@@ -469,6 +513,7 @@ ncplane* ncplane_new_internal(notcurses* nc, ncplane* n,
     return NULL;
   }
   p->scrolling = false;
+  p->history = NULL;
   p->fixedbound = nopts->flags & NCPLANE_OPTION_FIXED;
   if(nopts->flags & NCPLANE_OPTION_MARGINALIZED){
     p->margin_b = nopts->margin_b;
@@ -489,14 +534,27 @@ ncplane* ncplane_new_internal(notcurses* nc, ncplane* n,
     p->leny = nopts->rows;
     p->lenx = nopts->cols;
   }
-  size_t fbsize = sizeof(*p->fb) * (p->leny * p->lenx);
-  if((p->fb = malloc(fbsize)) == NULL){
-    logerror("Error allocating cellmatrix (r=%d, c=%d)\n",
-             p->leny, p->lenx);
-    free(p);
-    return NULL;
+  size_t fbsize = 0;
+  if(nopts->flags & NCPLANE_OPTION_TILED){
+    // tiles are accounted for in fbbytes as they're allocated
+    p->fb = NULL;
+    if((p->tiles = calloc(ncplane_tilecount(p->leny), sizeof(*p->tiles))) == NULL){
+      logerror("Error allocating tilematrix (r=%d, c=%d)\n",
+               p->leny, p->lenx);
+      free(p);
+      return NULL;
+    }
+  }else{
+    fbsize = sizeof(*p->fb) * (p->leny * p->lenx);
+    p->tiles = NULL;
+    if((p->fb = malloc(fbsize)) == NULL){
+      logerror("Error allocating cellmatrix (r=%d, c=%d)\n",
+               p->leny, p->lenx);
+      free(p);
+      return NULL;
+    }
+    memset(p->fb, 0, fbsize);
   }
-  memset(p->fb, 0, fbsize);
   p->x = p->y = 0;
   p->logrow = 0;
   p->sprite = NULL;
@@ -674,19 +732,36 @@ ncplane* ncplane_dup(const ncplane* n, void* opaque){
     .userptr = opaque,
     .name = n->name,
     .resizecb = ncplane_resizecb(n),
-    .flags = 0,
+    .flags = ncplane_tiled_p(n) ? NCPLANE_OPTION_TILED : 0,
   };
   ncplane* newn = ncplane_create(n->boundto, &nopts);
   if(newn == NULL){
     return NULL;
   }
   // we don't duplicate sprites...though i'm unsure why not
-  size_t fbsize = sizeof(*n->fb) * dimx * dimy;
   if(egcpool_dup(&newn->pool, &n->pool)){
     ncplane_destroy(newn);
     return NULL;
   }
-  memmove(newn->fb, n->fb, fbsize);
+  if(ncplane_tiled_p(n)){
+    // only copy those tiles which have been allocated
+    const int tcount = ncplane_tilecount(dimy);
+    for(int t = 0 ; t < tcount ; ++t){
+      if(n->tiles[t]){
+        nccell* tile = ncplane_tile_alloc(newn, t);
+        if(tile == NULL){
+          ncplane_destroy(newn);
+          return NULL;
+        }
+        memcpy(tile, n->tiles[t], sizeof(*tile) * ncplane_tilerows(dimy, t) * dimx);
+      }
+    }
+  }else{
+    size_t fbsize = sizeof(*n->fb) * dimx * dimy;
+    memmove(newn->fb, n->fb, fbsize);
+  }
+  // the framebuffer was copied verbatim, so its rotation must come along
+  newn->logrow = n->logrow;
   if(ncplane_cursor_move_yx(newn, n->y, n->x) < 0){
     ncplane_destroy(newn);
     return NULL;
@@ -712,6 +787,117 @@ int resize_callbacks_children(ncplane* n){
   return ret;
 }
 
+// free a detached tile array of a plane having 'leny' rows.
+static void
+free_tiles(nccell** tiles, int leny){
+  if(tiles){
+    const int tcount = ncplane_tilecount(leny);
+    for(int t = 0 ; t < tcount ; ++t){
+      free(tiles[t]);
+    }
+    free(tiles);
+  }
+}
+
+// build the tile array for tiled plane 'n' following a resize to 'ylen'x'xlen'
+// (the arguments are as to ncplane_resize_internal(), and have already been
+// validated). only destination rows having some retained content from an
+// allocated source tile get their tile allocated. the total size of the new
+// tiles is written to 'tbytes'. 'n' is not modified.
+static nccell**
+ncplane_resize_tiles(const ncplane* n, int keepy, int keepx, int keepleny,
+                     int keeplenx, int yoff, int xoff, int ylen, int xlen,
+                     size_t* tbytes){
+  nccell** tiles = calloc(ncplane_tilecount(ylen), sizeof(*tiles));
+  if(tiles == NULL){
+    return NULL;
+  }
+  *tbytes = 0;
+  if(keepleny == 0){
+    return tiles;
+  }
+  for(int itery = 0 ; itery < ylen ; ++itery){
+    const int sourceoffy = itery + keepy + yoff;
+    if(sourceoffy < keepy || sourceoffy >= keepy + keepleny){
+      continue;
+    }
+    const nccell* src = ncplane_row_peek(n, sourceoffy);
+    if(src == NULL){
+      continue;
+    }
+    const int t = itery / NCPLANE_TILEROWS;
+    if(tiles[t] == NULL){
+      const size_t tsize = sizeof(nccell) * ncplane_tilerows(ylen, t) * xlen;
+      if((tiles[t] = calloc(1, tsize)) == NULL){
+        free_tiles(tiles, ylen);
+        return NULL;
+      }
+      *tbytes += tsize;
+    }
+    nccell* dst = tiles[t] + fbcellidx(itery % NCPLANE_TILEROWS, xlen, 0);
+    // cells to the left of the retained region (xoff < 0) stay zeroed
+    memcpy(dst + (xoff < 0 ? -xoff : 0), src + keepx, sizeof(*dst) * keeplenx);
+  }
+  return tiles;
+}
+
+// rearrange the framebuffer of untiled plane 'n' in place for a resize to
+// 'ylen'x'xlen', retaining rows keepy..keepy + keepleny - 1 and columns
+// 0..keeplenx - 1 where they are, and zeroing everything else. 'n->fb' must
+// already be large enough for both geometries. either the width must be
+// unchanged, or 'n->logrow' must be 0. when only the rows change, the
+// circular layout is preserved, moving at most those rows on the far side of
+// 'n->logrow'. updates the geometry of 'n'.
+static void
+ncplane_resize_fb_inplace(ncplane* n, int keepy, int keepleny, int keeplenx,
+                          int ylen, int xlen){
+  const int rows = n->leny;
+  const int cols = n->lenx;
+  nccell* fb = n->fb;
+  if(xlen == cols){
+    const int upper = rows - n->logrow; // physical rows from logrow to the end
+    if(ylen < rows){
+      if(n->logrow + ylen <= rows){ // retained rows are physically contiguous
+        if(n->logrow){
+          memmove(fb, fb + n->logrow * cols, sizeof(*fb) * ylen * cols);
+          n->logrow = 0;
+        }
+      }else{ // move the upper rows to the end of the shrunken buffer
+        memmove(fb + (ylen - upper) * cols, fb + n->logrow * cols,
+                sizeof(*fb) * upper * cols);
+        n->logrow = ylen - upper;
+      }
+    }else if(ylen > rows && n->logrow){
+      // move the upper rows to the end of the grown buffer, leaving the new
+      // rows between them and the lower rows
+      memmove(fb + (n->logrow + ylen - rows) * cols, fb + n->logrow * cols,
+              sizeof(*fb) * upper * cols);
+      n->logrow += ylen - rows;
+    }
+  }else{
+    const int cprows = ylen < rows ? ylen : rows;
+    if(xlen < cols){
+      for(int y = 1 ; y < cprows ; ++y){
+        memmove(fb + y * xlen, fb + y * cols, sizeof(*fb) * xlen);
+      }
+    }else{
+      for(int y = cprows - 1 ; y > 0 ; --y){
+        memmove(fb + y * xlen, fb + y * cols, sizeof(*fb) * cols);
+      }
+    }
+  }
+  n->leny = ylen;
+  n->lenx = xlen;
+  for(int y = 0 ; y < ylen ; ++y){
+    nccell* row = fb + nfbcellidx(n, y, 0);
+    if(y < keepy || y >= keepy + keepleny){
+      memset(row, 0, sizeof(*row) * xlen);
+    }else if(keeplenx < xlen){
+      memset(row + keeplenx, 0, sizeof(*row) * (xlen - keeplenx));
+    }
+  }
+}
+
 // can be used on stdplane, unlike ncplane_resize() which prohibits it.
 int ncplane_resize_internal(ncplane* n, int keepy, int keepx, int keepleny,
                             int keeplenx, int yoff, int xoff, int ylen, int xlen){
@@ -765,10 +951,34 @@ int ncplane_resize_internal(ncplane* n, int keepy, int keepx, int keepleny,
   int oldarea = rows * cols;
   int keptarea = keepleny * keeplenx;
   int newarea = ylen * xlen;
-  size_t fbsize = sizeof(nccell) * newarea;
-  nccell* fb = malloc(fbsize);
-  if(fb == NULL){
-    return -1;
+  size_t fbsize = 0;
+  nccell* fb = NULL;
+  nccell** tiles = NULL;
+  // if the retained region stays put at the left edge, and the width doesn't
+  // change (or the rows don't wrap), the framebuffer can be resized in place.
+  const bool inplace = !ncplane_tiled_p(n) && keptarea && keepx == 0 &&
+                       xoff == 0 && keepy + yoff == 0 &&
+                       (xlen == cols || n->logrow == 0);
+  if(ncplane_tiled_p(n)){
+    if((tiles = ncplane_resize_tiles(n, keepy, keepx, keepleny, keeplenx,
+                                     yoff, xoff, ylen, xlen, &fbsize)) == NULL){
+      return -1;
+    }
+  }else if(inplace){
+    fbsize = sizeof(nccell) * newarea;
+    // grow now, while we can still fail. we shrink once rearranged.
+    if(newarea > oldarea){
+      nccell* tmp = realloc(n->fb, fbsize);
+      if(tmp == NULL){
+        return -1;
+      }
+      n->fb = tmp;
+    }
+  }else{
+    fbsize = sizeof(nccell) * newarea;
+    if((fb = malloc(fbsize)) == NULL){
+      return -1;
+    }
   }
   if(n->tam){
     loginfo("TAM realloc to %d entries\n", newarea);
@@ -776,6 +986,7 @@ int ncplane_resize_internal(ncplane* n, int keepy, int keepx, int keepleny,
     tament* tmptam = realloc(n->tam, sizeof(*tmptam) * newarea);
     if(tmptam == NULL){
       free(fb);
+      free_tiles(tiles, ylen);
       return -1;
     }
     n->tam = tmptam;
@@ -792,34 +1003,63 @@ int ncplane_resize_internal(ncplane* n, int keepy, int keepx, int keepleny,
   if(n->x >= xlen){
     n->x = xlen - 1;
   }
-  nccell* preserved = n->fb;
+  nccell* preserved = inplace ? NULL : n->fb;
+  if(tiles){
+    // the retained content was already copied by ncplane_resize_tiles()
+    ncplane_tiles_free(n);
+    free(n->tiles);
+    n->tiles = tiles;
+  }
   pthread_mutex_lock(&nc->stats.lock);
-    ncplane_notcurses(n)->stats.s.fbbytes -= sizeof(*preserved) * (rows * cols);
+    if(preserved || inplace){
+      ncplane_notcurses(n)->stats.s.fbbytes -= sizeof(nccell) * (rows * cols);
+    }
     ncplane_notcurses(n)->stats.s.fbbytes += fbsize;
   pthread_mutex_unlock(&nc->stats.lock);
-  n->fb = fb;
+  if(!inplace){
+    n->fb = fb;
+  }
   const int oldabsy = n->absy;
   // go ahead and move. we can no longer fail at this point. but don't yet
   // resize, because n->len[xy] are used in fbcellidx() in the loop below. we
   // don't use ncplane_move_yx(), because we want to planebinding-invariant.
+  // any view into history was laid out for the old geometry; return to live.
+  if(n->history){
+    nchistory_drop_view(n);
+    n->history->seek = 0;
+  }
   n->absy += keepy + yoff;
   n->absx += keepx + xoff;
 //fprintf(stderr, "absx: %d keepx: %d xoff: %d\n", n->absx, keepx, xoff);
   if(keptarea == 0){ // keep nothing, resize/move only
     // if we're keeping nothing, dump the old egcspool. otherwise, we go ahead
     // and keep it. perhaps we ought compact it?
-    memset(fb, 0, sizeof(*fb) * newarea);
+    if(fb){
+      memset(fb, 0, sizeof(*fb) * newarea);
+    }
     egcpool_dump(&n->pool);
     n->lenx = xlen;
     n->leny = ylen;
+    n->logrow = 0;
     free(preserved);
     return resize_callbacks_children(n);
   }
+  if(inplace){
+    ncplane_resize_fb_inplace(n, keepy, keepleny, keeplenx, ylen, xlen);
+    if(newarea < oldarea){
+      // if we can't shrink it, we can keep using the larger buffer
+      nccell* tmp = realloc(n->fb, fbsize);
+      if(tmp){
+        n->fb = tmp;
+      }
+    }
+    return resize_callbacks_children(n);
+  }
   // we currently have maxy rows of maxx cells each. we will be keeping rows
   // keepy..keepy + keepleny - 1 and columns keepx..keepx + keeplenx - 1.
   // anything else is zerod out. itery is the row we're writing *to*, and we
   // must write to each (and every cell in each).
-  for(int itery = 0 ; itery < ylen ; ++itery){
+  for(int itery = 0 ; fb && itery < ylen ; ++itery){
     int truey = itery + n->absy;
     int sourceoffy = truey - oldabsy;
 //fprintf(stderr, "sourceoffy: %d keepy: %d ylen: %d\n", sourceoffy, keepy, ylen);
@@ -848,6 +1088,8 @@ int ncplane_resize_internal(ncplane* n, int keepy, int keepx, int keepleny,
   }
   n->lenx = xlen;
   n->leny = ylen;
+  // the new framebuffer was laid out starting from the logical top row
+  n->logrow = 0;
   free(preserved);
   return resize_callbacks_children(n);
 }
@@ -1001,7 +1243,7 @@ notcurses* notcurses_core_init(const notcurses_options* opts, FILE* outfp){
     fprintf(stderr, "Provided an illegal negative margin, refusing to start\n");
     return NULL;
   }
-  if(opts->flags >= (NCOPTION_NO_FONT_CHANGES << 1u)){
+  if(opts->flags >= (NCOPTION_NO_KITTY_SHM << 1u)){
     fprintf(stderr, "Warning: unknown Notcurses options %016" PRIu64 "\n", opts->flags);
   }
   notcurses* ret = malloc(sizeof(*ret));
@@ -1083,6 +1325,7 @@ notcurses* notcurses_core_init(const notcurses_options* opts, FILE* outfp){
   loglevel = opts->loglevel;
   ret->rstate.logendy = -1;
   ret->rstate.logendx = -1;
+  ret->kittycache = NULL;
   ret->rstate.x = ret->rstate.y = -1;
   ret->suppress_banner = opts->flags & NCOPTION_SUPPRESS_BANNERS;
   int fakecursory, fakecursorx;
@@ -1093,6 +1336,7 @@ notcurses* notcurses_core_init(const notcurses_options* opts, FILE* outfp){
   if(interrogate_terminfo(&ret->tcache, opts->termtype, ret->ttyfp, utf8,
                           opts->flags & NCOPTION_NO_ALTERNATE_SCREEN, 0,
                           opts->flags & NCOPTION_NO_FONT_CHANGES,
+                          opts->flags & NCOPTION_NO_KITTY_SHM,
                           cursory, cursorx, &ret->stats)){
     fbuf_free(&ret->rstate.f);
     pthread_mutex_destroy(&ret->pilelock);
@@ -1116,6 +1360,9 @@ notcurses* notcurses_core_init(const notcurses_options* opts, FILE* outfp){
   if(ncvisual_init(ret->loglevel)){
     goto err;
   }
+  if((ret->kittycache = kitty_cache_create()) == NULL){
+    goto err;
+  }
   ret->stdplane = NULL;
   if((ret->stdplane = create_initial_ncplane(ret, dimy, dimx)) == NULL){
     logpanic("Couldn't create the initial plane (bad margins?)\n");
@@ -1189,6 +1436,7 @@ err:
   }
   drop_signals(ret);
   del_curterm(cur_term);
+  kitty_cache_free(ret->kittycache);
   pthread_mutex_destroy(&ret->stats.lock);
   pthread_mutex_destroy(&ret->pilelock);
   free(ret);
@@ -1268,6 +1516,7 @@ int notcurses_stop(notcurses* nc){
     ret |= pthread_mutex_destroy(&nc->stats.lock);
     ret |= pthread_mutex_destroy(&nc->pilelock);
     fbuf_free(&nc->rstate.f);
+    kitty_cache_free(nc->kittycache);
     free_terminfo_cache(&nc->tcache);
     free(nc);
   }
@@ -1474,33 +1723,98 @@ nccell_obliterate(ncplane* n, nccell* c){
   nccell_init(c);
 }
 
-// increment y by 1 and rotate the framebuffer up one line. x moves to 0. any
-// non-fixed bound planes move up 1 line if they intersect the plane.
-void scroll_down(ncplane* n){
+// a scrolling plane spanning the full width of its pile can be scrolled by
+// the terminal within a scrolling region, so long as it's the only such plane
+// scrolled this frame. anything else is simply redrawn.
+static void
+note_region_scroll(ncplane* n, int rotations){
+  ncpile* p = ncplane_pile(n);
+  if(p->rscrolls < 0){
+    return;
+  }
+  const int top = n->absy;
+  const int bot = n->absy + n->leny - 1;
+  if(n->absx || n->lenx != p->dimx || top < 0 || bot >= p->dimy){
+    return;
+  }
+  if(p->rscrolls == 0){
+    p->rscrolltop = top;
+    p->rscrollbot = bot;
+  }else if(p->rscrolltop != top || p->rscrollbot != bot){
+    p->rscrolls = -1;
+    return;
+  }
+  p->rscrolls += rotations;
+}
+
+// advance the cursor 'r' lines, as if by 'r' consecutive newlines. x moves to
+// 0. while y is short of the last row, it is incremented. each further line
+// rotates the framebuffer up one line, clearing the new last row. any
+// non-fixed bound planes move up one line per line scrolled, so long as they
+// intersect the plane. this is all done in one pass, regardless of 'r'.
+void scroll_lines(ncplane* n, int r){
 //fprintf(stderr, "pre-scroll: %d/%d %d/%d log: %d scrolling: %u\n", n->y, n->x, n->leny, n->lenx, n->logrow, n->scrolling);
   n->x = 0;
-  if(n->y == n->leny - 1){
+  int descend = n->leny - 1 - n->y;
+  if(descend > r){
+    descend = r;
+  }
+  n->y += descend;
+  const int rotations = r - descend;
+  if(rotations){
+    if(n->history){
+      // keep the view anchored on the same content while the plane scrolls
+      if(nchistory_append(n, rotations)){
+        logerror("Couldn't append %d rows to history\n", rotations);
+      }else if(n->history->seek){
+        n->history->seek += rotations;
+        nchistory_refresh(n);
+      }
+    }
     if(n == notcurses_stdplane(ncplane_notcurses(n))){
-      ncplane_pile(n)->scrolls++;
+      ncplane_pile(n)->scrolls += rotations;
+    }else{
+      note_region_scroll(n, rotations);
+    }
+    n->logrow = (n->logrow + rotations % n->leny) % n->leny;
+    // the last 'rotations' logical rows are the recycled ones, but there are
+    // only so many rows to clear, however far we've scrolled.
+    const int clears = rotations > n->leny ? n->leny : rotations;
+    for(int y = n->leny - clears ; y < n->leny ; ++y){
+      // the row was already zeroed if its tile was never allocated
+      nccell* row = ncplane_row_peek(n, y);
+      if(row){
+        for(int clearx = 0 ; clearx < n->lenx ; ++clearx){
+          nccell_release(n, &row[clearx]);
+        }
+        memset(row, 0, sizeof(*row) * n->lenx);
+      }
     }
-    n->logrow = (n->logrow + 1) % n->leny;
-    nccell* row = n->fb + nfbcellidx(n, n->y, 0);
-    for(int clearx = 0 ; clearx < n->lenx ; ++clearx){
-      nccell_release(n, &row[clearx]);
+    if(clears == n->leny){
+      ncplane_tiles_free(n); // everything was scrolled away
     }
-    memset(row, 0, sizeof(*row) * n->lenx);
-  }else{
-    ++n->y;
   }
   for(struct ncplane* c = n->blist ; c ; c = c->bnext){
     if(!c->fixedbound){
       if(ncplanes_intersect_p(n, c)){
-        ncplane_moverel(c, -1, 0);
+        // a child moves up one line per line scrolled, until its bottom
+        // passes above our top (at which point it no longer intersects us).
+        int moves = ncplane_abs_y(c) + ncplane_dim_y(c) - ncplane_abs_y(n);
+        if(moves > r){
+          moves = r;
+        }
+        ncplane_moverel(c, -moves, 0);
       }
     }
   }
 }
 
+// increment y by 1 and rotate the framebuffer up one line. x moves to 0. any
+// non-fixed bound planes move up 1 line if they intersect the plane.
+void scroll_down(ncplane* n){
+  scroll_lines(n, 1);
+}
+
 int ncplane_scrollup(ncplane* n, int r){
   if(!ncplane_scrolling_p(n)){
     logerror("can't scroll %d on non-scrolling plane\n", r);
@@ -1510,8 +1824,8 @@ int ncplane_scrollup(ncplane* n, int r){
     logerror("can't scroll %d lines\n", r);
     return -1;
   }
-  while(r-- > 0){
-    scroll_down(n);
+  if(r){
+    scroll_lines(n, r);
   }
   return 0;
 }
@@ -1602,22 +1916,26 @@ ncplane_put(ncplane* n, int y, int x, const char* egc, int cols,
   // that cell as wide). Any character placed atop one cell of a wide character
   // obliterates all cells. Note that a two-cell glyph can thus obliterate two
   // other two-cell glyphs, totalling four columns.
-  nccell* targ = ncplane_cell_ref_yx(n, n->y, n->x);
+  nccell* row = ncplane_row_ref(n, n->y);
+  if(row == NULL){
+    return -1;
+  }
+  nccell* targ = &row[n->x];
   // we're always starting on the leftmost cell of our output glyph. check the
   // target, and find the leftmost cell of the glyph it will be displacing.
   // obliterate as we go along.
   int idx = n->x;
   nccell* lmc = targ;
   while(nccell_wide_right_p(lmc)){
-    nccell_obliterate(n, &n->fb[nfbcellidx(n, n->y, idx)]);
-    lmc = ncplane_cell_ref_yx(n, n->y, --idx);
+    nccell_obliterate(n, &row[idx]);
+    lmc = &row[--idx];
   }
   // we're now on the leftmost cell of the target glyph.
   int twidth = nccell_cols(lmc);
   nccell_release(n, lmc);
   twidth -= n->x - idx;
   while(--twidth > 0){
-    nccell_obliterate(n, &n->fb[nfbcellidx(n, n->y, n->x + twidth)]);
+    nccell_obliterate(n, &row[n->x + twidth]);
   }
   targ->stylemask = stylemask;
   targ->channels = channels;
@@ -1628,11 +1946,11 @@ ncplane_put(ncplane* n, int y, int x, const char* egc, int cols,
   // must set our right hand sides wide, and check for further damage
   ++n->x;
   for(int i = 1 ; i < cols ; ++i){
-    nccell* candidate = &n->fb[nfbcellidx(n, n->y, n->x)];
+    nccell* candidate = &row[n->x];
     int off = nccell_cols(candidate);
-    nccell_release(n, &n->fb[nfbcellidx(n, n->y, n->x)]);
+    nccell_release(n, candidate);
     while(--off > 0){
-      nccell_obliterate(n, &n->fb[nfbcellidx(n, n->y, n->x + off)]);
+      nccell_obliterate(n, &row[n->x + off]);
     }
     candidate->channels = targ->channels;
     candidate->stylemask = targ->stylemask;
@@ -1648,6 +1966,103 @@ int ncplane_putc_yx(ncplane* n, int y, int x, const nccell* c){
   return ncplane_put(n, y, x, egc, cols, c->stylemask, c->channels, strlen(egc));
 }
 
+// a span of cells written to 'row' starting at column 'x' partially overwrites
+// any glyph it begins within. obliterate that glyph's leftward remainder.
+static inline void
+obliterate_span_left(ncplane* n, nccell* row, int x){
+  int idx = x;
+  while(idx > 0 && nccell_wide_right_p(&row[idx])){
+    --idx;
+  }
+  while(idx < x){
+    nccell_obliterate(n, &row[idx++]);
+  }
+}
+
+// a span of cells written to 'row' ending just before column 'x' partially
+// overwrites any glyph it ends within. obliterate that glyph's remainder.
+static inline void
+obliterate_span_right(ncplane* n, nccell* row, int x){
+  while(x < n->lenx && nccell_wide_right_p(&row[x])){
+    nccell_obliterate(n, &row[x++]);
+  }
+}
+
+int ncplane_putcells_yx(ncplane* n, int y, int x, const nccell* cells, unsigned len){
+  if(n->sprite){
+    logerror("Can't write cells to sprixelated plane\n");
+    return -1;
+  }
+  // validate the entire span before touching the plane. we needn't check
+  // anything per-cell beyond control characters.
+  int cols = 0;
+  for(unsigned i = 0 ; i < len ; ++i){
+    const nccell* c = &cells[i];
+    if(nccell_wide_right_p(c)){
+      continue;
+    }
+    if(!cell_extended_p(c)){
+      const unsigned char* egc = (const unsigned char*)&c->gcluster;
+      if(is_control_egc(egc, strnlen((const char*)egc, sizeof(c->gcluster)))){
+        logerror("Rejecting control character in cell %u\n", i);
+        return -1;
+      }
+    }
+    cols += nccell_cols(c);
+  }
+  if(x == -1){
+    x = n->x;
+  }
+  if(x + cols > n->lenx){
+    logerror("Target x %d + %d cols > length %d\n", x, cols, n->lenx);
+    return -1;
+  }
+  if(ncplane_cursor_move_yx(n, y, x)){
+    return -1;
+  }
+  nccell* row = ncplane_row_ref(n, n->y);
+  if(row == NULL){
+    return -1;
+  }
+  // the span overwrites every cell it covers, so only the glyphs straddling
+  // its edges need be obliterated.
+  obliterate_span_left(n, row, n->x);
+  for(unsigned i = 0 ; i < len ; ++i){
+    const nccell* c = &cells[i];
+    if(nccell_wide_right_p(c)){
+      continue;
+    }
+    const int ccols = nccell_cols(c);
+    nccell* targ = &row[n->x];
+    targ->stylemask = c->stylemask;
+    targ->channels = c->channels & ~NC_NOBACKGROUND_MASK;
+    // ASCII can be copied directly, having neither pooled storage nor any
+    // chance of being RTL. anything else takes the full path.
+    if(!cell_extended_p(c) && *(const unsigned char*)&c->gcluster < 0x80){
+      nccell_release(n, targ);
+      targ->gcluster = c->gcluster;
+      targ->width = ccols;
+    }else{
+      const char* egc = nccell_extended_gcluster(n, c);
+      if(cell_load_direct(n, targ, egc, strlen(egc), ccols) < 0){
+        return -1;
+      }
+    }
+    ++n->x;
+    for(int w = 1 ; w < ccols ; ++w){
+      nccell* candidate = &row[n->x];
+      nccell_release(n, candidate);
+      candidate->gcluster = 0;
+      candidate->channels = targ->channels;
+      candidate->stylemask = targ->stylemask;
+      candidate->width = targ->width;
+      ++n->x;
+    }
+  }
+  obliterate_span_right(n, row, n->x);
+  return cols;
+}
+
 int ncplane_putegc_yx(ncplane* n, int y, int x, const char* gclust, int* sbytes){
   int cols;
   int bytes = utf8_egc_len(gclust, &cols);
@@ -1664,7 +2079,7 @@ int ncplane_putegc_yx(ncplane* n, int y, int x, const char* gclust, int* sbytes)
 int ncplane_putchar_stained(ncplane* n, char c){
   uint64_t channels = n->channels;
   uint32_t stylemask = n->stylemask;
-  const nccell* targ = &n->fb[nfbcellidx(n, n->y, n->x)];
+  const nccell* targ = ncplane_cell_peek_yx(n, n->y, n->x);
   n->channels = targ->channels;
   n->stylemask = targ->stylemask;
   int ret = ncplane_putchar(n, c);
@@ -1676,7 +2091,7 @@ int ncplane_putchar_stained(ncplane* n, char c){
 int ncplane_putwegc_stained(ncplane* n, const wchar_t* gclust, int* sbytes){
   uint64_t channels = n->channels;
   uint32_t stylemask = n->stylemask;
-  const nccell* targ = &n->fb[nfbcellidx(n, n->y, n->x)];
+  const nccell* targ = ncplane_cell_peek_yx(n, n->y, n->x);
   n->channels = targ->channels;
   n->stylemask = targ->stylemask;
   int ret = ncplane_putwegc(n, gclust, sbytes);
@@ -1688,7 +2103,7 @@ int ncplane_putwegc_stained(ncplane* n, const wchar_t* gclust, int* sbytes){
 int ncplane_putegc_stained(ncplane* n, const char* gclust, int* sbytes){
   uint64_t channels = n->channels;
   uint32_t stylemask = n->stylemask;
-  const nccell* targ = &n->fb[nfbcellidx(n, n->y, n->x)];
+  const nccell* targ = ncplane_cell_peek_yx(n, n->y, n->x);
   n->channels = targ->channels;
   n->stylemask = targ->stylemask;
   int ret = ncplane_putegc(n, gclust, sbytes);
@@ -1701,7 +2116,7 @@ int ncplane_cursor_at(const ncplane* n, nccell* c, char** gclust){
   if(n->y == n->leny && n->x == n->lenx){
     return -1;
   }
-  const nccell* src = &n->fb[nfbcellidx(n, n->y, n->x)];
+  const nccell* src = ncplane_cell_peek_yx(n, n->y, n->x);
   memcpy(c, src, sizeof(*src));
   if(cell_simple_p(c)){
     *gclust = NULL;
@@ -2116,7 +2531,15 @@ void ncplane_erase(ncplane* n){
   // wiped out by the egcpool_dump(). do a duplication (to get the stylemask
   // and channels), and then reload.
   char* egc = nccell_strdup(n, &n->basecell);
-  memset(n->fb, 0, sizeof(*n->fb) * n->leny * n->lenx);
+  // any view into history has EGCs in the pool, and must be rebuilt
+  if(n->history){
+    nchistory_drop_view(n);
+  }
+  if(ncplane_tiled_p(n)){
+    ncplane_tiles_free(n);
+  }else{
+    memset(n->fb, 0, sizeof(*n->fb) * n->leny * n->lenx);
+  }
   egcpool_dump(&n->pool);
   egcpool_init(&n->pool);
   // we need to zero out the EGC before handing this off to cell_load, but
@@ -2125,6 +2548,9 @@ void ncplane_erase(ncplane* n){
   nccell_load(n, &n->basecell, egc);
   free(egc);
   n->y = n->x = 0;
+  if(n->history){
+    nchistory_refresh(n);
+  }
 }
 
 int ncplane_erase_region(ncplane* n, int ystart, int xstart, int ylen, int xlen){
@@ -2151,9 +2577,14 @@ int ncplane_erase_region(ncplane* n, int ystart, int xstart, int ylen, int xlen)
     xlen = ncplane_dim_x(n) - ystart;
   }
   for(int y = ystart ; y < ystart + ylen ; ++y){
+    // rows of unallocated tiles are already erased
+    nccell* row = ncplane_row_peek(n, y);
+    if(row == NULL){
+      continue;
+    }
     for(int x = xstart ; x < xstart + xlen ; ++x){
-      nccell_release(n, &n->fb[nfbcellidx(n, y, x)]);
-      nccell_init(&n->fb[nfbcellidx(n, y, x)]);
+      nccell_release(n, &row[x]);
+      nccell_init(&row[x]);
     }
   }
   return 0;
@@ -2941,9 +3372,179 @@ void nclog(const char* fmt, ...){
   va_end(va);
 }
 
+// when appending a large chunk of text to a scrolling plane at the cursor, any
+// prefix followed by at least a plane's height worth of newlines will have
+// been scrolled away by the time we're done. rather than writing it only to
+// throw it away, measure it (learning how many lines it would have scrolled,
+// and how many columns it would have written), and scroll all those lines at
+// once. returns the number of bytes consumed (0 if nothing could be skipped),
+// and writes the number of columns they'd have consumed to 'cols'. anything
+// which would have resulted in an error is left to the regular path.
+static int
+ncplane_put_scrolled_prefix(ncplane* n, const char* s, size_t len, int* cols){
+  // with history, what's scrolled away must still be written for posterity
+  if(!n->scrolling || n->sprite || n->history){
+    return 0;
+  }
+  // we need the prefix to be followed by n->leny newlines. find the last
+  // newline which is so followed, if any.
+  int newlines = 0;
+  const char* nl = s;
+  while((nl = memchr(nl, '\n', len - (nl - s)))){
+    ++newlines;
+    ++nl;
+  }
+  if(newlines <= n->leny){
+    return 0;
+  }
+  const char* end = s;
+  for(newlines -= n->leny ; newlines ; --newlines){
+    end = (const char*)memchr(end, '\n', len - (end - s)) + 1;
+  }
+  int x = n->x;
+  int scrolls = 0;
+  int written = 0;
+  const char* egc = s;
+  while(egc < end){
+    int w;
+    int bytes = utf8_egc_len(egc, &w);
+    if(bytes <= 0){
+      return 0;
+    }
+    if(*egc == '\n'){
+      ++scrolls;
+      x = 0;
+    }else{
+      if(is_control_egc((const unsigned char*)egc, bytes) || w > n->lenx){
+        return 0;
+      }
+      if(x + w > n->lenx){
+        ++scrolls;
+        x = 0;
+      }
+      x += w;
+      written += w;
+    }
+    egc += bytes;
+  }
+  scroll_lines(n, scrolls);
+  *cols = written;
+  return end - s;
+}
+
+// printable ASCII (0x20--0x7e) in each byte lane of a 64-bit word? with the
+// high bits known clear, adding 0x60 sets a lane's high bit iff it's at least
+// 0x20, and adding 0x01 sets it iff it's 0x7f. no lane can carry into another.
+static inline bool
+ascii_printable_word_p(uint64_t w){
+  const uint64_t highs = 0x8080808080808080ull;
+  if(w & highs){
+    return false;
+  }
+  if(((w + 0x6060606060606060ull) & highs) != highs){
+    return false;
+  }
+  return !((w + 0x0101010101010101ull) & highs);
+}
+
+// how many leading bytes of 's' (of length 'len') are printable ASCII, each
+// its own single-column EGC? any byte other than the last in a run of
+// printable ASCII is necessarily followed by a grapheme break, and so is the
+// last if it's followed by ASCII (or nothing at all). if it's followed by
+// anything else, it might combine with what follows, so leave it out.
+static size_t
+ascii_printable_run(const char* s, size_t len){
+  size_t r = 0;
+  // check a word at a time, falling back to bytes for the remainder
+  while(len - r >= sizeof(uint64_t)){
+    uint64_t w;
+    memcpy(&w, s + r, sizeof(w));
+    if(!ascii_printable_word_p(w)){
+      break;
+    }
+    r += sizeof(w);
+  }
+  while(r < len && s[r] >= 0x20 && s[r] < 0x7f){
+    ++r;
+  }
+  if(r && r < len && (unsigned char)s[r] >= 0x80){
+    --r;
+  }
+  return r;
+}
+
+// write as much of the printable ASCII run 's' (see ascii_printable_run()) as
+// will fit on the current row, per the semantics of ncplane_putegc_yx(), but
+// without per-glyph overhead. returns the number of columns (and thus bytes)
+// written. returns 0 whenever the EGC path ought handle it, including errors
+// and the need to scroll, so that it can report them.
+static int
+ncplane_put_ascii(ncplane* n, int y, int x, const char* s, size_t len){
+  if(n->sprite){
+    return 0;
+  }
+  if(y != -1 && (y < 0 || y >= n->leny)){
+    return 0;
+  }
+  if(x == -1){
+    x = n->x;
+  }
+  if(x < 0 || x >= n->lenx){
+    return 0;
+  }
+  if(ncplane_cursor_move_yx(n, y, x)){
+    return 0;
+  }
+  nccell* row = ncplane_row_ref(n, n->y);
+  if(row == NULL){
+    return 0;
+  }
+  if(len > (size_t)(n->lenx - n->x)){
+    len = n->lenx - n->x;
+  }
+  const uint64_t channels = n->channels & ~NC_NOBACKGROUND_MASK;
+  obliterate_span_left(n, row, n->x);
+  for(size_t i = 0 ; i < len ; ++i){
+    nccell* targ = &row[n->x++];
+    nccell_release(n, targ);
+    targ->gcluster = htole((uint32_t)(unsigned char)s[i]);
+    targ->gcluster_backstop = 0;
+    targ->width = 1;
+    targ->stylemask = n->stylemask;
+    targ->channels = channels;
+  }
+  obliterate_span_right(n, row, n->x);
+  return len;
+}
+
 int ncplane_putstr_yx(struct ncplane* n, int y, int x, const char* gclusters){
   int ret = 0;
+  size_t len = strlen(gclusters);
+  if(y == -1 && x == -1){
+    int skipped = ncplane_put_scrolled_prefix(n, gclusters, len, &ret);
+    gclusters += skipped;
+    len -= skipped;
+  }
+  // the printable ASCII run remaining at gclusters. ncplane_put_ascii()
+  // writes at most a row of it, so we carry it across iterations rather than
+  // rescanning what's left of the string for each row.
+  size_t ascii = 0;
   while(*gclusters){
+    if(ascii == 0){
+      ascii = ascii_printable_run(gclusters, len);
+    }
+    if(ascii){
+      int cols = ncplane_put_ascii(n, y, x, gclusters, ascii);
+      if(cols){
+        y = -1;
+        x = -1;
+        gclusters += cols;
+        len -= cols;
+        ascii -= cols;
+        ret += cols;
+        continue;
+      }
+    }
     int wcs;
     int cols = ncplane_putegc_yx(n, y, x, gclusters, &wcs);
 //fprintf(stderr, "wrote %.*s %d cols %d bytes now at %d/%d\n", wcs, gclusters, cols, wcs, n->y, n->x);
@@ -2958,6 +3559,8 @@ int ncplane_putstr_yx(struct ncplane* n, int y, int x, const char* gclusters){
     y = -1;
     x = -1;
     gclusters += wcs;
+    len -= wcs;
+    ascii = ascii > (size_t)wcs ? ascii - wcs : 0;
     ret += cols;
   }
   return ret;
@@ -3008,7 +3611,26 @@ int ncplane_putnstr_yx(struct ncplane* n, int y, int x, size_t s, const char* gc
   int ret = 0;
   int offset = 0;
 //fprintf(stderr, "PUT %zu at %d/%d [%.*s]\n", s, y, x, (int)s, gclusters);
-  while((size_t)offset < s && gclusters[offset]){
+  const size_t len = strnlen(gclusters, s);
+  if(y == -1 && x == -1){
+    offset = ncplane_put_scrolled_prefix(n, gclusters, len, &ret);
+  }
+  size_t ascii = 0; // see ncplane_putstr_yx()
+  while((size_t)offset < len){
+    if(ascii == 0){
+      ascii = ascii_printable_run(gclusters + offset, len - offset);
+    }
+    if(ascii){
+      int cols = ncplane_put_ascii(n, y, x, gclusters + offset, ascii);
+      if(cols){
+        y = -1;
+        x = -1;
+        offset += cols;
+        ascii -= cols;
+        ret += cols;
+        continue;
+      }
+    }
     int wcs;
     int cols = ncplane_putegc_yx(n, y, x, gclusters + offset, &wcs);
     if(cols < 0){
@@ -3022,6 +3644,7 @@ int ncplane_putnstr_yx(struct ncplane* n, int y, int x, size_t s, const char* gc
     y = -1;
     x = -1;
     offset += wcs;
+    ascii = ascii > (size_t)wcs ? ascii - wcs : 0;
     ret += cols;
   }
   return ret;
@@ -362,6 +362,9 @@ int redraw_plot_##T(nc##X##plot* ncp){ \
           } \
           utf8[bytes] = '\0'; \
           nccell* c = ncplane_cell_ref_yx(ncp->plot.ncp, dimy - y - 1, x); \
+          if(c == NULL){ \
+            return -1; \
+          } \
           cell_set_bchannel(c, ncchannels_bchannel(channels)); \
           cell_set_fchannel(c, ncchannels_fchannel(channels)); \
           nccell_set_styles(c, NCSTYLE_NONE); \
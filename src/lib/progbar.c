@@ -120,6 +120,9 @@ progbar_redraw(ncprogbar* n){
     for(int freepos = 0 ; freepos < dimy ; ++freepos){
       if(notcurses_canutf8(ncplane_notcurses(ncp))){
         nccell* c = ncplane_cell_ref_yx(ncp, freepos, pos);
+        if(c == NULL){
+          return -1;
+        }
         if(pool_blit_direct(&ncp->pool, c, egc, strlen(egc), 1) <= 0){
           return -1;
         }
@@ -134,6 +137,9 @@ progbar_redraw(ncprogbar* n){
     for(int freepos = 0 ; freepos < dimx ; ++freepos){
       if(notcurses_canutf8(ncplane_notcurses(ncp))){
         nccell* c = ncplane_cell_ref_yx(ncp, pos, freepos);
+        if(c == NULL){
+          return -1;
+        }
         if(pool_blit_direct(&ncp->pool, c, egc, strlen(egc), 1) <= 0){
           return -1;
         }
@@ -151,12 +157,18 @@ progbar_redraw(ncprogbar* n){
     if(horizontal){
       for(int freepos = 0 ; freepos < dimy ; ++freepos){
         nccell* c = ncplane_cell_ref_yx(ncp, freepos, pos);
+        if(c == NULL){
+          return -1;
+        }
         nccell_release(ncp, c);
         nccell_init(c);
       }
     }else{
       for(int freepos = 0 ; freepos < dimx ; ++freepos){
         nccell* c = ncplane_cell_ref_yx(ncp, pos, freepos);
+        if(c == NULL){
+          return -1;
+        }
         nccell_release(ncp, c);
         nccell_init(c);
       }
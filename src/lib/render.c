@@ -239,6 +239,12 @@ paint(ncplane* p, struct crender* rvec, int dstleny, int dstlenx,
     if(absy >= dstleny || absy < 0){
       break;
     }
+    // look the row up once. it's NULL if it lives in an unallocated tile of
+    // a tiled plane, in which case every cell is zero (and thus shows the
+    // base cell). such cells are still opaque, so we can't skip them. if
+    // the plane's view has been sought into its history, the row might be
+    // coming from there.
+    const nccell* prow = ncplane_view_row(p, y);
     for(x = startx ; x < dimx ; ++x){ // iteration for each cell
       const int absx = x + offx;
       if(absx >= dstlenx || absx < 0){
@@ -250,9 +256,10 @@ paint(ncplane* p, struct crender* rvec, int dstleny, int dstlenx,
       if(nccell_wide_right_p(targc)){
         continue;
       }
+      const nccell* pcell = prow ? &prow[x] : &ncplane_blankcell;
 
       if(nccell_fg_alpha(targc) > NCALPHA_OPAQUE){
-        const nccell* vis = &p->fb[nfbcellidx(p, y, x)];
+        const nccell* vis = pcell;
         if(nccell_fg_default_p(vis)){
           vis = &p->basecell;
         }
@@ -284,7 +291,7 @@ paint(ncplane* p, struct crender* rvec, int dstleny, int dstlenx,
       // background channel and balpha.
       // Evaluate the background first, in case we have HIGHCONTRAST fg text.
       if(nccell_bg_alpha(targc) > NCALPHA_OPAQUE){
-        const nccell* vis = &p->fb[nfbcellidx(p, y, x)];
+        const nccell* vis = pcell;
         // to be on the blitter stacking path, we need
         //  1) crender->s.blittedquads to be non-zero (we're below semigraphics)
         //  2) cell_blittedquadrants(vis) to be non-zero (we're semigraphics)
@@ -327,7 +334,7 @@ paint(ncplane* p, struct crender* rvec, int dstleny, int dstlenx,
       // still use a character we find here, but its color will come entirely
       // from cells underneath us.
       if(!crender->p){
-        const nccell* vis = &p->fb[nfbcellidx(p, y, x)];
+        const nccell* vis = pcell;
         if(vis->gcluster == 0 && !nccell_double_wide_p(vis)){
           vis = &p->basecell;
         }
@@ -526,8 +533,33 @@ int ncplane_mergedown(ncplane* restrict src, ncplane* restrict dst,
   const struct tinfo* ti = &ncplane_notcurses_const(dst)->tcache;
   postpaint(ti, rendfb, dst->leny, dst->lenx, rvec, &dst->pool);
 //fprintf(stderr, "Postpaint done (%dx%d)\n", dst->leny, dst->lenx);
-  free(dst->fb);
-  dst->fb = rendfb;
+  if(ncplane_tiled_p(dst)){
+    // the flattened content is laid out by logical row; copy it back into
+    // tiles, row by row. blank rows needn't allocate a missing tile.
+    for(int y = 0 ; y < dst->leny ; ++y){
+      const nccell* rrow = rendfb + fbcellidx(y, dst->lenx, 0);
+      nccell* row = ncplane_row_peek(dst, y);
+      if(row == NULL){
+        int x = 0;
+        while(x < dst->lenx && !memcmp(&rrow[x], &ncplane_blankcell, sizeof(*rrow))){
+          ++x;
+        }
+        if(x == dst->lenx){
+          continue;
+        }
+        if((row = ncplane_row_ref(dst, y)) == NULL){
+          free(rendfb);
+          free(rvec);
+          return -1;
+        }
+      }
+      memcpy(row, rrow, sizeof(*row) * dst->lenx);
+    }
+    free(rendfb);
+  }else{
+    free(dst->fb);
+    dst->fb = rendfb;
+  }
   free(rvec);
   return 0;
 }
@@ -880,25 +912,25 @@ clean_sprixels(notcurses* nc, ncpile* p, fbuf* f, int scrolls){
   return bytesemitted;
 }
 
-// scroll the lastframe data |rows| up, to reflect scrolling reality
+// scroll the lastframe rows [top, bot) |rows| up, to reflect scrolling reality
 static void
-scroll_lastframe(notcurses* nc, int rows){
+scroll_lastframe(notcurses* nc, int top, int bot, int rows){
   // the top |rows| rows need be released (though not more than the actual
   // number of rows!)
-  if(rows > nc->lfdimy){
-    rows = nc->lfdimy;
+  if(rows > bot - top){
+    rows = bot - top;
   }
-  for(int targy = 0 ; targy < rows ; ++targy){
+  for(int targy = top ; targy < top + rows ; ++targy){
     for(int targx = 0 ; targx < nc->lfdimx ; ++targx){
       const size_t damageidx = targy * nc->lfdimx + targx;
       nccell* c = &nc->lastframe[damageidx];
       pool_release(&nc->pool, c);
     }
   }
-  // now for all rows subsequent, up through lfdimy - rows, move them back.
+  // now for all rows subsequent, up through bot - rows, move them back.
   // if we scrolled all rows, we will not move anything (and we just
   // released everything).
-  for(int targy = 0 ; targy < nc->lfdimy - rows ; ++targy){
+  for(int targy = top ; targy < bot - rows ; ++targy){
     const size_t dstidx = targy * nc->lfdimx;
     nccell* dst = &nc->lastframe[dstidx];
     const size_t srcidx = dstidx + rows * nc->lfdimx;
@@ -906,8 +938,8 @@ scroll_lastframe(notcurses* nc, int rows){
     memcpy(dst, src, sizeof(*dst) * nc->lfdimx);
   }
   // now for the last |rows| rows, initialize them to 0.
-  int targy = nc->lfdimy - rows;
-  while(targy < nc->lfdimy){
+  int targy = bot - rows;
+  while(targy < bot){
     const size_t dstidx = targy * nc->lfdimx;
     nccell* dst = &nc->lastframe[dstidx];
     memset(dst, 0, sizeof(*dst) * nc->lfdimx);
@@ -915,6 +947,28 @@ scroll_lastframe(notcurses* nc, int rows){
   }
 }
 
+// decide whether a pending region scroll can be handed off to the terminal.
+// if it can, shift that region of the lastframe, exactly as the terminal will
+// shift it during rasterization. otherwise, drop it, and the region will be
+// redrawn through the usual damage detection.
+static void
+scroll_lastframe_region(notcurses* nc, ncpile* p){
+  if(p->rscrolls == 0){
+    return;
+  }
+  const int rows = p->rscrollbot - p->rscrolltop + 1;
+  // we can't order a region scroll against a full-screen one. sprixels might
+  // or might not be moved by the terminal along with the text, so don't try.
+  // scrolling the entire region away gains nothing over redrawing it.
+  if(p->rscrolls < 0 || p->scrolls || p->sprixelcache || p->rscrolls >= rows
+     || nc->margin_l || nc->margin_r || p->dimx != nc->lfdimx
+     || p->rscrollbot >= nc->lfdimy || !get_escape(&nc->tcache, ESCAPE_CSR)){
+    p->rscrolls = 0;
+    return;
+  }
+  scroll_lastframe(nc, p->rscrolltop, p->rscrollbot + 1, p->rscrolls);
+}
+
 // "%d tardies to work off, by far the most in the class!\n", p->scrolls
 static int
 rasterize_scrolls(const ncpile* p, fbuf* f){
@@ -965,6 +1019,57 @@ rasterize_scrolls(const ncpile* p, fbuf* f){
   return 0;
 }
 
+// scroll the region noted by scroll_lastframe_region() using DECSTBM, so that
+// the terminal moves the existing text, and we needn't redraw it. the cursor
+// is homed by each change of the scrolling region.
+static int
+rasterize_region_scrolls(ncpile* p, fbuf* f){
+  int scrolls = p->rscrolls;
+  if(scrolls <= 0){
+    return 0;
+  }
+  notcurses* nc = p->nc;
+  logdebug("order-%d scroll of rows %d-%d\n", scrolls, p->rscrolltop, p->rscrollbot);
+  const char* csr = get_escape(&nc->tcache, ESCAPE_CSR);
+  const int top = p->rscrolltop + nc->margin_t;
+  const int bot = p->rscrollbot + nc->margin_t;
+  const int termrows = nc->lfdimy + nc->margin_t + nc->margin_b;
+  if(fbuf_emit(f, tiparm(csr, top, bot)) < 0){
+    return -1;
+  }
+  nc->rstate.hardcursorpos = true;
+  if(goto_location(nc, f, bot, 0)){
+    return -1;
+  }
+  if(nc->tcache.bce){
+    if(raster_defaults(nc, false, true, f)){
+      return -1;
+    }
+  }
+  const char* indn = get_escape(&nc->tcache, ESCAPE_INDN);
+  if(scrolls > 1 && indn){
+    if(fbuf_emit(f, tiparm(indn, scrolls)) < 0){
+      return -1;
+    }
+  }else{
+    const char* ind = get_escape(&nc->tcache, ESCAPE_IND);
+    if(ind == NULL){
+      ind = "\v";
+    }
+    while(scrolls > 0){
+      if(fbuf_emit(f, ind) < 0){
+        return -1;
+      }
+      --scrolls;
+    }
+  }
+  if(fbuf_emit(f, tiparm(csr, 0, termrows - 1)) < 0){
+    return -1;
+  }
+  nc->rstate.hardcursorpos = true;
+  return 0;
+}
+
 // second sprixel pass in rasterization. by this time, all sixels are handled
 // (and in the QUIESCENT state); only persistent kitty graphics still require
 // operation. responsibilities of this second pass include:
@@ -1004,7 +1109,7 @@ rasterize_sprixels(notcurses* nc, ncpile* p, fbuf* f){
       }
     }else if(s->invalidated == SPRIXEL_HIDE){
       if(nc->tcache.pixel_remove){
-        if(nc->tcache.pixel_remove(s->id, f) < 0){
+        if(nc->tcache.pixel_remove(s->id, s->imgid, f) < 0){
           return -1;
         }
         if( (*parent = s->next) ){
@@ -1196,6 +1301,10 @@ notcurses_rasterize_inner(notcurses* nc, ncpile* p, fbuf* f, unsigned* asu){
   }
   int scrolls = p->scrolls;
   p->scrolls = 0;
+  if(rasterize_region_scrolls(p, f)){
+    return -1;
+  }
+  p->rscrolls = 0;
   logdebug("Sprixel phase 1\n");
   int64_t sprixelbytes = clean_sprixels(nc, p, f, scrolls);
   if(sprixelbytes < 0){
@@ -1485,11 +1594,12 @@ engorge_crender_vector(ncpile* n){
 }
 
 int ncpile_render(ncplane* n){
-  scroll_lastframe(ncplane_notcurses(n), ncplane_pile(n)->scrolls);
-  struct timespec start, renderdone;
-  clock_gettime(CLOCK_MONOTONIC, &start);
   notcurses* nc = ncplane_notcurses(n);
   ncpile* pile = ncplane_pile(n);
+  scroll_lastframe(nc, 0, nc->lfdimy, pile->scrolls);
+  scroll_lastframe_region(nc, pile);
+  struct timespec start, renderdone;
+  clock_gettime(CLOCK_MONOTONIC, &start);
   // update our notion of screen geometry, and render against that
   notcurses_resize_internal(n, NULL, NULL);
   if(engorge_crender_vector(pile)){
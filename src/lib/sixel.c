@@ -1,3 +1,4 @@
+#include <math.h>
 #include "internal.h"
 #include "fbuf.h"
 
@@ -31,13 +32,40 @@ sixelcount(int dimy, int dimx){
 // be kept in the sprixel. when first encoding, data and table each have an
 // entry for every color register; call sixelmap_trim() when done to cut them
 // down to the actual number of colors used.
+//
+// most colors appear in only a few bands, so we additionally keep, for each
+// band, a bitmap of the colors (by dtable index) having any sixels within it.
+// emission then skips absent colors without scanning their sixels. a bit can
+// be set for a color no longer present in the band (following wipes, or a
+// refinement stealing its pixels), but never the other way around.
+//
+// we also track where each band begins in the encoded glyph, and which bands
+// have been wiped or rebuilt since it was encoded, so that sixel_reblit()
+// need only regenerate those bands, copying the others from the old glyph.
 typedef struct sixelmap {
   int colors;
   int sixelcount;
+  int bandcount;
   unsigned char* data;  // |colors| x |sixelcount|-byte arrays
   unsigned char* table; // |colors| x CENTSIZE: components + dtable index
+  uint64_t* presence;   // |bandcount| x PRESENCEWORDS bitmaps of present colors
+  size_t* bandoffs;     // glyph offset of each band, plus one for the ST
+  unsigned char* dirty; // |bandcount| flags: band changed since encoding
 } sixelmap;
 
+// sixel_blit() caps the color registers at 256
+#define PRESENCEWORDS (256 / 64)
+
+static inline void
+sixelmap_mark(sixelmap* s, int dtable, int band){
+  s->presence[band * PRESENCEWORDS + dtable / 64] |= 1ull << (dtable % 64);
+}
+
+static inline bool
+sixelmap_present(const sixelmap* s, int dtable, int band){
+  return s->presence[band * PRESENCEWORDS + dtable / 64] & (1ull << (dtable % 64));
+}
+
 // whip up an all-zero sixelmap for the specified pixel geometry and color
 // register count. we might not use all the available color registers; call
 // sixelmap_trim() to release any unused memory once done encoding.
@@ -46,6 +74,7 @@ sixelmap_create(int cregs, int dimy, int dimx){
   sixelmap* ret = malloc(sizeof(*ret));
   if(ret){
     ret->sixelcount = sixelcount(dimy, dimx);
+    ret->bandcount = (dimy + 5) / 6;
     if(ret->sixelcount){
       size_t dsize = sizeof(*ret->data) * cregs * ret->sixelcount;
       ret->data = malloc(dsize);
@@ -53,10 +82,19 @@ sixelmap_create(int cregs, int dimy, int dimx){
         size_t tsize = CENTSIZE * cregs;
         ret->table = malloc(tsize);
         if(ret->table){
-          memset(ret->table, 0, tsize);
-          memset(ret->data, 0, dsize);
-          ret->colors = 0;
-          return ret;
+          ret->presence = calloc(ret->bandcount * PRESENCEWORDS, sizeof(*ret->presence));
+          ret->bandoffs = calloc(ret->bandcount + 1, sizeof(*ret->bandoffs));
+          ret->dirty = calloc(ret->bandcount, sizeof(*ret->dirty));
+          if(ret->presence && ret->bandoffs && ret->dirty){
+            memset(ret->table, 0, tsize);
+            memset(ret->data, 0, dsize);
+            ret->colors = 0;
+            return ret;
+          }
+          free(ret->dirty);
+          free(ret->bandoffs);
+          free(ret->presence);
+          free(ret->table);
         }
         free(ret->data);
       }
@@ -93,6 +131,9 @@ sixelmap_trim(sixelmap* s){
 
 void sixelmap_free(sixelmap *s){
   if(s){
+    free(s->dirty);
+    free(s->bandoffs);
+    free(s->presence);
     free(s->table);
     free(s->data);
     free(s);
@@ -113,6 +154,8 @@ typedef struct sixeltable {
   cdetails* deets;      // |colorregs| cdetails structures
   int colorregs;
   sixel_p2_e p2;        // set to SIXEL_P2_TRANS if we have transparent pixels
+  uint32_t* hist;       // MCUT_BINS histogram for median cut, or NULL
+  struct sixelpalette* spal; // palette carried across frames, or NULL
 } sixeltable;
 
 // the P2 parameter on a sixel specifies how unspecified pixels are drawn.
@@ -237,6 +280,7 @@ int sixel_wipe(sprixel* s, int ycell, int xcell){
   }
   if(w){
     s->wipes_outstanding = true;
+    memset(smap->dirty + startband, 1, endband - startband + 1);
   }
   change_p2(s->glyph.buf, SIXEL_P2_TRANS);
   assert(NULL == s->n->tam[s->dimx * ycell + xcell].auxvector);
@@ -399,6 +443,401 @@ update_rmatrix(unsigned char* rmatrix, int txyidx, const tament* tam){
   }
 }
 
+// median cut quantization (NCVISUAL_OPTION_MEDIANCUT). rather than bucketing
+// at 0xc0 and refining by rescanning the source, we take a histogram of the
+// opaque pixels at MCUT_BITS per component during extract_color_table(), and
+// repeatedly split the most populous box of histogram bins at the weighted
+// median of its widest component, until we either fill the color registers
+// or run out of bins. each bin then maps to its box's color register, and a
+// second pass over the pixels builds the sixels and per-register sums.
+#define MCUT_BITS 6
+#define MCUT_BINS (1u << (MCUT_BITS * 3))
+
+static inline unsigned
+mcut_key(uint32_t rgba){
+  return ((ncpixel_r(rgba) >> (8 - MCUT_BITS)) << (MCUT_BITS * 2)) |
+         ((ncpixel_g(rgba) >> (8 - MCUT_BITS)) << MCUT_BITS) |
+         (ncpixel_b(rgba) >> (8 - MCUT_BITS));
+}
+
+typedef struct mcutbin {
+  uint32_t count;
+  uint32_t key;
+  unsigned char comps[RGBSIZE]; // histogram coordinates on [0..2^MCUT_BITS)
+} mcutbin;
+
+// a box is the span of bins [start, end)
+typedef struct mcutbox {
+  int start, end;
+  uint64_t count;
+  unsigned char lo[RGBSIZE], hi[RGBSIZE];
+} mcutbox;
+
+static int
+mcut_cmp_r(const void* va, const void* vb){
+  return ((const mcutbin*)va)->comps[0] - ((const mcutbin*)vb)->comps[0];
+}
+
+static int
+mcut_cmp_g(const void* va, const void* vb){
+  return ((const mcutbin*)va)->comps[1] - ((const mcutbin*)vb)->comps[1];
+}
+
+static int
+mcut_cmp_b(const void* va, const void* vb){
+  return ((const mcutbin*)va)->comps[2] - ((const mcutbin*)vb)->comps[2];
+}
+
+static void
+mcut_shrink(mcutbox* box, const mcutbin* bins){
+  box->count = 0;
+  memcpy(box->lo, bins[box->start].comps, RGBSIZE);
+  memcpy(box->hi, bins[box->start].comps, RGBSIZE);
+  for(int i = box->start ; i < box->end ; ++i){
+    for(int c = 0 ; c < RGBSIZE ; ++c){
+      if(bins[i].comps[c] < box->lo[c]){
+        box->lo[c] = bins[i].comps[c];
+      }else if(bins[i].comps[c] > box->hi[c]){
+        box->hi[c] = bins[i].comps[c];
+      }
+    }
+    box->count += bins[i].count;
+  }
+}
+
+// split |box| at the weighted median of its widest component, putting the
+// upper part into |nbox|.
+static void
+mcut_split(mcutbox* box, mcutbox* nbox, mcutbin* bins){
+  static int (* const cmps[RGBSIZE])(const void*, const void*) = {
+    mcut_cmp_r, mcut_cmp_g, mcut_cmp_b,
+  };
+  int widest = 0;
+  for(int c = 1 ; c < RGBSIZE ; ++c){
+    if(box->hi[c] - box->lo[c] > box->hi[widest] - box->lo[widest]){
+      widest = c;
+    }
+  }
+  qsort(bins + box->start, box->end - box->start, sizeof(*bins), cmps[widest]);
+  // both halves must retain at least one bin
+  uint64_t seen = bins[box->start].count;
+  int m = box->start + 1;
+  while(m < box->end - 1 && seen + bins[m].count <= box->count / 2){
+    seen += bins[m++].count;
+  }
+  nbox->start = m;
+  nbox->end = box->end;
+  box->end = m;
+  mcut_shrink(box, bins);
+  mcut_shrink(nbox, bins);
+}
+
+// a palette carried across renders of an ncvisual (NCVISUAL_OPTION_KEEPPALETTE).
+// it is built by median cut, and kept so long as later frames fit it nearly
+// as well as the frame from which it was built, which keeps the colors of
+// video stable from frame to frame. centers are in the units of
+// mcut_partition(): eight times the MCUT_BITS histogram coordinates. lookup
+// caches the nearest center to each histogram bin, as 1 + its index.
+typedef struct sixelpalette {
+  int colors;
+  int colorregs;         // registers available when the palette was built
+  uint64_t err;          // mean squared error over the frame it was built from
+  int centers[256 * RGBSIZE];
+  uint16_t* lookup;      // MCUT_BINS entries, 0 where not yet known
+} sixelpalette;
+
+static sixelpalette*
+sixelpalette_create(void){
+  sixelpalette* ret = malloc(sizeof(*ret));
+  if(ret){
+    memset(ret, 0, sizeof(*ret));
+    if((ret->lookup = calloc(MCUT_BINS, sizeof(*ret->lookup))) == NULL){
+      free(ret);
+      return NULL;
+    }
+  }
+  return ret;
+}
+
+void sixelpalette_free(sixelpalette* spal){
+  if(spal){
+    free(spal->lookup);
+    free(spal);
+  }
+}
+
+// replaces each nonzero histogram entry with the color register of its box,
+// returning the number of registers used, or -1 on allocation failure. if
+// |keep| is not NULL, the palette is recorded there.
+static int
+mcut_partition(uint32_t* hist, int colorregs, sixelpalette* keep){
+  int bincount = 0;
+  for(unsigned k = 0 ; k < MCUT_BINS ; ++k){
+    bincount += !!hist[k];
+  }
+  if(bincount == 0){
+    return 0;
+  }
+  mcutbin* bins = malloc(sizeof(*bins) * bincount);
+  mcutbox* boxes = malloc(sizeof(*boxes) * colorregs);
+  if(bins == NULL || boxes == NULL){
+    free(bins);
+    free(boxes);
+    return -1;
+  }
+  const unsigned cmask = (1u << MCUT_BITS) - 1;
+  int b = 0;
+  for(unsigned k = 0 ; k < MCUT_BINS ; ++k){
+    if(hist[k]){
+      bins[b].count = hist[k];
+      bins[b].key = k;
+      bins[b].comps[0] = k >> (MCUT_BITS * 2);
+      bins[b].comps[1] = (k >> MCUT_BITS) & cmask;
+      bins[b].comps[2] = k & cmask;
+      ++b;
+    }
+  }
+  boxes[0].start = 0;
+  boxes[0].end = bincount;
+  mcut_shrink(&boxes[0], bins);
+  int boxcount = 1;
+  while(boxcount < colorregs){
+    mcutbox* target = NULL;
+    uint64_t best = 0;
+    for(int i = 0 ; i < boxcount ; ++i){
+      if(boxes[i].end - boxes[i].start > 1){
+        int span = 0;
+        for(int c = 0 ; c < RGBSIZE ; ++c){
+          if(boxes[i].hi[c] - boxes[i].lo[c] > span){
+            span = boxes[i].hi[c] - boxes[i].lo[c];
+          }
+        }
+        if(target == NULL || boxes[i].count * span > best){
+          target = &boxes[i];
+          best = boxes[i].count * span;
+        }
+      }
+    }
+    if(target == NULL){ // every box is a single bin
+      break;
+    }
+    mcut_split(target, &boxes[boxcount++], bins);
+  }
+  // a bin near the edge of its box can be closer to the center of another.
+  // take each box's weighted mean, and map each bin to the nearest mean.
+  int* centers = malloc(sizeof(*centers) * RGBSIZE * boxcount);
+  if(centers == NULL){
+    free(boxes);
+    free(bins);
+    return -1;
+  }
+  for(int i = 0 ; i < boxcount ; ++i){
+    uint64_t sums[RGBSIZE] = { 0, 0, 0 };
+    for(int j = boxes[i].start ; j < boxes[i].end ; ++j){
+      for(int c = 0 ; c < RGBSIZE ; ++c){
+        sums[c] += (uint64_t)bins[j].comps[c] * bins[j].count;
+      }
+    }
+    for(int c = 0 ; c < RGBSIZE ; ++c){
+      centers[i * RGBSIZE + c] = sums[c] * 8 / boxes[i].count;
+    }
+  }
+  uint64_t err = 0;
+  uint64_t total = 0;
+  for(int j = 0 ; j < bincount ; ++j){
+    int best = 0;
+    int bestdist = INT_MAX;
+    for(int i = 0 ; i < boxcount ; ++i){
+      int dist = 0;
+      for(int c = 0 ; c < RGBSIZE ; ++c){
+        int d = bins[j].comps[c] * 8 - centers[i * RGBSIZE + c];
+        dist += d * d;
+      }
+      if(dist < bestdist){
+        bestdist = dist;
+        best = i;
+      }
+    }
+    hist[bins[j].key] = best;
+    boxes[best].start = -1; // mark the box as used
+    err += (uint64_t)bestdist * bins[j].count;
+    total += bins[j].count;
+  }
+  // a box might have lost all of its bins to its neighbors. renumber the
+  // registers to close any such gaps.
+  int used = 0;
+  for(int i = 0 ; i < boxcount ; ++i){
+    boxes[i].end = boxes[i].start < 0 ? used++ : -1;
+    if(keep && boxes[i].end >= 0){
+      memcpy(keep->centers + boxes[i].end * RGBSIZE, centers + i * RGBSIZE,
+             sizeof(*centers) * RGBSIZE);
+    }
+  }
+  for(int j = 0 ; j < bincount ; ++j){
+    hist[bins[j].key] = boxes[hist[bins[j].key]].end;
+  }
+  if(keep){
+    keep->colors = used;
+    keep->colorregs = colorregs;
+    keep->err = err / total;
+    memset(keep->lookup, 0, sizeof(*keep->lookup) * MCUT_BINS);
+    for(int j = 0 ; j < bincount ; ++j){
+      keep->lookup[bins[j].key] = hist[bins[j].key] + 1;
+    }
+  }
+  free(centers);
+  free(boxes);
+  free(bins);
+  return used;
+}
+
+static inline int
+mcut_dist(const int* a, const int* b){
+  int dist = 0;
+  for(int c = 0 ; c < RGBSIZE ; ++c){
+    dist += (a[c] - b[c]) * (a[c] - b[c]);
+  }
+  return dist;
+}
+
+// map the histogram onto the carried palette |spal|, replacing each nonzero
+// entry with a color register, and returning the number of registers used.
+// registers no pixel maps to are dropped. returns -1, leaving the histogram
+// untouched, if the palette no longer fits: its mean squared error over this
+// histogram is more than twice that over the frame from which it was built
+// (plus a step of slack in each component), as happens at a scene change.
+static int
+mcut_carry(uint32_t* hist, sixelpalette* spal){
+  const unsigned cmask = (1u << MCUT_BITS) - 1;
+  uint64_t err = 0;
+  uint64_t total = 0;
+  for(unsigned k = 0 ; k < MCUT_BINS ; ++k){
+    if(hist[k] == 0){
+      continue;
+    }
+    const int comps[RGBSIZE] = {
+      (k >> (MCUT_BITS * 2)) * 8, ((k >> MCUT_BITS) & cmask) * 8, (k & cmask) * 8,
+    };
+    int best = spal->lookup[k] - 1;
+    int bestdist;
+    if(best >= 0){
+      bestdist = mcut_dist(comps, spal->centers + best * RGBSIZE);
+    }else{
+      bestdist = INT_MAX;
+      for(int i = 0 ; i < spal->colors ; ++i){
+        int dist = mcut_dist(comps, spal->centers + i * RGBSIZE);
+        if(dist < bestdist){
+          bestdist = dist;
+          best = i;
+        }
+      }
+      spal->lookup[k] = best + 1;
+    }
+    err += (uint64_t)bestdist * hist[k];
+    total += hist[k];
+  }
+  if(total && err / total > spal->err * 2 + 3 * 64){
+    return -1;
+  }
+  int remap[256];
+  for(int i = 0 ; i < spal->colors ; ++i){
+    remap[i] = -1;
+  }
+  int used = 0;
+  for(unsigned k = 0 ; k < MCUT_BINS ; ++k){
+    if(hist[k]){
+      const int r = spal->lookup[k] - 1;
+      if(remap[r] < 0){
+        remap[r] = used++;
+      }
+      hist[k] = remap[r];
+    }
+  }
+  return used;
+}
+
+// solve the palette from the median cut histogram, carrying the previous
+// frame's palette if there is one and it still fits.
+static int
+mcut_palette(sixeltable* stab){
+  sixelpalette* spal = stab->spal;
+  if(spal && spal->colors && spal->colorregs == stab->colorregs){
+    int used = mcut_carry(stab->hist, spal);
+    if(used >= 0){
+      return used;
+    }
+  }
+  return mcut_partition(stab->hist, stab->colorregs, spal);
+}
+
+// following mcut_partition() and a second pass over the pixels (see
+// span_assign()), the registers' colors are the means of their pixels.
+static void
+mcut_fill_table(sixeltable* stab){
+  for(int c = 0 ; c < stab->map->colors ; ++c){
+    unsigned char* crec = stab->map->table + c * CENTSIZE;
+    const cdetails* deets = &stab->deets[c];
+    for(int i = 0 ; i < RGBSIZE ; ++i){
+      crec[i] = ss(deets->sums[i] / deets->count, 0xff);
+    }
+    dtable_to_ctable(c, crec);
+  }
+}
+
+// update TAM entry |txyidx| (and the refresh matrix) for one of its pixels.
+// |firstpix| is set for the cell's first pixel, and |lastsixel| for pixels of
+// the sprixel's final sixel. returns true if the pixel forces P2=1.
+static inline bool
+extract_tam_pixel(tament* tam, unsigned char* rmatrix, int txyidx, bool trans,
+                  bool firstpix, bool lastsixel){
+  bool forcetrans = false;
+  // we do *not* exempt already-wiped pixels from palette creation. once
+  // we're done, we'll call sixel_wipe() on these cells. so they remain
+  // one of SPRIXCELL_ANNIHILATED or SPRIXCELL_ANNIHILATED_TRANS.
+  if(tam[txyidx].state != SPRIXCELL_ANNIHILATED && tam[txyidx].state != SPRIXCELL_ANNIHILATED_TRANS){
+    if(trans){
+      if(firstpix){
+        update_rmatrix(rmatrix, txyidx, tam);
+        tam[txyidx].state = SPRIXCELL_TRANSPARENT;
+      }else if(tam[txyidx].state == SPRIXCELL_OPAQUE_SIXEL){
+        tam[txyidx].state = SPRIXCELL_MIXED_SIXEL;
+      }
+      forcetrans = true; // even one forces P2=1
+    }else{
+      if(firstpix){
+        update_rmatrix(rmatrix, txyidx, tam);
+        tam[txyidx].state = SPRIXCELL_OPAQUE_SIXEL;
+      }else if(tam[txyidx].state == SPRIXCELL_TRANSPARENT){
+        tam[txyidx].state = SPRIXCELL_MIXED_SIXEL;
+      }
+    }
+  }else{
+    if(trans){
+      if(firstpix){
+        update_rmatrix(rmatrix, txyidx, tam);
+        tam[txyidx].state = SPRIXCELL_ANNIHILATED_TRANS;
+        free(tam[txyidx].auxvector);
+        tam[txyidx].auxvector = NULL;
+      }
+    }else{
+      if(firstpix){
+        update_rmatrix(rmatrix, txyidx, tam);
+        free(tam[txyidx].auxvector);
+        tam[txyidx].auxvector = NULL;
+      }
+      tam[txyidx].state = SPRIXCELL_ANNIHILATED;
+    }
+    forcetrans = true; // even one forces P2=1
+  }
+  // if we're opaque, we needn't clear the old cell with a glyph
+  if(lastsixel && tam[txyidx].state == SPRIXCELL_OPAQUE_SIXEL){
+    if(rmatrix){
+      rmatrix[txyidx] = 0;
+    }
+  }
+  return forcetrans;
+}
+
 // no mattter the input palette, we can always get a maximum of 64 colors if we
 // mask at 0xc0 on each component (this partitions each component into 4 chunks,
 // and 4 * 4 * 4 -> 64). so this will never overflow our color register table
@@ -425,58 +864,16 @@ extract_color_table(const uint32_t* data, int linesize, int cols,
         // we can't just check if lastidx != txyidx; that's true for each row
         // of the cell. this will only be true once.
         bool firstpix = (sy % cdimy == 0 && visx % cdimx == 0);
-        bool lastrow = visy + 6 >= begy + leny;
-        // we do *not* exempt already-wiped pixels from palette creation. once
-        // we're done, we'll call sixel_wipe() on these cells. so they remain
-        // one of SPRIXCELL_ANNIHILATED or SPRIXCELL_ANNIHILATED_TRANS.
-        if(tam[txyidx].state != SPRIXCELL_ANNIHILATED && tam[txyidx].state != SPRIXCELL_ANNIHILATED_TRANS){
-          if(rgba_trans_p(*rgb, bargs->transcolor)){
-            if(firstpix){
-              update_rmatrix(rmatrix, txyidx, tam);
-              tam[txyidx].state = SPRIXCELL_TRANSPARENT;
-            }else if(tam[txyidx].state == SPRIXCELL_OPAQUE_SIXEL){
-              tam[txyidx].state = SPRIXCELL_MIXED_SIXEL;
-            }
-            stab->p2 = SIXEL_P2_TRANS; // even one forces P2=1
-          }else{
-            if(firstpix){
-              update_rmatrix(rmatrix, txyidx, tam);
-              tam[txyidx].state = SPRIXCELL_OPAQUE_SIXEL;
-            }else if(tam[txyidx].state == SPRIXCELL_TRANSPARENT){
-              tam[txyidx].state = SPRIXCELL_MIXED_SIXEL;
-            }
-          }
-        }else{
-//fprintf(stderr, "TRANS SKIP %d %d %d %d (cell: %d %d)\n", visy, visx, sy, txyidx, sy / cdimy, visx / cdimx);
-          if(rgba_trans_p(*rgb, bargs->transcolor)){
-            if(firstpix){
-              update_rmatrix(rmatrix, txyidx, tam);
-              tam[txyidx].state = SPRIXCELL_ANNIHILATED_TRANS;
-              free(tam[txyidx].auxvector);
-              tam[txyidx].auxvector = NULL;
-            }
-          }else{
-            if(firstpix){
-              update_rmatrix(rmatrix, txyidx, tam);
-              free(tam[txyidx].auxvector);
-              tam[txyidx].auxvector = NULL;
-            }
-            tam[txyidx].state = SPRIXCELL_ANNIHILATED;
-          }
-          stab->p2 = SIXEL_P2_TRANS; // even one forces P2=1
+        bool lastsixel = visy + 6 >= begy + leny && visx + 1 >= begx + lenx;
+        bool trans = rgba_trans_p(*rgb, bargs->transcolor);
+        if(extract_tam_pixel(tam, rmatrix, txyidx, trans, firstpix, lastsixel)){
+          stab->p2 = SIXEL_P2_TRANS;
         }
-        if(lastrow){
-          bool lastcol = visx + 1 >= begx + lenx;
-          if(lastcol){
-            // if we're opaque, we needn't clear the old cell with a glyph
-            if(tam[txyidx].state == SPRIXCELL_OPAQUE_SIXEL){
-              if(rmatrix){
-                rmatrix[txyidx] = 0;
-              }
-            }
-          }
+        if(trans){
+          continue;
         }
-        if(rgba_trans_p(*rgb, bargs->transcolor)){
+        if(stab->hist){ // median cut assigns colors in a second pass
+          ++stab->hist[mcut_key(*rgb)];
           continue;
         }
         unsigned char comps[RGBSIZE];
@@ -487,6 +884,7 @@ extract_color_table(const uint32_t* data, int linesize, int cols,
           return -1;
         }
         stab->map->data[c * stab->map->sixelcount + pos] |= (1u << (sy - visy));
+        sixelmap_mark(stab->map, c, (visy - begy) / 6);
         update_deets(*rgb, &stab->deets[c]);
 //fprintf(stderr, "color %d pos %d: 0x%x\n", c, pos, stab->data[c * stab->map->sixelcount + pos]);
 //fprintf(stderr, " sums: %u %u %u count: %d r/g/b: %u %u %u\n", stab->deets[c].sums[0], stab->deets[c].sums[1], stab->deets[c].sums[2], stab->deets[c].count, ncpixel_r(*rgb), ncpixel_g(*rgb), ncpixel_b(*rgb));
@@ -494,9 +892,324 @@ extract_color_table(const uint32_t* data, int linesize, int cols,
       ++pos;
     }
   }
+  if(stab->hist){
+    if((stab->map->colors = mcut_palette(stab)) < 0){
+      return -1;
+    }
+  }
+  return 0;
+}
+
+// a threaded encode (NCVISUAL_OPTION_THREADED) splits the sixel into spans of
+// pixel rows, each a multiple of both six and the cell height, so that no
+// band of sixels nor TAM entry is shared between threads. extraction becomes
+// two passes over each span. the first does the TAM bookkeeping and collects
+// the span's colors, from which we build the palette serially. the second
+// sets the sixels. colors are collected in the order in which they're first
+// seen, so the palette (and thus the sixel) is the same as a serial encode's.
+// each span's bands of the payload are then written to their own buffer.
+typedef struct sixelspan {
+  const uint32_t* data;
+  int linesize;
+  int cols;                // sprixel width in cells
+  int leny, lenx;          // scaled geometry of the entire sixel
+  int starty, endy;        // the span's pixel rows [starty, endy), less begy
+  sixeltable* stab;
+  tament* tam;
+  const blitterargs* bargs;
+  sixel_p2_e p2;
+  uint32_t* hist;          // span's median cut histogram, or NULL
+  uint64_t seen;           // bitmap of mask_key()s seen in the span
+  unsigned char keys[64];  // the span's mask_key()s, in order of first sight
+  int keycount;
+  const int* keymap;       // color register of each mask_key()
+  cdetails* deets;         // span's color details, merged once assigned
+  fbuf f;                  // span's bands of the payload
+  int (*fxn)(struct sixelspan*);
+  int ret;
+  bool launched;
+  pthread_t tid;
+} sixelspan;
+
+// the span of rows handed to each thread covers at least this many bands
+#define SIXEL_SPAN_MINBANDS 8
+
+// the color key of the default quantizer, |rgba| masked at 0xc0, on [0..64).
+static inline unsigned
+mask_key(uint32_t rgba){
+  return ((ncpixel_r(rgba) & 0xc0) >> 2) | ((ncpixel_g(rgba) & 0xc0) >> 4) |
+         ((ncpixel_b(rgba) & 0xc0) >> 6);
+}
+
+static void
+sixelspan_init(sixelspan* sp, const uint32_t* data, int linesize, int cols,
+               int leny, int lenx, int starty, int endy, sixeltable* stab,
+               tament* tam, const blitterargs* bargs){
+  memset(sp, 0, sizeof(*sp));
+  sp->data = data;
+  sp->linesize = linesize;
+  sp->cols = cols;
+  sp->leny = leny;
+  sp->lenx = lenx;
+  sp->starty = starty;
+  sp->endy = endy;
+  sp->stab = stab;
+  sp->tam = tam;
+  sp->bargs = bargs;
+  sp->p2 = SIXEL_P2_ALLOPAQUE;
+  sp->deets = stab->deets;
+}
+
+// first pass over a span: TAM bookkeeping, and color collection
+static int
+span_collect(sixelspan* sp){
+  const blitterargs* bargs = sp->bargs;
+  const int begx = bargs->begx;
+  const int begy = bargs->begy;
+  const sprixel* s = bargs->u.pixel.spx;
+  const int cdimy = s->cellpxy;
+  const int cdimx = s->cellpxx;
+  unsigned char* rmatrix = s->needs_refresh;
+  const int endy = begy + sp->endy;
+  for(int visy = begy + sp->starty ; visy < endy ; visy += 6){
+    for(int visx = begx ; visx < (begx + sp->lenx) ; visx += 1){
+      for(int sy = visy ; sy < endy && sy < visy + 6 ; ++sy){
+        const uint32_t* rgb = (sp->data + (sp->linesize / 4 * sy) + visx);
+        int txyidx = (sy / cdimy) * sp->cols + (visx / cdimx);
+        bool firstpix = (sy % cdimy == 0 && visx % cdimx == 0);
+        bool lastsixel = visy + 6 >= begy + sp->leny && visx + 1 >= begx + sp->lenx;
+        bool trans = rgba_trans_p(*rgb, bargs->transcolor);
+        if(extract_tam_pixel(sp->tam, rmatrix, txyidx, trans, firstpix, lastsixel)){
+          sp->p2 = SIXEL_P2_TRANS;
+        }
+        if(trans){
+          continue;
+        }
+        if(sp->hist){
+          ++sp->hist[mcut_key(*rgb)];
+        }else{
+          unsigned key = mask_key(*rgb);
+          if(!(sp->seen & (1ull << key))){
+            sp->seen |= 1ull << key;
+            sp->keys[sp->keycount++] = key;
+          }
+        }
+      }
+    }
+  }
+  return 0;
+}
+
+// second pass over a span: OR each opaque pixel into the sixels of its color
+// register, and accumulate the register's details. the register comes from
+// the median cut histogram, if there is one, and otherwise from the keymap.
+static int
+span_assign(sixelspan* sp){
+  const blitterargs* bargs = sp->bargs;
+  const int begx = bargs->begx;
+  const int begy = bargs->begy;
+  sixelmap* map = sp->stab->map;
+  const uint32_t* hist = sp->stab->hist;
+  const int endy = begy + sp->endy;
+  for(int visy = begy + sp->starty ; visy < endy ; visy += 6){
+    const int band = (visy - begy) / 6;
+    int pos = band * sp->lenx;
+    for(int visx = begx ; visx < (begx + sp->lenx) ; visx += 1, ++pos){
+      for(int sy = visy ; sy < endy && sy < visy + 6 ; ++sy){
+        const uint32_t* rgb = (sp->data + (sp->linesize / 4 * sy) + visx);
+        if(rgba_trans_p(*rgb, bargs->transcolor)){
+          continue;
+        }
+        int c = hist ? (int)hist[mcut_key(*rgb)] : sp->keymap[mask_key(*rgb)];
+        map->data[c * map->sixelcount + pos] |= (1u << (sy - visy));
+        sixelmap_mark(map, c, band);
+        update_deets(*rgb, &sp->deets[c]);
+      }
+    }
+  }
+  return 0;
+}
+
+static void*
+sixelspan_thread(void* vspan){
+  sixelspan* sp = vspan;
+  sp->ret = sp->fxn(sp);
+  return NULL;
+}
+
+// run |fxn| over each of the |count| spans in parallel, taking the first span
+// on the calling thread. if a thread can't be launched, its span runs here.
+static int
+sixelspans_run(sixelspan* spans, int count, int (*fxn)(sixelspan*)){
+  for(int i = 0 ; i < count ; ++i){
+    spans[i].fxn = fxn;
+    spans[i].ret = -1;
+    spans[i].launched = false;
+  }
+  for(int i = 1 ; i < count ; ++i){
+    if(pthread_create(&spans[i].tid, NULL, sixelspan_thread, &spans[i]) == 0){
+      spans[i].launched = true;
+    }else{
+      sixelspan_thread(&spans[i]);
+    }
+  }
+  sixelspan_thread(&spans[0]);
+  int ret = 0;
+  for(int i = 0 ; i < count ; ++i){
+    if(spans[i].launched){
+      pthread_join(spans[i].tid, NULL);
+    }
+    if(spans[i].ret < 0){
+      ret = -1;
+    }
+  }
+  return ret;
+}
+
+static void
+merge_deets(cdetails* dst, const cdetails* src){
+  if(src->count == 0){
+    return;
+  }
+  if(dst->count == 0){
+    *dst = *src;
+    return;
+  }
+  for(int i = 0 ; i < RGBSIZE ; ++i){
+    dst->sums[i] += src->sums[i];
+    if(dst->hi[i] < src->hi[i]){
+      dst->hi[i] = src->hi[i];
+    }
+    if(dst->lo[i] > src->lo[i]){
+      dst->lo[i] = src->lo[i];
+    }
+  }
+  dst->count += src->count;
+}
+
+// threaded extract_color_table(). for median cut, this includes the second
+// pass, and thus the table is complete upon return.
+static int
+extract_color_table_spans(sixelspan* spans, int count, sixeltable* stab){
+  if(sixelspans_run(spans, count, span_collect)){
+    return -1;
+  }
+  int keymap[64];
+  for(int i = 0 ; i < count ; ++i){
+    if(spans[i].p2 == SIXEL_P2_TRANS){
+      stab->p2 = SIXEL_P2_TRANS;
+    }
+  }
+  if(stab->hist){
+    // the first span accumulates directly into the table's histogram
+    for(int i = 1 ; i < count ; ++i){
+      for(unsigned k = 0 ; k < MCUT_BINS ; ++k){
+        stab->hist[k] += spans[i].hist[k];
+      }
+    }
+    if((stab->map->colors = mcut_palette(stab)) < 0){
+      return -1;
+    }
+  }else{
+    for(int i = 0 ; i < count ; ++i){
+      for(int k = 0 ; k < spans[i].keycount ; ++k){
+        const unsigned key = spans[i].keys[k];
+        unsigned char comps[RGBSIZE];
+        comps[0] = ss((key >> 4u) << 6u, 0xc0);
+        comps[1] = ss(((key >> 2u) & 0x3u) << 6u, 0xc0);
+        comps[2] = ss((key & 0x3u) << 6u, 0xc0);
+        if((keymap[key] = find_color(stab, comps)) < 0){
+          return -1;
+        }
+      }
+    }
+  }
+  for(int i = 0 ; i < count ; ++i){
+    spans[i].keymap = keymap;
+  }
+  if(sixelspans_run(spans, count, span_assign)){
+    return -1;
+  }
+  // the first span accumulates directly into the table's details
+  for(int i = 1 ; i < count ; ++i){
+    for(int c = 0 ; c < stab->map->colors ; ++c){
+      merge_deets(&stab->deets[c], &spans[i].deets[c]);
+    }
+  }
+  if(stab->hist){
+    mcut_fill_table(stab);
+  }
   return 0;
 }
 
+static void
+sixelspans_free(sixelspan* spans, int count){
+  if(spans){
+    for(int i = 0 ; i < count ; ++i){
+      if(i){
+        free(spans[i].hist);
+        free(spans[i].deets);
+      }
+      fbuf_free(&spans[i].f);
+    }
+    free(spans);
+  }
+}
+
+// prepare spans for a threaded encode. returns the number of spans, or 0 if
+// the encode ought be serial (including on allocation failure). spans cover
+// whole cells, so we only split sixels with cell-aligned origins.
+static int
+sixelspans_create(sixelspan** spans, const uint32_t* data, int linesize,
+                  int cols, int leny, int lenx, sixeltable* stab,
+                  tament* tam, const blitterargs* bargs){
+  const int cdimy = bargs->u.pixel.spx->cellpxy;
+  if(bargs->begy % cdimy){
+    return 0;
+  }
+  int g = cdimy;
+  for(int r = 6 ; r ; ){ // gcd(6, cdimy)
+    int t = g % r;
+    g = r;
+    r = t;
+  }
+  const int unit = 6 / g * cdimy; // lcm(6, cdimy) pixel rows
+  const int units = (leny + unit - 1) / unit;
+  const int count = blit_threadcount(units, (SIXEL_SPAN_MINBANDS * 6 + unit - 1) / unit);
+  if(count < 2){
+    return 0;
+  }
+  if((*spans = malloc(sizeof(**spans) * count)) == NULL){
+    return 0;
+  }
+  for(int i = 0 ; i < count ; ++i){
+    int starty = units * i / count * unit;
+    int endy = units * (i + 1) / count * unit;
+    if(endy > leny){
+      endy = leny;
+    }
+    sixelspan_init(&(*spans)[i], data, linesize, cols, leny, lenx, starty,
+                   endy, stab, tam, bargs);
+  }
+  (*spans)[0].hist = stab->hist;
+  for(int i = 1 ; i < count ; ++i){
+    sixelspan* sp = &(*spans)[i];
+    if((sp->deets = calloc(stab->colorregs, sizeof(*sp->deets))) == NULL){
+      sixelspans_free(*spans, i + 1);
+      *spans = NULL;
+      return 0;
+    }
+    if(stab->hist){
+      if((sp->hist = calloc(MCUT_BINS, sizeof(*sp->hist))) == NULL){
+        sixelspans_free(*spans, i + 1);
+        *spans = NULL;
+        return 0;
+      }
+    }
+  }
+  return count;
+}
+
 // run through the sixels matching color |src|, going to color |stab->colors|,
 // keeping those under |r||g||b|, and putting those above it into the new
 // color. rebuilds both sixel groups and color details.
@@ -526,6 +1239,7 @@ unzip_color(const uint32_t* data, int linesize, int begy, int begx,
             if(comps[0] > rgb[0] || comps[1] > rgb[1] || comps[2] > rgb[2]){
               dstsixels[sixel] |= (1u << (sy - visy));
               srcsixels[sixel] &= ~(1u << (sy - visy));
+              sixelmap_mark(stab->map, stab->map->colors, (visy - begy) / 6);
               update_deets(*pixel, targdeets);
 //fprintf(stderr, "%u/%u/%u comps: [%u/%u/%u]\n", r, g, b, comps[0], comps[1], comps[2]);
 //fprintf(stderr, "match sixel %d %u %u\n", sixel, srcsixels[sixel], 1u << (sy - visy));
@@ -759,15 +1473,27 @@ write_sixel_header(fbuf* f, int leny, int lenx, const sixeltable* stab, sixel_p2
   return r;
 }
 
+// write bands [sband, eband) of the payload, each but the last of the sixel
+// terminated with a graphics newline. each band's offset within |f| is
+// recorded in map->bandoffs.
 static int
-write_sixel_payload(fbuf* f, int lenx, const sixelmap* map){
-  int p = 0;
-  while(p < map->sixelcount){
+write_sixel_bands(fbuf* f, int lenx, sixelmap* map, int sband, int eband){
+  int p = sband * lenx;
+  int band = sband;
+  while(band < eband && band < map->bandcount){
+    map->bandoffs[band] = f->used;
+    if(p >= map->sixelcount){
+      ++band;
+      continue;
+    }
     int needclosure = 0;
     for(int i = 0 ; i < map->colors ; ++i){
+      int idx = ctable_to_dtable(map->table + i * CENTSIZE);
+      if(!sixelmap_present(map, idx, band)){
+        continue;
+      }
       int seenrle = 0; // number of repetitions
       unsigned char crle = 0; // character being repeated
-      int idx = ctable_to_dtable(map->table + i * CENTSIZE);
       int printed = 0;
       for(int m = p ; m < map->sixelcount && m < p + lenx ; ++m){
 //fprintf(stderr, "%d ", idx * map->sixelcount + m);
@@ -800,7 +1526,50 @@ write_sixel_payload(fbuf* f, int lenx, const sixelmap* map){
       }
     }
     p += lenx;
+    ++band;
   }
+  return 0;
+}
+
+static int
+write_sixel_payload(fbuf* f, int lenx, sixelmap* map){
+  if(write_sixel_bands(f, lenx, map, 0, map->bandcount)){
+    return -1;
+  }
+  map->bandoffs[map->bandcount] = f->used;
+  if(fbuf_puts(f, "\e\\") < 0){
+    return -1;
+  }
+  return 0;
+}
+
+static int
+span_payload(sixelspan* sp){
+  if(fbuf_init_small(&sp->f)){
+    return -1;
+  }
+  return write_sixel_bands(&sp->f, sp->lenx, sp->stab->map, sp->starty / 6,
+                           (sp->endy + 5) / 6);
+}
+
+// threaded write_sixel_payload(), concatenating the spans' bands
+static int
+write_sixel_payload_spans(fbuf* f, sixelspan* spans, int count){
+  if(sixelspans_run(spans, count, span_payload)){
+    return -1;
+  }
+  sixelmap* map = spans[0].stab->map;
+  for(int i = 0 ; i < count ; ++i){
+    const size_t base = f->used;
+    if(fbuf_putn(f, spans[i].f.buf, spans[i].f.used) < 0){
+      return -1;
+    }
+    // the span recorded its bands' offsets relative to its own buffer
+    for(int b = spans[i].starty / 6 ; b < (spans[i].endy + 5) / 6 && b < map->bandcount ; ++b){
+      map->bandoffs[b] += base;
+    }
+  }
+  map->bandoffs[map->bandcount] = f->used;
   if(fbuf_puts(f, "\e\\") < 0){
     return -1;
   }
@@ -810,15 +1579,19 @@ write_sixel_payload(fbuf* f, int lenx, const sixelmap* map){
 // emit the sixel in its entirety, plus escapes to start and end pixel mode.
 // only called the first time we encode; after that, the palette remains
 // constant, and is simply copied. fclose()s |fp| on success. |outx| and |outy|
-// are output geometry.
+// are output geometry. the payload is written in parallel if we have |spans|.
 static int
 write_sixel(fbuf* f, int outy, int outx, const sixeltable* stab,
-            int* parse_start, sixel_p2_e p2){
+            int* parse_start, sixel_p2_e p2, sixelspan* spans, int spancount){
   *parse_start = write_sixel_header(f, outy, outx, stab, p2);
   if(*parse_start < 0){
     return -1;
   }
-  if(write_sixel_payload(f, outx, stab->map) < 0){
+  if(spancount){
+    if(write_sixel_payload_spans(f, spans, spancount) < 0){
+      return -1;
+    }
+  }else if(write_sixel_payload(f, outx, stab->map) < 0){
     return -1;
   }
   return 0;
@@ -832,20 +1605,61 @@ write_sixel(fbuf* f, int outy, int outx, const sixeltable* stab,
 // OPAQUE_SIXEL or MIXED_SIXEL, but an auxvec is present) is restored to the
 // payload, and the auxvec is freed. none of this takes effect until the sixel
 // is redrawn, and annihilated sprixcells still require a glyph to be emitted.
+// only those bands touched by wipes and rebuilds are regenerated; the others
+// are copied unchanged from the old glyph.
+static int
+sixel_reblit_bands(fbuf* f, const fbuf* old, int lenx, sixelmap* map){
+  int b = 0;
+  while(b < map->bandcount){
+    if(map->dirty[b]){
+      // write_sixel_bands() replaces bandoffs[b], but we won't need it again
+      if(write_sixel_bands(f, lenx, map, b, b + 1)){
+        return -1;
+      }
+      ++b;
+      continue;
+    }
+    // copy the run of clean bands in one go, shifting their offsets
+    int e = b + 1;
+    while(e < map->bandcount && !map->dirty[e]){
+      ++e;
+    }
+    const size_t ostart = map->bandoffs[b];
+    const size_t olen = map->bandoffs[e] - ostart;
+    const size_t nstart = f->used;
+    if(fbuf_putn(f, old->buf + ostart, olen) < 0){
+      return -1;
+    }
+    while(b < e){
+      map->bandoffs[b] = map->bandoffs[b] - ostart + nstart;
+      ++b;
+    }
+  }
+  map->bandoffs[map->bandcount] = f->used;
+  if(fbuf_puts(f, "\e\\") < 0){
+    return -1;
+  }
+  return 0;
+}
+
 static inline int
 sixel_reblit(sprixel* s){
   fbuf f;
   if(fbuf_init(&f)){
     return -1;
   }
+  sixelmap* smap = s->smap;
   if(fbuf_putn(&f, s->glyph.buf, s->parse_start) != s->parse_start){
     fbuf_free(&f);
     return -1;
   }
-  if(write_sixel_payload(&f, s->pixx, s->smap) < 0){
+  if(sixel_reblit_bands(&f, &s->glyph, s->pixx, smap) < 0){
+    // the band offsets might be partially updated; regenerate them all
+    memset(smap->dirty, 1, smap->bandcount);
     fbuf_free(&f);
     return -1;
   }
+  memset(smap->dirty, 0, smap->bandcount);
   fbuf_free(&s->glyph);
   // FIXME update P2 if necessary
   memcpy(&s->glyph, &f, sizeof(f));
@@ -859,56 +1673,207 @@ sixel_reblit(sprixel* s){
 // scaled geometry in pixels. We calculate output geometry herein, and supply
 // transparent filler input for any missing rows.
 static inline int
-sixel_blit_inner(int leny, int lenx, sixeltable* stab, sprixel* s, tament* tam){
-  fbuf f;
-  if(fbuf_init(&f)){
+sixel_blit_inner(int leny, int lenx, sixeltable* stab, fbuf* f, int* parse_start,
+                 sixelspan* spans, int spancount){
+  if(fbuf_init(f)){
     return -1;
   }
-  int parse_start = 0;
+  *parse_start = 0;
   int outy = leny;
   if(leny % 6){
     outy += 6 - (leny % 6);
     stab->p2 = SIXEL_P2_TRANS;
   }
-  // calls fclose() on success
-  if(write_sixel(&f, outy, lenx, stab, &parse_start, stab->p2)){
-    fbuf_free(&f);
+  if(write_sixel(f, outy, lenx, stab, parse_start, stab->p2, spans, spancount)){
+    fbuf_free(f);
     return -1;
   }
-  scrub_tam_boundaries(tam, outy, lenx, s->cellpxy, s->cellpxx);
-  // take ownership of buf on success
-  if(plane_blit_sixel(s, &f, outy, lenx, parse_start, tam, SPRIXEL_INVALIDATED) < 0){
-    fbuf_free(&f);
-    return -1;
-  }
-  // we're keeping the buf remnants
-  sixelmap_trim(stab->map);
-  s->smap = stab->map;
-  return 1;
+  return 0;
 }
 
-// |leny| and |lenx| are the scaled output geometry. we take |leny| up to the
-// nearest multiple of six greater than or equal to |leny|.
-int sixel_blit(ncplane* n, int linesize, const void* data, int leny, int lenx,
-               const blitterargs* bargs){
+// quantize and encode the sixel into |f| using bargs->u.pixel.colorregs
+// registers, updating |tam| along the way. on success, |*map| is the new
+// sixelmap, and the caller owns both it and |f|.
+static int
+sixel_encode(fbuf* f, sixelmap** map, int* parse_start, const uint32_t* data,
+             int linesize, int cols, int leny, int lenx, tament* tam,
+             const blitterargs* bargs){
   int colorregs = bargs->u.pixel.colorregs;
   if(colorregs > 256){
     colorregs = 256;
   }
-  assert(colorregs >= 64);
   sixeltable stable = {
     .map = sixelmap_create(colorregs, leny - bargs->begy, lenx - bargs->begx),
     .deets = malloc(colorregs * sizeof(cdetails)),
     .colorregs = colorregs,
     .p2 = SIXEL_P2_ALLOPAQUE,
+    .hist = NULL,
+    .spal = NULL,
   };
-  if(stable.deets == NULL || stable.map == NULL){
+  // a carried palette is always built by median cut
+  const bool mcut = bargs->flags & (NCVISUAL_OPTION_MEDIANCUT | NCVISUAL_OPTION_KEEPPALETTE);
+  if(mcut){
+    stable.hist = calloc(MCUT_BINS, sizeof(*stable.hist));
+  }
+  if((bargs->flags & NCVISUAL_OPTION_KEEPPALETTE) && bargs->u.pixel.spal){
+    if(*bargs->u.pixel.spal == NULL){
+      *bargs->u.pixel.spal = sixelpalette_create();
+    }
+    stable.spal = *bargs->u.pixel.spal;
+  }
+  if(stable.deets == NULL || stable.map == NULL || (mcut && stable.hist == NULL) ||
+     ((bargs->flags & NCVISUAL_OPTION_KEEPPALETTE) && bargs->u.pixel.spal && stable.spal == NULL)){
     sixelmap_free(stable.map);
     free(stable.deets);
+    free(stable.hist);
     return -1;
   }
   // stable.table doesn't need initializing; we start from the bottom
   memset(stable.deets, 0, sizeof(*stable.deets) * colorregs);
+  sixelspan* spans = NULL;
+  int spancount = 0;
+  if(bargs->flags & NCVISUAL_OPTION_THREADED){
+    spancount = sixelspans_create(&spans, data, linesize, cols, leny, lenx,
+                                  &stable, tam, bargs);
+  }
+  int extracted;
+  if(spancount){
+    extracted = extract_color_table_spans(spans, spancount, &stable);
+  }else{
+    extracted = extract_color_table(data, linesize, cols, leny, lenx, &stable, tam, bargs);
+  }
+  if(extracted){
+    sixelspans_free(spans, spancount);
+    sixelmap_free(stable.map);
+    free(stable.deets);
+    free(stable.hist);
+    return -1;
+  }
+  if(stable.hist){
+    if(!spancount){
+      sixelspan whole;
+      sixelspan_init(&whole, data, linesize, cols, leny, lenx, 0, leny,
+                     &stable, tam, bargs);
+      span_assign(&whole);
+      mcut_fill_table(&stable);
+    }
+    free(stable.hist);
+    stable.hist = NULL;
+  }else{
+    refine_color_table(data, linesize, bargs->begy, bargs->begx, leny, lenx, &stable);
+  }
+  int r = sixel_blit_inner(leny, lenx, &stable, f, parse_start, spans, spancount);
+  sixelspans_free(spans, spancount);
+  free(stable.deets);
+  if(r < 0){
+    sixelmap_free(stable.map);
+    return -1;
+  }
+  *map = stable.map;
+  return 0;
+}
+
+// fewest registers we'll drop to in pursuit of a byte budget
+#define SIXEL_BUDGET_MINREGS 8
+
+// encode within bargs->u.pixel.budget bytes, if a budget was provided. the
+// encoded size is dominated by the colors present in each band, so we retry
+// with median cut over fewer registers until we fit. a sixel which can't be
+// brought under budget with SIXEL_BUDGET_MINREGS is emitted anyway.
+static int
+sixel_encode_budgeted(fbuf* f, sixelmap** map, int* parse_start, const uint32_t* data,
+                      int linesize, int cols, int leny, int lenx, tament* tam,
+                      const blitterargs* bargs){
+  const size_t budget = bargs->u.pixel.budget;
+  int* hint = bargs->u.pixel.budgetregs;
+  blitterargs b = *bargs;
+  int colorregs = b.u.pixel.colorregs > 256 ? 256 : b.u.pixel.colorregs;
+  int regs = colorregs;
+  // start from wherever the last frame settled
+  if(budget && hint && *hint > 0 && *hint < regs){
+    regs = *hint;
+    b.flags |= NCVISUAL_OPTION_MEDIANCUT;
+  }
+  b.u.pixel.colorregs = regs;
+  if(sixel_encode(f, map, parse_start, data, linesize, cols, leny, lenx, tam, &b)){
+    return -1;
+  }
+  if(budget == 0){
+    return 0;
+  }
+  // the first pass updated the refresh matrix from the TAM's prior state,
+  // which it has since overwritten. keep the retries away from it.
+  sprixel* s = bargs->u.pixel.spx;
+  unsigned char* rmatrix = s->needs_refresh;
+  s->needs_refresh = NULL;
+  int ret = 0;
+  int prevcolors = 0;
+  size_t prevused = 0;
+  while(f->used > budget && regs > SIXEL_BUDGET_MINREGS){
+    // encoded size grows roughly linearly in the log of the colors used. fit
+    // a line through the last two median cut encodings where we have them
+    // (otherwise through the origin), and aim a bit below the budget.
+    const int colors = (*map)->colors;
+    const double target = budget * 0.95;
+    const double lc = log2(colors > 2 ? colors : 2);
+    double nlc;
+    if(prevused > f->used && prevcolors > colors){
+      const double slope = (prevused - f->used) / (log2(prevcolors) - lc);
+      nlc = lc - (f->used - target) / slope;
+    }else{
+      nlc = lc * target / f->used;
+    }
+    int nregs = exp2(nlc);
+    if(nregs >= colors){
+      nregs = colors - 1;
+    }
+    if(nregs < colors / 8){
+      nregs = colors / 8;
+    }
+    if(nregs < SIXEL_BUDGET_MINREGS){
+      nregs = SIXEL_BUDGET_MINREGS;
+    }
+    // the default quantizer's sizes don't predict those of median cut
+    if(b.flags & NCVISUAL_OPTION_MEDIANCUT){
+      prevcolors = colors;
+      prevused = f->used;
+    }
+    fbuf_free(f);
+    sixelmap_free(*map);
+    regs = nregs;
+    b.u.pixel.colorregs = regs;
+    b.flags |= NCVISUAL_OPTION_MEDIANCUT;
+    if(sixel_encode(f, map, parse_start, data, linesize, cols, leny, lenx, tam, &b)){
+      ret = -1;
+      break;
+    }
+  }
+  s->needs_refresh = rmatrix;
+  if(ret){
+    return -1;
+  }
+  if(f->used > budget){
+    logwarn("%dx%d sixel is %zuB with %d registers (budget %zuB)\n",
+            leny, lenx, f->used, regs, budget);
+  }else{
+    loginfo("%dx%d sixel is %zuB with %d registers (budget %zuB)\n",
+            leny, lenx, f->used, regs, budget);
+  }
+  if(hint){
+    // leave room to climb back up once the content allows it
+    if(regs < colorregs && f->used <= budget / 4 * 3){
+      regs += regs / 4;
+    }
+    *hint = regs >= colorregs ? 0 : regs;
+  }
+  return 0;
+}
+
+// |leny| and |lenx| are the scaled output geometry. we take |leny| up to the
+// nearest multiple of six greater than or equal to |leny|.
+int sixel_blit(ncplane* n, int linesize, const void* data, int leny, int lenx,
+               const blitterargs* bargs){
+  assert(bargs->u.pixel.colorregs >= 64);
   int cols = bargs->u.pixel.spx->dimx;
   int rows = bargs->u.pixel.spx->dimy;
   tament* tam = NULL;
@@ -924,8 +1889,6 @@ int sixel_blit(ncplane* n, int linesize, const void* data, int leny, int lenx,
   if(!reuse){
     tam = malloc(sizeof(*tam) * rows * cols);
     if(tam == NULL){
-      sixelmap_free(stable.map);
-      free(stable.deets);
       return -1;
     }
     memset(tam, 0, sizeof(*tam) * rows * cols);
@@ -933,30 +1896,37 @@ int sixel_blit(ncplane* n, int linesize, const void* data, int leny, int lenx,
     typeof(bargs->u.pixel.spx->needs_refresh) rmatrix;
     rmatrix = malloc(sizeof(*rmatrix) * rows * cols);
     if(rmatrix == NULL){
-      sixelmap_free(stable.map);
-      free(stable.deets);
       return -1;
     }
     bargs->u.pixel.spx->needs_refresh = rmatrix;
   }
-  if(extract_color_table(data, linesize, cols, leny, lenx, &stable, tam, bargs)){
+  fbuf f;
+  sixelmap* map;
+  int parse_start;
+  if(sixel_encode_budgeted(&f, &map, &parse_start, data, linesize, cols,
+                           leny, lenx, tam, bargs)){
     if(!reuse){
       free(tam);
     }
     free(bargs->u.pixel.spx->needs_refresh);
-    sixelmap_free(stable.map);
-    free(stable.deets);
     return -1;
   }
-  refine_color_table(data, linesize, bargs->begy, bargs->begx, leny, lenx, &stable);
-  // takes ownership of sixelmap on success
-  int r = sixel_blit_inner(leny, lenx, &stable, bargs->u.pixel.spx, tam);
-  if(r < 0){
-    sixelmap_free(stable.map);
+  const int outy = leny + (leny % 6 ? 6 - leny % 6 : 0);
+  scrub_tam_boundaries(tam, outy, lenx, bargs->u.pixel.spx->cellpxy,
+                       bargs->u.pixel.spx->cellpxx);
+  // take ownership of buf on success
+  if(plane_blit_sixel(bargs->u.pixel.spx, &f, outy, lenx, parse_start, tam,
+                      SPRIXEL_INVALIDATED) < 0){
+    fbuf_free(&f);
+    sixelmap_free(map);
+    scrub_color_table(bargs->u.pixel.spx);
+    return -1;
   }
-  free(stable.deets);
+  // we're keeping the buf remnants
+  sixelmap_trim(map);
+  bargs->u.pixel.spx->smap = map;
   scrub_color_table(bargs->u.pixel.spx);
-  return r;
+  return 1;
 }
 
 // to destroy a sixel, we damage all cells underneath it. we might not have
@@ -1073,6 +2043,11 @@ int sixel_rebuild(sprixel* s, int ycell, int xcell, uint8_t* auxvec){
     endy = s->pixy;
   }
   int transparent = 0;
+  int endband = endy / 6;
+  if(endband >= smap->bandcount){
+    endband = smap->bandcount - 1;
+  }
+  memset(smap->dirty + starty / 6, 1, endband - starty / 6 + 1);
 //fprintf(stderr, "%d/%d start: %d/%d end: %d/%d bands: %d-%d\n", ycell, xcell, starty, startx, endy, endx, starty / 6, endy / 6);
   for(int x = startx ; x <= endx ; ++x){
     for(int y = starty ; y <= endy ; ++y){
@@ -1087,6 +2062,7 @@ int sixel_rebuild(sprixel* s, int ycell, int xcell, uint8_t* auxvec){
         int xoff = boff + x;
 //fprintf(stderr, "DIDX: %d %d/%d band: %d coff: %d boff: %d rebuild %d/%d with color %d from %d %p xoff: %d\n", didx, ycell, xcell, band, coff, boff, y, x, color, auxvecidx, auxvec, xoff);
         s->smap->data[xoff] |= (1u << (y % 6));
+        sixelmap_mark(smap, didx, band);
       }else{
         ++transparent;
       }
@@ -43,6 +43,8 @@ void sprixel_free(sprixel* s){
     }
     sixelmap_free(s->smap);
     free(s->needs_refresh);
+    kitty_release_media(s);
+    kitty_release_image(s);
     fbuf_free(&s->glyph);
     free(s);
   }
@@ -55,8 +57,14 @@ sprixel* sprixel_recycle(ncplane* n){
     sprixel* hides = n->sprite;
     int dimy = hides->dimy;
     int dimx = hides->dimx;
+    sprixel* ret = sprixel_alloc(&nc->tcache, n, dimy, dimx);
+    if(ret){
+      // the new blit might only need update our image (see kitty_blit_core())
+      ret->kimg = hides->kimg;
+      hides->kimg = NULL;
+    }
     sprixel_hide(hides);
-    return sprixel_alloc(&nc->tcache, n, dimy, dimx);
+    return ret;
   }
   sixelmap_free(n->sprite->smap);
   n->sprite->smap = NULL;
@@ -114,6 +122,16 @@ void sprixel_invalidate(sprixel* s, int y, int x){
   }
 }
 
+// sprixel ids and kitty image ids are drawn from the same space
+uint32_t sprixel_newid(void){
+  uint32_t id = ++sprixelid_nonce;
+  if(id >= 0x1000000){
+    id = 1;
+    sprixelid_nonce = 1;
+  }
+  return id;
+}
+
 sprixel* sprixel_alloc(const tinfo* ti, ncplane* n, int dimy, int dimx){
   sprixel* ret = malloc(sizeof(sprixel));
   if(ret == NULL){
@@ -127,12 +145,9 @@ sprixel* sprixel_alloc(const tinfo* ti, ncplane* n, int dimy, int dimx){
   ret->n = n;
   ret->dimy = dimy;
   ret->dimx = dimx;
-  ret->id = ++sprixelid_nonce;
+  ret->id = sprixel_newid();
   ret->needs_refresh = NULL;
-  if(ret->id >= 0x1000000){
-    ret->id = 1;
-    sprixelid_nonce = 1;
-  }
+  ret->imgid = ret->id;
 //fprintf(stderr, "LOOKING AT %p (p->n = %p)\n", ret, ret->n);
   ret->cellpxy = ti->cellpixy;
   ret->cellpxx = ti->cellpixx;
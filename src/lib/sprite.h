@@ -150,6 +150,18 @@ typedef struct sprixel {
   int movedfromx;       // so that we can damage old cells when redrawn
   // only used for kitty-based sprixels
   int parse_start;      // where to start parsing for cell wipes
+  // transmission mediums referenced by the glyph, each a NUL-terminated
+  // kitty medium character ('s' or 't') followed by its name. the terminal
+  // deletes them once loaded; we must do so if the glyph is never drawn.
+  char* media;
+  size_t medialen;
+  // the kitty image placed by this sprixel. this is usually its own id, but
+  // identical images are uploaded once per context and shared (see kimg),
+  // and a sprixel replacing another might update the latter's image. one
+  // modifying a shared image uploads a copy under a fresh id. all commands
+  // addressing the image (rather than the placement) use this id.
+  uint32_t imgid;
+  struct kittyimage* kimg; // cached image we hold a reference to, or NULL
   // only used for sixel-based sprixels
   unsigned char* needs_refresh; // one per cell, whether new frame needs damage
   struct sixelmap* smap;  // copy of palette indices + transparency bits
@@ -181,11 +193,24 @@ int kitty_move(sprixel* s, fbuf* f, unsigned noscroll);
 int sixel_scrub(const struct ncpile* p, sprixel* s);
 int kitty_scrub(const struct ncpile* p, sprixel* s);
 int fbcon_scrub(const struct ncpile* p, sprixel* s);
-int kitty_remove(int id, fbuf* f);
+int kitty_remove(int id, int imgid, fbuf* f);
 int kitty_clear_all(fbuf* f);
 int sixel_init(const tinfo* t, int fd);
 int sixel_init_inverted(const tinfo* t, int fd);
 int kitty_shutdown(fbuf* f);
+// delete any transmission mediums the terminal never received.
+void kitty_release_media(sprixel* s);
+// drop the sprixel's reference to any cached image it places.
+void kitty_release_image(sprixel* s);
+// a cache of uploaded kitty images, shared by a context's sprixels.
+struct kittycache* kitty_cache_create(void);
+void kitty_cache_free(struct kittycache* kc);
+// write to |f| a query asking the terminal to load a 1x1 image through
+// |medium|. the medium's tagged name is written to |tagged|; pass it to
+// kitty_unlink_medium() once the reply has arrived (or failed to).
+int kitty_probe_medium(fbuf* f, kitty_medium_e medium, char* tagged, size_t tlen);
+#define KITTY_MEDIUM_TAGLEN 256 // longer names (under a deep $TMPDIR) fail
+void kitty_unlink_medium(const char* tagged);
 int sixel_shutdown(fbuf* f);
 uint8_t* sixel_trans_auxvec(const struct tinfo* ti);
 uint8_t* kitty_trans_auxvec(const struct tinfo* ti);
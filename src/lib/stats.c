@@ -71,6 +71,20 @@ void update_raster_stats(const struct timespec* time1, const struct timespec* ti
   }
 }
 
+// bytes per second we've managed to get to the terminal over the lifetime of
+// the context, or 0 if we haven't yet written enough to say. writeouts are
+// timed from the end of rendering, so this somewhat underestimates the tty.
+uint64_t tty_bytes_per_sec(notcurses* nc){
+  pthread_mutex_lock(&nc->stats.lock);
+    uint64_t bytes = nc->stats.s.render_bytes + nc->stashed_stats.render_bytes;
+    uint64_t ns = nc->stats.s.writeout_ns + nc->stashed_stats.writeout_ns;
+  pthread_mutex_unlock(&nc->stats.lock);
+  if(bytes < TTYBPS_MINBYTES || ns == 0){
+    return 0;
+  }
+  return (uint64_t)((double)bytes * NANOSECS_IN_SEC / ns);
+}
+
 void reset_stats(ncstats* stats){
   uint64_t fbbytes = stats->fbbytes;
   unsigned planes = stats->planes;
@@ -152,6 +166,8 @@ void notcurses_stats_reset(notcurses* nc, ncstats* stats){
     stash->appsync_updates += nc->stats.s.appsync_updates;
     stash->input_errors += nc->stats.s.input_errors;
     stash->input_events += nc->stats.s.input_events;
+    stash->blitcache_hits += nc->stats.s.blitcache_hits;
+    stash->blitcache_misses += nc->stats.s.blitcache_misses;
 
     stash->fbbytes = nc->stats.s.fbbytes;
     stash->planes = nc->stats.s.planes;
@@ -239,4 +255,9 @@ void summarize_stats(notcurses* nc){
           stats->render_bytes ? (stats->sprixelbytes * 100.0) / stats->render_bytes : 0,
           stats->appsync_updates,
           stats->writeouts ? stats->appsync_updates * 100.0 / stats->writeouts : 0);
+  if(stats->blitcache_hits || stats->blitcache_misses){
+    fprintf(stderr, "%sBlit cache hits:misses: %"PRIu64":%"PRIu64" (%.2f%%)\n",
+            clreol, stats->blitcache_hits, stats->blitcache_misses,
+            (stats->blitcache_hits * 100.0) / (stats->blitcache_hits + stats->blitcache_misses));
+  }
 }
@@ -390,30 +390,62 @@ init_terminfo_esc(tinfo* ti, const char* name, escape_e idx,
 // maybe that works, maybe it doesn't. then query both color registers
 // and geometry. send XTGETTCAP for terminal name. if 'minimal' is set, don't
 // send any identification queries (we've already identified the terminal).
+// |probes| (if not empty) go out with the identification queries, ahead of
+// the Primary Device Attributes which terminate our replies.
 static int
-send_initial_queries(int fd, bool minimal, bool noaltscreen){
+send_initial_queries(int fd, bool minimal, bool noaltscreen, const fbuf* probes){
   const char *queries;
   if(noaltscreen){
     if(minimal){
-      queries = DSRCPR DIRECTIVES;
+      queries = DSRCPR;
     }else{
-      queries = DSRCPR IDQUERIES DIRECTIVES;
+      queries = DSRCPR IDQUERIES;
     }
   }else{
     if(minimal){
-      queries = SMCUP DSRCPR DIRECTIVES;
+      queries = SMCUP DSRCPR;
     }else{
-      queries = SMCUP DSRCPR IDQUERIES DIRECTIVES;
+      queries = SMCUP DSRCPR IDQUERIES;
     }
   }
   size_t len = strlen(queries);
-  loginfo("sending %lluB queries\n", (unsigned long long)len);
+  loginfo("sending %lluB queries\n", (unsigned long long)(len + probes->used + strlen(DIRECTIVES)));
   if(blocking_write(fd, queries, len)){
     return -1;
   }
+  if(probes->used){
+    if(blocking_write(fd, probes->buf, probes->used)){
+      return -1;
+    }
+  }
+  if(blocking_write(fd, DIRECTIVES, strlen(DIRECTIVES))){
+    return -1;
+  }
   return 0;
 }
 
+// ask the terminal to load a pixel through each kitty transmission medium
+// which avoids the tty. terminals lacking kitty graphics will ignore these,
+// as they ignore KITTYQUERY. the mediums are named in |tagged|.
+static void
+build_kitty_probes(fbuf* probes, char tagged[][KITTY_MEDIUM_TAGLEN]){
+  const kitty_medium_e mediums[] = { KITTY_MEDIUM_SHM, KITTY_MEDIUM_FILE, };
+  for(size_t i = 0 ; i < sizeof(mediums) / sizeof(*mediums) ; ++i){
+    if(kitty_probe_medium(probes, mediums[i], tagged[i], KITTY_MEDIUM_TAGLEN)){
+      loginfo("Couldn't probe kitty medium %d\n", mediums[i]);
+    }
+  }
+}
+
+// whatever the terminal did with our probes, they're of no further use.
+static void
+unlink_kitty_probes(char tagged[][KITTY_MEDIUM_TAGLEN], size_t count){
+  for(size_t i = 0 ; i < count ; ++i){
+    kitty_unlink_medium(tagged[i]);
+    tagged[i][0] = '\0';
+  }
+}
+
 // if we get a response to the standard cursor locator escape, we know this
 // terminal supports it, hah.
 static int
@@ -720,7 +752,10 @@ macos_early_matches(void){
 // full round trip before getting the reply, which is likely to pace init.
 int interrogate_terminfo(tinfo* ti, const char* termtype, FILE* out, unsigned utf8,
                          unsigned noaltscreen, unsigned nocbreak, unsigned nonewfonts,
-                         int* cursor_y, int* cursor_x, ncsharedstats* stats){
+                         unsigned nokittyshm, int* cursor_y, int* cursor_x,
+                         ncsharedstats* stats){
+  // names of any kitty medium probes we've sent, unlinked once answered
+  char kprobes[2][KITTY_MEDIUM_TAGLEN] = { "", "", };
   int foolcursor_x, foolcursor_y;
   if(!cursor_x){
     cursor_x = &foolcursor_x;
@@ -776,9 +811,18 @@ int interrogate_terminfo(tinfo* ti, const char* termtype, FILE* out, unsigned ut
     // if we already know our terminal (e.g. on the linux console), there's no
     // need to send the identification queries. the controls are sufficient.
     bool minimal = (ti->qterm != TERMINAL_UNKNOWN);
-    if(send_initial_queries(ti->ttyfd, minimal, noaltscreen)){
+    fbuf probes;
+    if(fbuf_init(&probes)){
+      goto err;
+    }
+    if(!minimal && !nokittyshm){
+      build_kitty_probes(&probes, kprobes);
+    }
+    if(send_initial_queries(ti->ttyfd, minimal, noaltscreen, &probes)){
+      fbuf_free(&probes);
       goto err;
     }
+    fbuf_free(&probes);
   }
 #ifndef __MINGW64__
   // windows doesn't really have a concept of terminfo. you might ssh into other
@@ -837,6 +881,7 @@ int interrogate_terminfo(tinfo* ti, const char* termtype, FILE* out, unsigned ut
     { ESCAPE_RC, "rc", },
     { ESCAPE_IND, "ind", },
     { ESCAPE_INDN, "indn", },
+    { ESCAPE_CSR, "csr", },
     { ESCAPE_CLEAR, "clear", },
     { ESCAPE_OC, "oc", },
     { ESCAPE_RMKX, "rmkx", },
@@ -918,8 +963,10 @@ int interrogate_terminfo(tinfo* ti, const char* termtype, FILE* out, unsigned ut
   }
   unsigned appsync_advertised = 0;
   unsigned kittygraphs = 0;
-  if(ncinputlayer_init(ti, stdin, &ti->qterm, &appsync_advertised,
-                       cursor_y, cursor_x, stats, &kittygraphs)){
+  int ncret = ncinputlayer_init(ti, stdin, &ti->qterm, &appsync_advertised,
+                                cursor_y, cursor_x, stats, &kittygraphs);
+  unlink_kitty_probes(kprobes, sizeof(kprobes) / sizeof(*kprobes));
+  if(ncret){
     goto err;
   }
   if(nocbreak){
@@ -961,6 +1008,7 @@ int interrogate_terminfo(tinfo* ti, const char* termtype, FILE* out, unsigned ut
   return 0;
 
 err:
+  unlink_kitty_probes(kprobes, sizeof(kprobes) / sizeof(*kprobes));
   // FIXME need to leave alternate screen if we entered it
   if(ti->tpreserved){
     (void)tcsetattr(ti->ttyfd, TCSANOW, ti->tpreserved);
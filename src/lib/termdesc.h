@@ -10,7 +10,9 @@ extern "C" {
 #include "version.h"
 #include "builddef.h"
 #include "input.h"
+#include <stdio.h>
 #include <stdint.h>
+#include <string.h>
 #include <pthread.h>
 #include <stdbool.h>
 #include <notcurses/notcurses.h>
@@ -65,6 +67,7 @@ typedef enum {
   ESCAPE_RMXX,    // "rmxx" end struckout
   ESCAPE_IND,     // "ind" scroll 1 line up
   ESCAPE_INDN,    // "indn" scroll n lines up
+  ESCAPE_CSR,     // "csr" change scrolling region (DECSTBM)
   ESCAPE_SC,      // "sc" push the cursor onto the stack
   ESCAPE_RC,      // "rc" pop the cursor off the stack
   ESCAPE_CLEAR,   // "clear" clear screen and home cursor
@@ -79,6 +82,41 @@ typedef enum {
   ESCAPE_MAX
 } escape_e;
 
+// how kitty graphics payloads reach the terminal. anything other than
+// direct transmission requires the terminal to share our machine; we only
+// use a medium after the terminal has successfully loaded a probe through
+// it. ordered by preference.
+typedef enum {
+  KITTY_MEDIUM_DIRECT,  // t=d: base64 through the tty (always available)
+  KITTY_MEDIUM_FILE,    // t=t: temporary file, deleted by the terminal
+  KITTY_MEDIUM_SHM,     // t=s: POSIX shared memory, unlinked by the terminal
+} kitty_medium_e;
+
+// kitty replies to probes for a medium using this query id
+#define KITTY_MEDIUM_QID(medium) (2 + (int)(medium))
+
+// kitty replies to our medium probes with "i=QID;OK" if it was able to load
+// the pixel through that medium, and an error otherwise. returns the better
+// of |best| and any medium accepted by |reply|.
+static inline kitty_medium_e
+kitty_medium_reply(kitty_medium_e best, const char* reply){
+  const char* semi = strchr(reply, ';');
+  if(semi == NULL || strcmp(semi + 1, "OK")){
+    return best;
+  }
+  int qid;
+  if(sscanf(reply, "i=%d;", &qid) != 1){
+    return best;
+  }
+  const kitty_medium_e mediums[] = { KITTY_MEDIUM_FILE, KITTY_MEDIUM_SHM, };
+  for(size_t i = 0 ; i < sizeof(mediums) / sizeof(*mediums) ; ++i){
+    if(qid == KITTY_MEDIUM_QID(mediums[i]) && mediums[i] > best){
+      best = mediums[i];
+    }
+  }
+  return best;
+}
+
 // when we read a cursor report, we put it on the queue for internal
 // processing. this is necessary since it can be arbitrarily interleaved with
 // other input when stdin is connected to our terminal. these are already
@@ -163,7 +201,7 @@ typedef struct tinfo {
   // redrawn in a sixel (when old was not transparent, and new is not opaque).
   // it leaves the sprixel in INVALIDATED so that it's drawn in phase 2.
   void (*pixel_refresh)(const struct ncpile* p, struct sprixel* s);
-  int (*pixel_remove)(int id, fbuf* f); // kitty only, issue actual delete command
+  int (*pixel_remove)(int id, int imgid, fbuf* f); // kitty only, issue actual delete command
   int (*pixel_init)(const struct tinfo*, int fd); // called when support is detected
   int (*pixel_draw)(const struct tinfo*, const struct ncpile* p,
                     struct sprixel* s, fbuf* f, int y, int x);
@@ -207,6 +245,7 @@ typedef struct tinfo {
   int default_cols;          // COLUMNS environment var / cols terminfo / 80
 
   unsigned kittykbd;         // kitty keyboard support level
+  kitty_medium_e kittymedium;// best kitty transmission medium verified
 
   int gpmfd;                 // connection to GPM daemon
   pthread_t gpmthread;       // thread handle for GPM watcher
@@ -245,13 +284,15 @@ term_supported_styles(const tinfo* ti){
 
 // prepare |ti| from the terminfo database and other sources. set |utf8| if
 // we've verified UTF8 output encoding. set |noaltscreen| to inhibit alternate
-// screen detection. |stats| may be NULL; either way, it will be handed to the
+// screen detection. set |nokittyshm| to inhibit probing for kitty graphics
+// transmission mediums other than the tty. |stats| may be NULL; either way, it will be handed to the
 // input layer so that its stats can be recorded. if |termtype| is not NULL, it
 // will be used to look up the terminfo database entry; the value of TERM is
 // otherwise used.
 int interrogate_terminfo(tinfo* ti, const char* termtype, FILE* out,
                          unsigned utf8, unsigned noaltscreen, unsigned nocbreak,
-                         unsigned nonewfonts, int* cursor_y, int* cursor_x,
+                         unsigned nonewfonts, unsigned nokittyshm,
+                         int* cursor_y, int* cursor_x,
                          struct ncsharedstats* stats);
 
 void free_terminfo_cache(tinfo* ti);
@@ -0,0 +1,54 @@
+#include "internal.h"
+
+// pages of the codepoint property table, populated on first use. a page is
+// never modified once published, and never freed.
+const uint8_t* ucs_pages[UCS_PAGECOUNT];
+
+// reduce libunistring's grapheme break property to the classes we can decide
+// with a table lookup. anything participating in a rule beyond GB9, GB9a, and
+// GB9b (controls, Hangul jamo, regional indicators, emoji modifiers) is left
+// to uc_is_grapheme_break().
+static uint8_t
+ucs_gbclass(ucs4_t wc){
+  switch(uc_graphemeclusterbreak_property(wc)){
+    case GBP_OTHER:
+      return UCS_GB_OTHER;
+    case GBP_EXTEND:
+    case GBP_ZWJ:
+    case GBP_SPACINGMARK:
+      return UCS_GB_EXTEND;
+    case GBP_PREPEND:
+      return UCS_GB_PREPEND;
+    default:
+      return UCS_GB_COMPLEX;
+  }
+}
+
+const uint8_t* ucs_page_populate(uint32_t page){
+  // wcwidth() is only meaningful (and stable) under a UTF-8 locale. if we're
+  // called prior to setlocale(), don't cache what would be a wrong answer.
+  if(MB_CUR_MAX <= 1){
+    return NULL;
+  }
+  uint8_t* p = malloc(UCS_PAGESIZE);
+  if(p == NULL){
+    return NULL;
+  }
+  for(unsigned i = 0 ; i < UCS_PAGESIZE ; ++i){
+    wchar_t wc = (wchar_t)(page * UCS_PAGESIZE + i);
+    int cols = wcwidth(wc);
+    if(cols < -1 || cols > 2){ // can't be encoded; treat as prohibited
+      cols = -1;
+    }
+    p[i] = (uint8_t)(cols + 1) | (ucs_gbclass(wc) << UCS_GB_SHIFT);
+  }
+  // another thread might have populated this page while we were working. if
+  // so, use theirs, and throw ours away.
+  const uint8_t* expected = NULL;
+  if(!__atomic_compare_exchange_n(&ucs_pages[page], &expected, p, false,
+                                  __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)){
+    free(p);
+    return expected;
+  }
+  return p;
+}
@@ -15,6 +15,26 @@ struct blitset;
 struct ncplane;
 struct sprixel;
 struct ncvisual_details;
+struct nccell;
+struct sixelpalette;
+
+// a cell blit memoized by NCVISUAL_OPTION_CACHED. everything which can change
+// the output of the blit is part of the key; the placement is not, and the
+// cells are replayed at whatever placement is requested.
+typedef struct blitcache {
+  struct nccell* cells;  // rows * cols blitted cells, NULL if entry is unused
+  int rows, cols;        // cell geometry of the blit
+  uint64_t generation;   // ncv->generation at the time of the blit
+  const struct blitset* bset;
+  int disprows, dispcols;// scaled pixel geometry
+  int begy, begx, leny, lenx;
+  uint64_t flags;        // only those flags affecting the output
+  uint32_t transcolor;
+  unsigned lastuse;      // ncv->blitclock at last hit, for eviction
+} blitcache;
+
+// number of memoized blits retained per ncvisual
+#define NCVISUAL_BLITCACHE 4
 
 // an ncvisual is essentially just an unpacked RGBA bitmap, created by
 // reading media from disk, supplying RGBA pixels directly in memory, or
@@ -26,6 +46,13 @@ typedef struct ncvisual {
   // lines are sometimes padded. this many true bytes per row in data.
   int rowstride;
   bool owndata; // we own data iff owndata == true
+  // bumped whenever data is replaced or modified, invalidating bcache
+  uint64_t generation;
+  blitcache* bcache;  // NCVISUAL_BLITCACHE entries, allocated on first use
+  unsigned blitclock; // incremented on each bcache lookup
+  struct sixelpalette* spal; // Sixel palette for NCVISUAL_OPTION_KEEPPALETTE
+  size_t pxbudget; // sixel byte budget (ncvisual_set_pxbudget()), 0 for none
+  int sixelregs; // registers last used to meet pxbudget
 } ncvisual;
 
 static inline void
@@ -38,6 +65,7 @@ ncvisual_set_data(ncvisual* ncv, void* data, bool owned){
   }
   ncv->data = (uint32_t*)data;
   ncv->owndata = owned;
+  ++ncv->generation;
 }
 
 // shrink one dimension to retrieve the original aspect ratio
@@ -102,6 +102,169 @@ int ncvisual_blit(ncvisual* ncv, int rows, int cols, ncplane* n,
   return ret;
 }
 
+// flags which change the cells produced by a blit, and thus key the cache
+#define BLITCACHE_FLAGS (NCVISUAL_OPTION_BLEND | NCVISUAL_OPTION_NOINTERPOLATE)
+
+static void
+ncvisual_drop_bcache(ncvisual* ncv){
+  if(ncv->bcache){
+    for(int i = 0 ; i < NCVISUAL_BLITCACHE ; ++i){
+      free(ncv->bcache[i].cells);
+    }
+    free(ncv->bcache);
+    ncv->bcache = NULL;
+  }
+}
+
+static inline bool
+blitcache_match(const blitcache* bc, const ncvisual* ncv, int rows, int cols,
+                const struct blitset* bset, const blitterargs* barg){
+  return bc->cells && bc->generation == ncv->generation && bc->bset == bset &&
+         bc->disprows == rows && bc->dispcols == cols &&
+         bc->begy == barg->begy && bc->begx == barg->begx &&
+         bc->leny == barg->leny && bc->lenx == barg->lenx &&
+         bc->flags == (barg->flags & BLITCACHE_FLAGS) &&
+         bc->transcolor == barg->transcolor;
+}
+
+// blit into a scratch plane placed at the origin, and take its cells. the
+// scratch plane starts out zeroed, so cells whose EGC the blitter left alone
+// (fully transparent cells) are recorded with a zero gcluster.
+static int
+blitcache_fill(blitcache* bc, ncvisual* ncv, int rows, int cols, ncplane* n,
+               const struct blitset* bset, const blitterargs* barg){
+  const int cellh = blitset_cellheight(bset);
+  struct ncplane_options nopts = {
+    .rows = rows / cellh + !!(rows % cellh),
+    .cols = cols / bset->width + !!(cols % bset->width),
+    .name = "bcch",
+  };
+  ncplane* scratch = ncpile_create(ncplane_notcurses(n), &nopts);
+  if(scratch == NULL){
+    return -1;
+  }
+  blitterargs sargs = *barg;
+  sargs.u.cell.placey = 0;
+  sargs.u.cell.placex = 0;
+  nccell* cells = NULL;
+  if(ncvisual_blit(ncv, rows, cols, scratch, bset, &sargs) == 0){
+    cells = malloc(sizeof(*cells) * nopts.rows * nopts.cols);
+  }
+  for(int y = 0 ; cells && y < (int)nopts.rows ; ++y){
+    const nccell* row = ncplane_row_peek(scratch, y);
+    nccell* dst = cells + y * nopts.cols;
+    if(row == NULL){
+      memset(dst, 0, sizeof(*dst) * nopts.cols);
+      continue;
+    }
+    for(int x = 0 ; x < (int)nopts.cols ; ++x){
+      if(cell_extended_p(&row[x])){ // never written by a blitter
+        free(cells);
+        cells = NULL;
+        break;
+      }
+      dst[x] = row[x];
+    }
+  }
+  ncplane_destroy(scratch);
+  if(cells == NULL){
+    return -1;
+  }
+  free(bc->cells);
+  bc->cells = cells;
+  bc->rows = nopts.rows;
+  bc->cols = nopts.cols;
+  bc->generation = ncv->generation;
+  bc->bset = bset;
+  bc->disprows = rows;
+  bc->dispcols = cols;
+  bc->begy = barg->begy;
+  bc->begx = barg->begx;
+  bc->leny = barg->leny;
+  bc->lenx = barg->lenx;
+  bc->flags = barg->flags & BLITCACHE_FLAGS;
+  bc->transcolor = barg->transcolor;
+  return 0;
+}
+
+// write the cached cells to 'n' at the requested placement, exactly as the
+// blitter would have: channels and styles are always written, but the EGC
+// is only replaced where the blitter supplied one.
+static int
+blitcache_replay(const blitcache* bc, ncplane* n, const blitterargs* barg){
+  const int placey = barg->u.cell.placey;
+  const int placex = barg->u.cell.placex;
+  int dimy, dimx;
+  ncplane_dim_yx(n, &dimy, &dimx);
+  int lasty = -1;
+  for(int y = placey < 0 ? -placey : 0 ; y < bc->rows && placey + y < dimy ; ++y){
+    const nccell* src = bc->cells + y * bc->cols;
+    for(int x = placex < 0 ? -placex : 0 ; x < bc->cols && placex + x < dimx ; ++x){
+      nccell* c = ncplane_cell_ref_yx(n, placey + y, placex + x);
+      if(c == NULL){
+        return -1;
+      }
+      c->channels = src[x].channels;
+      c->stylemask = src[x].stylemask;
+      if(src[x].gcluster){
+        pool_release(&n->pool, c);
+        c->gcluster = src[x].gcluster;
+        c->width = src[x].width;
+      }
+    }
+    lasty = placey + y;
+  }
+  // leave the cursor where the blitter would have
+  if(lasty >= 0){
+    if(ncplane_cursor_move_yx(n, lasty, placex < 0 ? 0 : placex)){
+      return -1;
+    }
+  }
+  return 0;
+}
+
+// NCVISUAL_OPTION_CACHED: replay a memoized blit of the same pixels, geometry,
+// blitter, and flags if we have one. otherwise, blit and memoize the result,
+// evicting the least recently used entry (entries made stale by changes to
+// the visual are freed as we come across them).
+static int
+ncvisual_blit_cached(ncvisual* ncv, int rows, int cols, ncplane* n,
+                     const struct blitset* bset, const blitterargs* barg){
+  if(ncv->bcache == NULL){
+    if((ncv->bcache = calloc(NCVISUAL_BLITCACHE, sizeof(*ncv->bcache))) == NULL){
+      return ncvisual_blit(ncv, rows, cols, n, bset, barg);
+    }
+  }
+  notcurses* nc = ncplane_notcurses(n);
+  ++ncv->blitclock;
+  blitcache* victim = &ncv->bcache[0];
+  for(int i = 0 ; i < NCVISUAL_BLITCACHE ; ++i){
+    blitcache* bc = &ncv->bcache[i];
+    if(bc->cells && bc->generation != ncv->generation){
+      free(bc->cells);
+      bc->cells = NULL;
+    }
+    if(blitcache_match(bc, ncv, rows, cols, bset, barg)){
+      bc->lastuse = ncv->blitclock;
+      pthread_mutex_lock(&nc->stats.lock);
+        ++nc->stats.s.blitcache_hits;
+      pthread_mutex_unlock(&nc->stats.lock);
+      return blitcache_replay(bc, n, barg);
+    }
+    if(victim->cells && (bc->cells == NULL || bc->lastuse < victim->lastuse)){
+      victim = bc;
+    }
+  }
+  pthread_mutex_lock(&nc->stats.lock);
+    ++nc->stats.s.blitcache_misses;
+  pthread_mutex_unlock(&nc->stats.lock);
+  if(blitcache_fill(victim, ncv, rows, cols, n, bset, barg)){
+    return ncvisual_blit(ncv, rows, cols, n, bset, barg);
+  }
+  victim->lastuse = ncv->blitclock;
+  return blitcache_replay(victim, n, barg);
+}
+
 // ncv constructors other than ncvisual_from_file() need to set up the
 // AVFrame* 'frame' according to their own data, which is assumed to
 // have been prepared already in 'ncv'.
@@ -144,7 +307,9 @@ int ncvisual_blitset_geom(const notcurses* nc, const tinfo* tcache,
   if(lenx == NULL){
     lenx = &fakelenx;
   }
-  if(vopts && vopts->flags >= (NCVISUAL_OPTION_NOINTERPOLATE << 1u)){
+  // 0x0080 is reserved for internal use
+  if(vopts && (vopts->flags >= (NCVISUAL_OPTION_KEEPPALETTE << 1u) ||
+               (vopts->flags & 0x0080ull))){
     logwarn("Warning: unknown ncvisual options %016jx\n", (uintmax_t)vopts->flags);
   }
   if(vopts && (vopts->flags & NCVISUAL_OPTION_CHILDPLANE) && !vopts->n){
@@ -868,7 +1033,14 @@ ncplane* ncvisual_render_cells(notcurses* nc, ncvisual* ncv, const struct blitse
   bargs.flags = flags;
   bargs.u.cell.placey = placey;
   bargs.u.cell.placex = placex;
-  if(ncvisual_blit(ncv, disprows, dispcols, n, bset, &bargs)){
+  bargs.u.cell.banded = false;
+  int r;
+  if(flags & NCVISUAL_OPTION_CACHED){
+    r = ncvisual_blit_cached(ncv, disprows, dispcols, n, bset, &bargs);
+  }else{
+    r = ncvisual_blit(ncv, disprows, dispcols, n, bset, &bargs);
+  }
+  if(r){
     ncplane_destroy(createdn);
     return NULL;
   }
@@ -1010,6 +1182,12 @@ ncplane* ncvisual_render_pixels(notcurses* nc, ncvisual* ncv, const struct blits
   bargs.lenx = lenx;
   bargs.flags = flags;
   bargs.u.pixel.colorregs = nc->tcache.color_registers;
+  bargs.u.pixel.spal = (flags & NCVISUAL_OPTION_KEEPPALETTE) ? &ncv->spal : NULL;
+  bargs.u.pixel.budget = ncv->pxbudget;
+  bargs.u.pixel.budgetregs = &ncv->sixelregs;
+  bargs.u.pixel.kittymedium = nc->tcache.kittymedium;
+  bargs.u.pixel.ttybps = tty_bytes_per_sec(nc);
+  bargs.u.pixel.kittycache = nc->kittycache;
   if(n->sprite == NULL){
     int cols = disppixx / nc->tcache.cellpixx + !!(disppixx % nc->tcache.cellpixx);
     int rows = outy / nc->tcache.cellpixy + !!(outy % nc->tcache.cellpixy);
@@ -1118,6 +1296,8 @@ ncvisual* ncvisual_from_plane(const ncplane* n, ncblitter_e blit, int begy, int
 
 void ncvisual_destroy(ncvisual* ncv){
   if(ncv){
+    ncvisual_drop_bcache(ncv);
+    sixelpalette_free(ncv->spal);
     if(visual_implementation.visual_destroy == NULL){
       if(ncv->owndata){
         free(ncv->data);
@@ -1158,6 +1338,13 @@ int ncvisual_set_yx(const struct ncvisual* n, int y, int x, uint32_t pixel){
     return -1;
   }
   n->data[y * (n->rowstride / 4) + x] = pixel;
+  // the pixels are modified through a const ncvisual; so too its generation
+  ++((ncvisual*)n)->generation;
+  return 0;
+}
+
+int ncvisual_set_pxbudget(ncvisual* n, size_t bytes){
+  n->pxbudget = bytes;
   return 0;
 }
 
@@ -1201,6 +1388,7 @@ int ncvisual_polyfill_yx(ncvisual* n, int y, int x, uint32_t rgba){
     return -1;
   }
   uint32_t* pixel = &n->data[y * (n->rowstride / 4) + x];
+  ++n->generation;
   return ncvisual_polyfill_recurse(n, y, x, rgba, *pixel);
 }
 
@@ -0,0 +1,73 @@
+#include <string>
+#include <vector>
+#include "main.h"
+#include "lib/base64.h"
+
+// the reference encoding, a triplet at a time
+static auto
+base64_scalar(const unsigned char* src, size_t len) -> std::string {
+  std::string ret;
+  char b64[4];
+  while(len >= 3){
+    base64x3(src, b64);
+    ret.append(b64, 4);
+    src += 3;
+    len -= 3;
+  }
+  if(len){
+    base64final(src, b64, len);
+    ret.append(b64, 4);
+  }
+  return ret;
+}
+
+static auto
+base64_bulk(const unsigned char* src, size_t len) -> std::string {
+  std::string ret((len + 2) / 3 * 4, '\0');
+  base64_encode(src, len, &ret[0]);
+  return ret;
+}
+
+TEST_CASE("Base64") {
+
+  SUBCASE("KnownVectors") {
+    auto enc = [](const char* s){
+      return base64_bulk(reinterpret_cast<const unsigned char*>(s), strlen(s));
+    };
+    CHECK("" == enc(""));
+    CHECK("TQ==" == enc("M"));
+    CHECK("TWE=" == enc("Ma"));
+    CHECK("TWFu" == enc("Man"));
+    CHECK("aGVsbG8sIHdvcmxkIQ==" == enc("hello, world!"));
+    CHECK("Pz4/Pj8+Pz4/Pj8+Pz4/Pj8+" == enc("?>?>?>?>?>?>?>?>?>"));
+  }
+
+  // the bulk encoder must agree with the triplet encoder at every length,
+  // including those leaving partial vector groups and final padding.
+  SUBCASE("BulkMatchesScalar") {
+    std::vector<unsigned char> src(1024);
+    unsigned seed = 1;
+    for(auto& c : src){
+      seed = seed * 1103515245 + 12345;
+      c = seed >> 16;
+    }
+    for(size_t len = 0 ; len <= src.size() ; ++len){
+      CHECK(base64_scalar(src.data(), len) == base64_bulk(src.data(), len));
+    }
+  }
+
+  // opaque RGBA pixels encode as their bytes do
+  SUBCASE("RGBA3MatchesBytes") {
+    uint32_t pixels[3];
+    for(int i = 0 ; i < 3 ; ++i){
+      pixels[i] = 0;
+      ncpixel_set_rgb8(&pixels[i], 0x13 * (i + 1), 0x57 * (i + 1), 0x9b * (i + 1));
+      ncpixel_set_a(&pixels[i], 0xc0 + i);
+    }
+    char out[17];
+    bool wipe[3] = { false, false, false };
+    base64_rgba3(pixels, 3, out, wipe, 0);
+    CHECK(base64_bulk(reinterpret_cast<const unsigned char*>(pixels), 12) == out);
+  }
+
+}
@@ -0,0 +1,238 @@
+#include "main.h"
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// these measure throughput rather than verifying behavior, and take a while.
+// they're skipped unless explicitly requested with --no-skip.
+
+static auto
+elapsed_ns(const struct timespec* start) -> uint64_t {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return timespec_to_ns(&now) - timespec_to_ns(start);
+}
+
+TEST_CASE("Benchmarks" * doctest::skip(true)) {
+  auto nc_ = testing_notcurses();
+  if(!nc_){
+    return;
+  }
+  struct ncplane* n_ = notcurses_stdplane(nc_);
+  REQUIRE(n_);
+
+  // ncplane_putstr() of ASCII log lines, against an EGC at a time
+  SUBCASE("PutstrAscii") {
+    struct ncplane_options nopts = {
+      .y = 0,
+      .x = 0,
+      .rows = 40,
+      .cols = 120,
+      .userptr = nullptr, .name = "bench", .resizecb = nullptr, .flags = 0,
+      .margin_b = 0, .margin_r = 0,
+    };
+    auto fast = ncplane_create(n_, &nopts);
+    REQUIRE(nullptr != fast);
+    auto slow = ncplane_create(n_, &nopts);
+    REQUIRE(nullptr != slow);
+    std::vector<std::string> logs;
+    size_t total = 0;
+    while(total < 1u << 24u){
+      std::string line = "2021-09-12 04:20:" + std::to_string(logs.size() % 60) +
+                         " INFO [worker-" + std::to_string(logs.size() % 17) +
+                         "] processed request " + std::to_string(logs.size()) +
+                         " in " + std::to_string(logs.size() * 7 % 1000) + "us";
+      total += line.size();
+      logs.emplace_back(std::move(line));
+    }
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(size_t i = 0 ; i < logs.size() ; ++i){
+      CHECK(0 < ncplane_putstr_yx(fast, i % nopts.rows, 0, logs[i].c_str()));
+    }
+    auto fastns = elapsed_ns(&start);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(size_t i = 0 ; i < logs.size() ; ++i){
+      const char* s = logs[i].c_str();
+      int y = i % nopts.rows;
+      int x = 0;
+      int sbytes;
+      while(*s){
+        CHECK(0 < ncplane_putegc_yx(slow, y, x, s, &sbytes));
+        y = x = -1;
+        s += sbytes;
+      }
+    }
+    auto slowns = elapsed_ns(&start);
+    char* c0 = ncplane_contents(fast, 0, 0, 0, 0);
+    char* c1 = ncplane_contents(slow, 0, 0, 0, 0);
+    REQUIRE(nullptr != c0);
+    REQUIRE(nullptr != c1);
+    CHECK(0 == strcmp(c0, c1));
+    free(c0);
+    free(c1);
+    std::cout << "putstr ASCII: " << total * 1000.0 / fastns << "MB/s, EGC path: "
+              << total * 1000.0 / slowns << "MB/s (" << total << "B)" << std::endl;
+    CHECK(0 == ncplane_destroy(fast));
+    CHECK(0 == ncplane_destroy(slow));
+  }
+
+  // reflow of 1MiB of text with ncplane_puttext(), and with an nclayout when
+  // fresh, when reused at the same width, and when refilled at a new width
+  SUBCASE("Reflow") {
+    struct ncplane_options nopts = {
+      .y = 0,
+      .x = 0,
+      .rows = 50,
+      .cols = 80,
+      .userptr = nullptr, .name = "bench", .resizecb = nullptr, .flags = 0,
+      .margin_b = 0, .margin_r = 0,
+    };
+    auto n = ncplane_create(n_, &nopts);
+    REQUIRE(nullptr != n);
+    ncplane_set_scrolling(n, true);
+    const char* words[] = {
+      "the", "quick", "brown", "fox", "jumps", "over", "lazy", "dogs",
+      "notcurses", "平仮名", "terminal", "Ünicode", "\U0001f982", "grapheme",
+    };
+    std::string text;
+    std::srand(1);
+    while(text.size() < 1u << 20u){
+      text += words[std::rand() % (sizeof(words) / sizeof(*words))];
+      text += std::rand() % 40 ? " " : "\n";
+    }
+    auto reflow = [&](auto&& put){
+      ncplane_erase(n);
+      struct timespec start;
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      size_t bytes;
+      CHECK(0 < put(&bytes));
+      CHECK(text.size() == bytes);
+      return elapsed_ns(&start);
+    };
+    auto textns = reflow([&](size_t* b){
+      return ncplane_puttext(n, 0, NCALIGN_LEFT, text.c_str(), b);
+    });
+    auto l = nclayout_create(text.c_str());
+    REQUIRE(nullptr != l);
+    auto firstns = reflow([&](size_t* b){
+      return ncplane_putlayout(n, 0, NCALIGN_LEFT, l, b);
+    });
+    auto reusens = reflow([&](size_t* b){
+      return ncplane_putlayout(n, 0, NCALIGN_LEFT, l, b);
+    });
+    CHECK(0 == ncplane_resize_simple(n, nopts.rows, nopts.cols + 20));
+    auto refillns = reflow([&](size_t* b){
+      return ncplane_putlayout(n, 0, NCALIGN_LEFT, l, b);
+    });
+    nclayout_destroy(l);
+    std::cout << "reflow " << text.size() << "B: puttext " << textns / 1000000.0
+              << "ms, layout first " << firstns / 1000000.0 << "ms, reused "
+              << reusens / 1000000.0 << "ms, new width "
+              << refillns / 1000000.0 << "ms" << std::endl;
+    CHECK(0 == ncplane_destroy(n));
+  }
+
+  // a terminal window being dragged about: a plane filled with text is resized
+  // through a series of nearby geometries, first in rows alone, then in both
+  // rows and columns. the plane is scrolled, so that its rows wrap.
+  SUBCASE("ResizeStorm") {
+    struct ncplane_options nopts = {
+      .y = 0,
+      .x = 0,
+      .rows = 200,
+      .cols = 300,
+      .userptr = nullptr, .name = "bench", .resizecb = nullptr, .flags = 0,
+      .margin_b = 0, .margin_r = 0,
+    };
+    auto n = ncplane_create(n_, &nopts);
+    REQUIRE(nullptr != n);
+    ncplane_set_scrolling(n, true);
+    for(int y = 0 ; y < nopts.rows * 3 / 2 ; ++y){
+      CHECK(0 < ncplane_printf(n, "row %d of text which is being dragged about\n", y));
+    }
+    const int steps = 20000;
+    auto storm = [&](bool cols){
+      struct timespec start;
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      for(int i = 0 ; i < steps ; ++i){
+        // wander within 40 of the original geometry
+        const int d = i % 80 < 40 ? i % 40 : 40 - i % 40;
+        CHECK(0 == ncplane_resize_simple(n, nopts.rows - d, nopts.cols - (cols ? d : 0)));
+      }
+      return elapsed_ns(&start) / steps;
+    };
+    auto rowsns = storm(false);
+    auto bothns = storm(true);
+    std::cout << "resize " << nopts.rows << "x" << nopts.cols << ": rows only "
+              << rowsns << "ns, rows and columns " << bothns << "ns" << std::endl;
+    CHECK(0 == ncplane_destroy(n));
+  }
+
+  // each cell blitter over a noisy gradient, some of it transparent, in
+  // nanoseconds per output cell
+  SUBCASE("Blitters") {
+    const int pixy = 768, pixx = 1024;
+    std::vector<uint32_t> data(pixy * pixx);
+    for(int y = 0 ; y < pixy ; ++y){
+      for(int x = 0 ; x < pixx ; ++x){
+        uint32_t r = x * 255 / pixx, g = y * 255 / pixy, b = std::rand() % 256;
+        uint32_t a = std::rand() % 16 ? 0xff : 0;
+        data[y * pixx + x] = htole((a << 24u) | (b << 16u) | (g << 8u) | r);
+      }
+    }
+    auto ncv = ncvisual_from_rgba(data.data(), pixy, pixx * 4, pixx);
+    REQUIRE(nullptr != ncv);
+    struct ncplane_options nopts = {
+      .y = 0,
+      .x = 0,
+      .rows = pixy,
+      .cols = pixx,
+      .userptr = nullptr, .name = "bench", .resizecb = nullptr, .flags = 0,
+      .margin_b = 0, .margin_r = 0,
+    };
+    auto n = ncplane_create(n_, &nopts);
+    REQUIRE(nullptr != n);
+    const struct {
+      ncblitter_e blitter;
+      int cellh, cellw;
+    } blitters[] = {
+      { NCBLIT_1x1, 1, 1, }, { NCBLIT_2x1, 2, 1, }, { NCBLIT_2x2, 2, 2, },
+      { NCBLIT_3x2, 3, 2, }, { NCBLIT_BRAILLE, 4, 2, },
+    };
+    // we never render the results, so use every blitter, whatever the
+    // terminal's capabilities
+    const auto caps = nc_->tcache.caps;
+    nc_->tcache.caps.halfblocks = nc_->tcache.caps.quadrants = true;
+    nc_->tcache.caps.sextants = nc_->tcache.caps.braille = true;
+    const int reps = 10;
+    for(const auto& b : blitters){
+      struct ncvisual_options vopts = {
+        .n = n,
+        .scaling = NCSCALE_NONE,
+        .y = 0, .x = 0,
+        .begy = 0, .begx = 0,
+        .leny = 0, .lenx = 0,
+        .blitter = b.blitter,
+        .flags = NCVISUAL_OPTION_NODEGRADE,
+        .transcolor = 0,
+      };
+      struct timespec start;
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      for(int i = 0 ; i < reps ; ++i){
+        CHECK(n == ncvisual_render(nc_, ncv, &vopts));
+      }
+      auto ns = elapsed_ns(&start);
+      const uint64_t cells = (uint64_t)reps * ((pixy + b.cellh - 1) / b.cellh) *
+                             ((pixx + b.cellw - 1) / b.cellw);
+      std::cout << "blit " << notcurses_str_blitter(b.blitter) << ": "
+                << (double)ns / cells << "ns/cell" << std::endl;
+    }
+    nc_->tcache.caps = caps;
+    CHECK(0 == ncplane_destroy(n));
+    ncvisual_destroy(ncv);
+  }
+
+  CHECK(0 == notcurses_stop(nc_));
+}
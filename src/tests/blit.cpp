@@ -1,4 +1,152 @@
 #include "main.h"
+#include <vector>
+#include "lib/blitsolve.h"
+
+// random 24-bit channels, drawn from a small palette some of the time, so
+// that we see plenty of ties and uniform blocks.
+static uint32_t
+random_channel(const uint32_t* palette){
+  if(rand() % 2){
+    return palette[rand() % 3];
+  }
+  uint32_t c = 0;
+  ncchannel_set_rgb8(&c, rand() % 256, rand() % 256, rand() % 256);
+  return c;
+}
+
+// fill 'blocks' with 'pixels' channels apiece
+static void
+random_blocks(std::vector<uint32_t>& blocks, unsigned pixels, unsigned count){
+  blocks.resize(pixels * count);
+  for(unsigned i = 0 ; i < count ; ++i){
+    uint32_t palette[3];
+    for(auto& p : palette){
+      p = 0;
+      ncchannel_set_rgb8(&p, rand() % 256, rand() % 256, rand() % 256);
+    }
+    for(unsigned p = 0 ; p < pixels ; ++p){
+      blocks[i * pixels + p] = random_channel(palette);
+    }
+  }
+}
+
+// two planes of the same geometry must hold the same cells and cursor
+static void
+check_same_cells(ncplane* n1, ncplane* n2){
+  int y1, x1, y2, x2;
+  ncplane_cursor_yx(n1, &y1, &x1);
+  ncplane_cursor_yx(n2, &y2, &x2);
+  CHECK(y1 == y2);
+  CHECK(x1 == x2);
+  for(int y = 0 ; y < ncplane_dim_y(n1) ; ++y){
+    for(int x = 0 ; x < ncplane_dim_x(n1) ; ++x){
+      uint16_t style1, style2;
+      uint64_t chan1, chan2;
+      char* egc1 = ncplane_at_yx(n1, y, x, &style1, &chan1);
+      char* egc2 = ncplane_at_yx(n2, y, x, &style2, &chan2);
+      REQUIRE(nullptr != egc1);
+      REQUIRE(nullptr != egc2);
+      CHECK(0 == strcmp(egc1, egc2));
+      CHECK(style1 == style2);
+      CHECK(chan1 == chan2);
+      free(egc1);
+      free(egc2);
+    }
+  }
+}
+
+typedef void (*quadbatch)(const uint32_t (*)[4], unsigned, uint8_t*, uint32_t*, uint32_t*, unsigned);
+typedef void (*sexbatch)(const uint32_t (*)[6], unsigned, uint8_t*, uint32_t*, uint32_t*, unsigned);
+
+// the batch solvers must agree exactly with the scalar solvers
+static void
+check_quadrant_batch(quadbatch solve, unsigned nointerpolate){
+  const unsigned count = 4099; // not a multiple of the lane count
+  std::vector<uint32_t> blocks;
+  random_blocks(blocks, 4, count);
+  std::vector<uint8_t> solved(count);
+  std::vector<uint32_t> fores(count), backs(count);
+  auto qblocks = reinterpret_cast<const uint32_t (*)[4]>(blocks.data());
+  solve(qblocks, count, solved.data(), fores.data(), backs.data(), nointerpolate);
+  for(unsigned i = 0 ; i < count ; ++i){
+    uint32_t fore, back;
+    const char* egc = quadrant_solver(qblocks[i][0], qblocks[i][1], qblocks[i][2],
+                                      qblocks[i][3], &fore, &back, nointerpolate);
+    CHECK(0 == strcmp(egc, quadrant_solved_egc(solved[i])));
+    CHECK(fore == fores[i]);
+    CHECK(back == backs[i]);
+  }
+}
+
+static void
+check_sex_batch(sexbatch solve, unsigned nointerpolate){
+  const unsigned count = 4099;
+  std::vector<uint32_t> blocks;
+  random_blocks(blocks, 6, count);
+  std::vector<uint8_t> solved(count);
+  std::vector<uint32_t> l0s(count), l1s(count);
+  auto sblocks = reinterpret_cast<const uint32_t (*)[6]>(blocks.data());
+  solve(sblocks, count, solved.data(), l0s.data(), l1s.data(), nointerpolate);
+  for(unsigned i = 0 ; i < count ; ++i){
+    uint32_t l0 = 0, l1 = 0;
+    CHECK(solved[i] == sex_solver(sblocks[i], &l0, &l1, nointerpolate));
+    CHECK(l0 == l0s[i]);
+    CHECK(l1 == l1s[i]);
+  }
+}
+
+TEST_CASE("BlitSolvers") {
+  srand(0);
+
+  // the fixed-point division must be exact over its whole documented domain
+  // (x < 2^13), which covers everything we lerp, as must the rounded-up form
+  // used by the batch solvers
+  SUBCASE("Reciprocals") {
+    for(unsigned n = 1 ; n <= 8 ; ++n){
+      for(unsigned x = 0 ; x + n - 1 < 1u << 13u ; ++x){
+        REQUIRE(x / n == blit_div(x, n));
+#ifdef __GNUC__
+        REQUIRE((x + n - 1) / n == BLITVEC_DIVUP(x, n));
+#endif
+      }
+    }
+  }
+
+  SUBCASE("QuadrantBatch") {
+    check_quadrant_batch(quadrant_solve_batch, 0);
+    check_quadrant_batch(quadrant_solve_batch, 1);
+  }
+
+  SUBCASE("SextantBatch") {
+    check_sex_batch(sex_solve_batch, 0);
+    check_sex_batch(sex_solve_batch, 1);
+  }
+
+#ifdef BLIT_LANES
+  // check each vector implementation, not just the one we dispatch to
+  SUBCASE("QuadrantLanes") {
+    check_quadrant_batch(quadrant_solve_vec, 0);
+    check_quadrant_batch(quadrant_solve_vec, 1);
+#ifdef BLIT_AVX2
+    if(blit_avx2_p()){
+      check_quadrant_batch(quadrant_solve_avx2, 0);
+      check_quadrant_batch(quadrant_solve_avx2, 1);
+    }
+#endif
+  }
+
+  SUBCASE("SextantLanes") {
+    check_sex_batch(sex_solve_vec, 0);
+    check_sex_batch(sex_solve_vec, 1);
+#ifdef BLIT_AVX2
+    if(blit_avx2_p()){
+      check_sex_batch(sex_solve_avx2, 0);
+      check_sex_batch(sex_solve_avx2, 1);
+    }
+#endif
+  }
+#endif
+}
 
 TEST_CASE("Blit") {
   auto nc_ = testing_notcurses();
@@ -278,5 +426,210 @@ TEST_CASE("Blit") {
     }
   }
 
+  // every braille dot pattern must come out as the corresponding codepoint
+  SUBCASE("BrailleGlyphs") {
+    if(notcurses_canbraille(nc_)){
+      // one cell per pattern; bits follow the braille dot numbering
+      const int dots[8][2] = { // y, x of each bit
+        { 0, 0 }, { 1, 0 }, { 2, 0 }, { 0, 1 }, { 1, 1 }, { 2, 1 }, { 3, 0 }, { 3, 1 },
+      };
+      std::vector<uint32_t> data(4 * 512);
+      for(int mask = 0 ; mask < 256 ; ++mask){
+        for(int bit = 0 ; bit < 8 ; ++bit){
+          data[dots[bit][0] * 512 + mask * 2 + dots[bit][1]] =
+            (mask & (1 << bit)) ? htole(0xffffffffu) : 0;
+        }
+      }
+      auto ncv = ncvisual_from_rgba(data.data(), 4, 512 * 4, 512);
+      REQUIRE(nullptr != ncv);
+      struct ncplane_options nopts = {
+        .y = 0, .x = 0, .rows = 1, .cols = 256,
+        .userptr = nullptr, .name = nullptr, .resizecb = nullptr,
+        .flags = 0, .margin_b = 0, .margin_r = 0,
+      };
+      auto n = ncplane_create(n_, &nopts);
+      REQUIRE(nullptr != n);
+      struct ncvisual_options vopts = {
+        .n = n,
+        .scaling = NCSCALE_NONE,
+        .y = 0, .x = 0,
+        .begy = 0, .begx = 0,
+        .leny = 0, .lenx = 0,
+        .blitter = NCBLIT_BRAILLE,
+        .flags = NCVISUAL_OPTION_NODEGRADE,
+        .transcolor = 0,
+      };
+      CHECK(n == ncvisual_render(nc_, ncv, &vopts));
+      for(int mask = 1 ; mask < 256 ; ++mask){
+        const unsigned char expected[] = {
+          0xe2, (unsigned char)(0xa0 + mask / 64), (unsigned char)(0x80 + mask % 64), 0
+        };
+        char* egc = ncplane_at_yx(n, 0, mask, nullptr, nullptr);
+        REQUIRE(nullptr != egc);
+        CHECK(0 == strcmp(egc, reinterpret_cast<const char*>(expected)));
+        free(egc);
+      }
+      CHECK(0 == ncplane_destroy(n));
+      ncvisual_destroy(ncv);
+    }
+  }
+
+  // a threaded blit must produce exactly what a serial one does
+  SUBCASE("ThreadedBands") {
+    const int pixy = 333, pixx = 211;
+    std::vector<uint32_t> data(pixy * pixx);
+    srand(0);
+    for(auto& px : data){
+      px = htole(((uint32_t)(rand() % 4 ? 0xff : 0) << 24u) | (rand() & 0xffffffu));
+    }
+    auto ncv = ncvisual_from_rgba(data.data(), pixy, pixx * 4, pixx);
+    REQUIRE(nullptr != ncv);
+    const ncblitter_e blitters[] = {
+      NCBLIT_1x1, NCBLIT_2x1, NCBLIT_2x2, NCBLIT_3x2, NCBLIT_BRAILLE,
+    };
+    struct ncplane_options nopts = {
+      .y = 0, .x = 0, .rows = 200, .cols = 120,
+      .userptr = nullptr, .name = nullptr, .resizecb = nullptr,
+      .flags = 0, .margin_b = 0, .margin_r = 0,
+    };
+    for(auto blitter : blitters){
+      auto serial = ncplane_create(n_, &nopts);
+      REQUIRE(nullptr != serial);
+      auto threaded = ncplane_create(n_, &nopts);
+      REQUIRE(nullptr != threaded);
+      struct ncvisual_options vopts = {
+        .n = serial,
+        .scaling = NCSCALE_NONE,
+        .y = 3, .x = 1,
+        .begy = 5, .begx = 2,
+        .leny = 0, .lenx = 0,
+        .blitter = blitter,
+        .flags = NCVISUAL_OPTION_BLEND,
+        .transcolor = 0,
+      };
+      CHECK(serial == ncvisual_render(nc_, ncv, &vopts));
+      vopts.n = threaded;
+      vopts.flags |= NCVISUAL_OPTION_THREADED;
+      CHECK(threaded == ncvisual_render(nc_, ncv, &vopts));
+      int sy, sx, ty, tx;
+      ncplane_cursor_yx(serial, &sy, &sx);
+      ncplane_cursor_yx(threaded, &ty, &tx);
+      CHECK(sy == ty);
+      CHECK(sx == tx);
+      for(int y = 0 ; y < nopts.rows ; ++y){
+        for(int x = 0 ; x < nopts.cols ; ++x){
+          uint16_t sstyle, tstyle;
+          uint64_t schan, tchan;
+          char* segc = ncplane_at_yx(serial, y, x, &sstyle, &schan);
+          char* tegc = ncplane_at_yx(threaded, y, x, &tstyle, &tchan);
+          REQUIRE(nullptr != segc);
+          REQUIRE(nullptr != tegc);
+          CHECK(0 == strcmp(segc, tegc));
+          CHECK(sstyle == tstyle);
+          CHECK(schan == tchan);
+          free(segc);
+          free(tegc);
+        }
+      }
+      CHECK(0 == ncplane_destroy(serial));
+      CHECK(0 == ncplane_destroy(threaded));
+    }
+    ncvisual_destroy(ncv);
+  }
+
+  // cached blits must match uncached ones, including the EGCs left behind in
+  // transparent cells, and must be invalidated by changes to the visual
+  SUBCASE("CachedBlits") {
+    const int pixy = 97, pixx = 83;
+    std::vector<uint32_t> data(pixy * pixx);
+    srand(0);
+    for(auto& px : data){
+      px = htole(((uint32_t)(rand() % 4 ? 0xff : 0) << 24u) | (rand() & 0xffffffu));
+    }
+    auto ncv = ncvisual_from_rgba(data.data(), pixy, pixx * 4, pixx);
+    REQUIRE(nullptr != ncv);
+    const ncblitter_e blitters[] = {
+      NCBLIT_1x1, NCBLIT_2x1, NCBLIT_2x2, NCBLIT_3x2, NCBLIT_4x1, NCBLIT_BRAILLE,
+    };
+    struct ncplane_options nopts = {
+      .y = 0, .x = 0, .rows = 60, .cols = 70,
+      .userptr = nullptr, .name = nullptr, .resizecb = nullptr,
+      .flags = 0, .margin_b = 0, .margin_r = 0,
+    };
+    auto newplane = [&](){
+      auto n = ncplane_create(n_, &nopts);
+      REQUIRE(nullptr != n);
+      for(int y = 0 ; y < nopts.rows ; ++y){
+        for(int x = 0 ; x < nopts.cols ; ++x){
+          CHECK(0 < ncplane_putegc_yx(n, y, x, y % 2 ? "x" : "\u00e9", nullptr));
+        }
+      }
+      return n;
+    };
+    // blitters might degrade to one another, so all we can say of the first
+    // cached render of each is that it was counted. the second must hit.
+    ncstats stats;
+    for(auto blitter : blitters){
+      auto uncached = newplane();
+      struct ncvisual_options vopts = {
+        .n = uncached,
+        .scaling = NCSCALE_NONE,
+        .y = 2, .x = 3,
+        .begy = 0, .begx = 0,
+        .leny = 0, .lenx = 0,
+        .blitter = blitter,
+        .flags = NCVISUAL_OPTION_BLEND,
+        .transcolor = 0,
+      };
+      CHECK(uncached == ncvisual_render(nc_, ncv, &vopts));
+      vopts.flags |= NCVISUAL_OPTION_CACHED;
+      for(int i = 0 ; i < 2 ; ++i){
+        notcurses_stats(nc_, &stats);
+        const auto hits = stats.blitcache_hits;
+        const auto misses = stats.blitcache_misses;
+        auto cached = newplane();
+        vopts.n = cached;
+        CHECK(cached == ncvisual_render(nc_, ncv, &vopts));
+        check_same_cells(uncached, cached);
+        CHECK(0 == ncplane_destroy(cached));
+        notcurses_stats(nc_, &stats);
+        CHECK(hits + misses + 1 == stats.blitcache_hits + stats.blitcache_misses);
+        if(i){
+          CHECK(hits + 1 == stats.blitcache_hits);
+        }
+      }
+      CHECK(0 == ncplane_destroy(uncached));
+    }
+    // modify the visual; the next cached render must reflect the change
+    auto uncached = newplane();
+    auto cached = newplane();
+    struct ncvisual_options vopts = {
+      .n = cached,
+      .scaling = NCSCALE_NONE,
+      .y = 0, .x = 0,
+      .begy = 0, .begx = 0,
+      .leny = 0, .lenx = 0,
+      .blitter = NCBLIT_2x2,
+      .flags = NCVISUAL_OPTION_CACHED,
+      .transcolor = 0,
+    };
+    CHECK(cached == ncvisual_render(nc_, ncv, &vopts));
+    CHECK(0 == ncvisual_set_yx(ncv, 10, 10, htole(0xff00ff00)));
+    notcurses_stats(nc_, &stats);
+    const auto hits = stats.blitcache_hits;
+    const auto misses = stats.blitcache_misses;
+    CHECK(cached == ncvisual_render(nc_, ncv, &vopts));
+    vopts.n = uncached;
+    vopts.flags = 0;
+    CHECK(uncached == ncvisual_render(nc_, ncv, &vopts));
+    check_same_cells(uncached, cached);
+    notcurses_stats(nc_, &stats);
+    CHECK(hits == stats.blitcache_hits);
+    CHECK(misses + 1 == stats.blitcache_misses);
+    CHECK(0 == ncplane_destroy(cached));
+    CHECK(0 == ncplane_destroy(uncached));
+    ncvisual_destroy(ncv);
+  }
+
   CHECK(!notcurses_stop(nc_));
 }
@@ -77,6 +77,38 @@ TEST_CASE("Cell") {
 #endif
   }
 
+  // widths from the property table ought match wcwidth() (twice, so that the
+  // second pass hits populated pages)
+  SUBCASE("WidthTable") {
+    const std::pair<wchar_t, wchar_t> ranges[] = {
+      { 0x20, 0x7f },       // ASCII
+      { 0xa0, 0x800 },      // Latin, Greek, Cyrillic, combining marks
+      { 0x3000, 0x3100 },   // CJK punctuation, Hiragana, Katakana
+      { 0x4e00, 0x5000 },   // CJK ideographs
+      { 0xac00, 0xad00 },   // Hangul syllables
+      { 0x1f300, 0x1f700 }, // emoji
+    };
+    for(int pass = 0 ; pass < 2 ; ++pass){
+      for(const auto& r : ranges){
+        for(wchar_t w = r.first ; w < r.second ; ++w){
+          if(wcwidth(w) < 0 || iswspace(w)){
+            continue;
+          }
+          char mb[MB_LEN_MAX + 1];
+          mbstate_t ps{};
+          size_t s = wcrtomb(mb, w, &ps);
+          if(s == (size_t)-1){
+            continue;
+          }
+          mb[s] = '\0';
+          CHECK(wcwidth(w) == ncstrwidth(mb));
+        }
+      }
+    }
+    CHECK(1 == ncstrwidth("é"));       // combining acute accent
+    CHECK(2 == ncstrwidth("ab́́"));
+  }
+
   SUBCASE("SetItalic") {
     nccell c = CELL_TRIVIAL_INITIALIZER;
     int dimy, dimx;
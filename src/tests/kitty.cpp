@@ -0,0 +1,441 @@
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <zlib.h>
+#include <dirent.h>
+#include "main.h"
+#include "lib/kittyz.h"
+#include "lib/visual-details.h"
+
+// names in |dir| starting with |prefix|
+static auto
+dir_entries(const char* dir, const std::string& prefix) -> std::vector<std::string> {
+  std::vector<std::string> ret;
+  DIR* d = opendir(dir);
+  if(d){
+    struct dirent* de;
+    while( (de = readdir(d)) ){
+      if(strncmp(de->d_name, prefix.c_str(), prefix.size()) == 0){
+        ret.emplace_back(de->d_name);
+      }
+    }
+    closedir(d);
+  }
+  return ret;
+}
+
+// the control data uploading kitty image |imgid|, and that placing it as |id|
+static auto
+kitty_upload(uint32_t imgid) -> std::string {
+  return ",i=" + std::to_string(imgid) + ",p=1,a=t,";
+}
+
+static auto
+kitty_place(uint32_t imgid, uint32_t id) -> std::string {
+  return "a=p,i=" + std::to_string(imgid) + ",p=" + std::to_string(id) + ",";
+}
+
+// occurrences of |needle| in |haystack|
+static auto
+count_of(const std::string& haystack, const std::string& needle) -> size_t {
+  size_t ret = 0;
+  for(auto pos = haystack.find(needle) ; pos != std::string::npos ;
+      pos = haystack.find(needle, pos + needle.size())){
+    ++ret;
+  }
+  return ret;
+}
+
+// render the pile of |n|, returning the output
+static auto
+render_output(ncplane* n) -> std::string {
+  char* out = nullptr;
+  size_t outlen = 0;
+  if(ncpile_render_to_buffer(n, &out, &outlen) || out == nullptr){
+    return "";
+  }
+  std::string ret(out, outlen);
+  free(out);
+  return ret;
+}
+
+// a 1x1 plane over the standard plane at |y|/|x|, wiping any sprixel cell
+// beneath it
+static auto
+blocker_plane(notcurses* nc, int y, int x) -> ncplane* {
+  struct ncplane_options nopts{};
+  nopts.y = y;
+  nopts.x = x;
+  nopts.rows = 1;
+  nopts.cols = 1;
+  auto n = ncplane_create(notcurses_stdplane(nc), &nopts);
+  if(n && ncplane_putchar(n, 'x') != 1){
+    ncplane_destroy(n);
+    n = nullptr;
+  }
+  return n;
+}
+
+// an opaque visual of |rows|x|cols| cells' worth of noise, so that no two
+// are alike (and none hit the image cache)
+static auto
+noise_visual(const notcurses* nc, int rows, int cols) -> ncvisual* {
+  const int dimy = nc->tcache.cellpixy * rows;
+  const int dimx = nc->tcache.cellpixx * cols;
+  std::vector<uint32_t> rgba(dimy * dimx);
+  for(auto& px : rgba){
+    px = htole(0xff000000u | (rand() & 0xffffffu));
+  }
+  return ncvisual_from_rgba(rgba.data(), dimy, dimx * 4, dimx);
+}
+
+TEST_CASE("KittyMediumReplies") {
+  // only an OK for one of the medium probes selects that medium
+  CHECK(KITTY_MEDIUM_FILE == kitty_medium_reply(KITTY_MEDIUM_DIRECT, "i=3;OK"));
+  CHECK(KITTY_MEDIUM_SHM == kitty_medium_reply(KITTY_MEDIUM_DIRECT, "i=4;OK"));
+  CHECK(KITTY_MEDIUM_DIRECT == kitty_medium_reply(KITTY_MEDIUM_DIRECT, "i=1;OK"));
+  CHECK(KITTY_MEDIUM_DIRECT == kitty_medium_reply(KITTY_MEDIUM_DIRECT, "i=5;OK"));
+  CHECK(KITTY_MEDIUM_DIRECT == kitty_medium_reply(KITTY_MEDIUM_DIRECT, "i=4;EBADF:bad file"));
+  CHECK(KITTY_MEDIUM_DIRECT == kitty_medium_reply(KITTY_MEDIUM_DIRECT, "i=3;OKAY"));
+  CHECK(KITTY_MEDIUM_DIRECT == kitty_medium_reply(KITTY_MEDIUM_DIRECT, "i=4"));
+  CHECK(KITTY_MEDIUM_DIRECT == kitty_medium_reply(KITTY_MEDIUM_DIRECT, "OK"));
+  CHECK(KITTY_MEDIUM_DIRECT == kitty_medium_reply(KITTY_MEDIUM_DIRECT, "i=x;OK"));
+  // whatever order the replies arrive in, the best medium wins
+  CHECK(KITTY_MEDIUM_SHM == kitty_medium_reply(KITTY_MEDIUM_SHM, "i=3;OK"));
+  CHECK(KITTY_MEDIUM_SHM == kitty_medium_reply(KITTY_MEDIUM_FILE, "i=4;OK"));
+  CHECK(KITTY_MEDIUM_FILE == kitty_medium_reply(KITTY_MEDIUM_FILE, "i=4;ENOENT"));
+}
+
+// whatever the level and number of pieces, a deflate must inflate back to
+// its input (uncompress() verifies the combined adler32 as well)
+TEST_CASE("KittyDeflate") {
+  srand(0);
+  // runs interspersed with noise, long enough that later pieces are primed
+  // with a full dictionary
+  std::vector<unsigned char> src(300000);
+  for(size_t i = 0 ; i < src.size() ; ++i){
+    src[i] = (i / 4096) % 3 ? rand() : (i / 7) & 0xff;
+  }
+  for(size_t len : { (size_t)1, (size_t)100, (size_t)40000, src.size() }){
+    for(int pieces = 1 ; pieces <= 8 ; ++pieces){
+      for(int level = 0 ; level <= 9 ; ++level){
+        size_t zlen = 0;
+        uint64_t cpuns = 0;
+        auto z = kitty_deflate_pieces(src.data(), len, level, pieces, &zlen, &cpuns);
+        REQUIRE(nullptr != z);
+        std::vector<unsigned char> out(len);
+        uLongf outlen = len;
+        CHECK(Z_OK == uncompress(out.data(), &outlen, z, zlen));
+        CHECK(len == outlen);
+        CHECK(0 == memcmp(out.data(), src.data(), len));
+        free(z);
+      }
+    }
+  }
+}
+
+TEST_CASE("Kitty") {
+  auto nc_ = testing_notcurses();
+  REQUIRE(nullptr != nc_);
+  // uploads only go through a medium from KITTY_ANIMATION on
+  if(notcurses_check_pixel_support(nc_) < NCPIXEL_KITTY_ANIMATED){
+    CHECK(0 == notcurses_stop(nc_));
+    return;
+  }
+  srand(0);
+  struct ncvisual_options vopts{};
+  vopts.blitter = NCBLIT_PIXEL;
+  vopts.flags = NCVISUAL_OPTION_NODEGRADE;
+  const char* envtmp = getenv("TMPDIR");
+  const std::string oldtmp = envtmp ? envtmp : "";
+  char tmpl[] = "/tmp/notcurses-kitty-XXXXXX";
+  const char* tmpdir = mkdtemp(tmpl);
+  REQUIRE(nullptr != tmpdir);
+  const std::string prefix = "tty-graphics-protocol-" + std::to_string(getpid()) + "-";
+
+  // temporary files are created under $TMPDIR, and unlinked once a sprixel
+  // destroyed before it was ever drawn is freed
+  SUBCASE("KittyTempfile") {
+    CHECK(0 == setenv("TMPDIR", (std::string(tmpdir) + "//").c_str(), 1));
+    nc_->tcache.kittymedium = KITTY_MEDIUM_FILE;
+    auto ncv = noise_visual(nc_, 4, 4);
+    REQUIRE(nullptr != ncv);
+    auto n = ncvisual_render(nc_, ncv, &vopts);
+    REQUIRE(nullptr != n);
+    CHECK(1 == dir_entries(tmpdir, prefix).size());
+    CHECK(0 == ncplane_destroy(n));
+    CHECK(0 == notcurses_render(nc_));
+    CHECK(0 == dir_entries(tmpdir, prefix).size());
+    ncvisual_destroy(ncv);
+  }
+
+#ifdef __linux__
+  // likewise shared memory objects (visible under /dev/shm)
+  SUBCASE("KittyShm") {
+    nc_->tcache.kittymedium = KITTY_MEDIUM_SHM;
+    const auto before = dir_entries("/dev/shm", prefix).size();
+    auto ncv = noise_visual(nc_, 4, 4);
+    REQUIRE(nullptr != ncv);
+    auto n = ncvisual_render(nc_, ncv, &vopts);
+    REQUIRE(nullptr != n);
+    CHECK(before + 1 == dir_entries("/dev/shm", prefix).size());
+    CHECK(0 == ncplane_destroy(n));
+    CHECK(0 == notcurses_render(nc_));
+    CHECK(before == dir_entries("/dev/shm", prefix).size());
+    ncvisual_destroy(ncv);
+  }
+#endif
+
+  // a medium which can't be created (here, an absent directory, or a name
+  // too long to tag) falls back to the tty, leaving nothing behind
+  SUBCASE("KittyMediumFallback") {
+    nc_->tcache.kittymedium = KITTY_MEDIUM_FILE;
+    const std::string dirs[] = {
+      std::string(tmpdir) + "/absent",
+      std::string(tmpdir) + "/" + std::string(KITTY_MEDIUM_TAGLEN, 'x'),
+    };
+    for(const auto& dir : dirs){
+      CHECK(0 == setenv("TMPDIR", dir.c_str(), 1));
+      auto ncv = noise_visual(nc_, 4, 4);
+      REQUIRE(nullptr != ncv);
+      auto n = ncvisual_render(nc_, ncv, &vopts);
+      REQUIRE(nullptr != n);
+      CHECK(2 == dir_entries(tmpdir, "").size()); // "." and ".."
+      char* out = nullptr;
+      size_t outlen = 0;
+      CHECK(0 == ncpile_render_to_buffer(n, &out, &outlen));
+      REQUIRE(nullptr != out);
+      const std::string output(out, outlen);
+      free(out);
+      CHECK(std::string::npos != output.find("a=t,"));
+      CHECK(std::string::npos == output.find(",t=t,"));
+      CHECK(0 == ncplane_destroy(n));
+      ncvisual_destroy(ncv);
+    }
+  }
+
+  // a sprixel wiping a cell of an image it shares must upload a copy of its
+  // own under a fresh id, even if it uploaded the shared image itself, which
+  // is left alone (and still hit by later blits)
+  SUBCASE("KittyDetachUploader") {
+    auto ncv = noise_visual(nc_, 4, 4);
+    REQUIRE(nullptr != ncv);
+    auto n1 = ncvisual_render(nc_, ncv, &vopts);
+    REQUIRE(nullptr != n1);
+    auto vopts2 = vopts;
+    vopts2.y = 5;
+    auto n2 = ncvisual_render(nc_, ncv, &vopts2);
+    REQUIRE(nullptr != n2);
+    const uint32_t shared = n1->sprite->imgid;
+    CHECK(n1->sprite->id == shared);
+    CHECK(shared == n2->sprite->imgid);
+    CHECK(0 == notcurses_render(nc_));
+    auto blocker = blocker_plane(nc_, 1, 1);
+    REQUIRE(nullptr != blocker);
+    const auto output = render_output(blocker);
+    const uint32_t copy = n1->sprite->imgid;
+    CHECK(shared != copy);
+    CHECK(n1->sprite->id != copy);
+    CHECK(shared == n2->sprite->imgid);
+    CHECK(std::string::npos == output.find(kitty_upload(shared)));
+    CHECK(std::string::npos != output.find(kitty_upload(copy)));
+    CHECK(std::string::npos != output.find("a=d,d=i,i=" + std::to_string(shared) +
+                                           ",p=" + std::to_string(n1->sprite->id)));
+    auto vopts3 = vopts;
+    vopts3.y = 10;
+    auto n3 = ncvisual_render(nc_, ncv, &vopts3);
+    REQUIRE(nullptr != n3);
+    CHECK(shared == n3->sprite->imgid);
+    CHECK(0 == ncplane_destroy(n3));
+    CHECK(0 == ncplane_destroy(blocker));
+    CHECK(0 == ncplane_destroy(n2));
+    CHECK(0 == ncplane_destroy(n1));
+    CHECK(0 == notcurses_render(nc_));
+    ncvisual_destroy(ncv);
+  }
+
+  // identical pixels are uploaded once, and placed by each sprixel under its
+  // own placement id. the image outlives its uploader so long as any sprixel
+  // (including one recycled on the same plane) holds it, and is dropped from
+  // the cache with its last reference.
+  SUBCASE("KittyImageCache") {
+    auto ncv = noise_visual(nc_, 4, 4);
+    REQUIRE(nullptr != ncv);
+    auto n1 = ncvisual_render(nc_, ncv, &vopts);
+    REQUIRE(nullptr != n1);
+    auto vopts2 = vopts;
+    vopts2.y = 5;
+    auto n2 = ncvisual_render(nc_, ncv, &vopts2);
+    REQUIRE(nullptr != n2);
+    const uint32_t shared = n1->sprite->id;
+    CHECK(shared == n1->sprite->imgid);
+    CHECK(shared == n2->sprite->imgid);
+    CHECK(shared != n2->sprite->id);
+    auto output = render_output(n1);
+    CHECK(1 == count_of(output, kitty_upload(shared)));
+    CHECK(1 == count_of(output, kitty_place(shared, n1->sprite->id)));
+    CHECK(1 == count_of(output, kitty_place(shared, n2->sprite->id)));
+    // the uploader goes away, but n2 still holds the image
+    CHECK(0 == ncplane_destroy(n1));
+    CHECK(0 == notcurses_render(nc_));
+    auto vopts3 = vopts;
+    vopts3.y = 10;
+    auto n3 = ncvisual_render(nc_, ncv, &vopts3);
+    REQUIRE(nullptr != n3);
+    CHECK(shared == n3->sprite->imgid);
+    output = render_output(n3);
+    CHECK(std::string::npos == output.find("a=t,"));
+    CHECK(1 == count_of(output, kitty_place(shared, n3->sprite->id)));
+    // reblitting onto n2 recycles its sprixel, which inherits its reference
+    vopts2.n = n2;
+    vopts2.y = 0;
+    const uint32_t oldid = n2->sprite->id;
+    REQUIRE(n2 == ncvisual_render(nc_, ncv, &vopts2));
+    CHECK(oldid != n2->sprite->id);
+    CHECK(shared == n2->sprite->imgid);
+    CHECK(0 == ncplane_destroy(n3));
+    CHECK(0 == notcurses_render(nc_));
+    output = render_output(n2);
+    CHECK(std::string::npos == output.find("a=t,"));
+    // copy-on-write: n2 wipes a cell of the image, and uploads its own copy,
+    // leaving the shared image (still held by n4) as it was
+    auto n4 = ncvisual_render(nc_, ncv, &vopts3);
+    REQUIRE(nullptr != n4);
+    CHECK(shared == n4->sprite->imgid);
+    CHECK(0 == notcurses_render(nc_));
+    auto blocker = blocker_plane(nc_, 6, 2);
+    REQUIRE(nullptr != blocker);
+    output = render_output(blocker);
+    const uint32_t copy = n2->sprite->imgid;
+    CHECK(shared != copy);
+    CHECK(shared == n4->sprite->imgid);
+    CHECK(std::string::npos == output.find(kitty_upload(shared)));
+    CHECK(1 == count_of(output, kitty_upload(copy)));
+    // n4 is now the image's only holder, but didn't upload it, and so lacks
+    // the auxiliary vectors of its cells; it too uploads a copy
+    CHECK(0 == ncplane_destroy(n2));
+    CHECK(0 == ncplane_move_yx(blocker, 11, 2));
+    output = render_output(blocker);
+    CHECK(shared != n4->sprite->imgid);
+    CHECK(1 == count_of(output, kitty_upload(n4->sprite->imgid)));
+    // with its last reference gone, the image leaves the cache
+    CHECK(0 == ncplane_destroy(n4));
+    CHECK(0 == notcurses_render(nc_));
+    auto n5 = ncvisual_render(nc_, ncv, &vopts);
+    REQUIRE(nullptr != n5);
+    CHECK(n5->sprite->id == n5->sprite->imgid);
+    output = render_output(n5);
+    CHECK(1 == count_of(output, kitty_upload(n5->sprite->id)));
+    // the uploader, holding the image alone, takes it back to wipe a cell,
+    // without uploading anything
+    CHECK(0 == ncplane_move_yx(blocker, 1, 2));
+    output = render_output(blocker);
+    CHECK(n5->sprite->id == n5->sprite->imgid);
+    CHECK(std::string::npos == output.find("a=t,"));
+    CHECK(0 == ncplane_destroy(n5));
+    CHECK(0 == ncplane_destroy(blocker));
+    CHECK(0 == notcurses_render(nc_));
+    ncvisual_destroy(ncv);
+  }
+
+  // reblitting onto a plane whose image nobody else holds edits the image in
+  // place, sending only the rectangles of cells which changed
+  SUBCASE("KittyDelta") {
+    const int cpy = nc_->tcache.cellpixy;
+    const int cpx = nc_->tcache.cellpixx;
+    const int dimy = cpy * 8;
+    const int dimx = cpx * 8;
+    std::vector<uint32_t> rgba(dimy * dimx);
+    for(auto& px : rgba){
+      px = htole(0xff000000u | (rand() & 0xffffffu));
+    }
+    // replace the pixels of cells |y|/|x| through |ylen|x|xlen| with noise
+    auto scribble = [&](int y, int x, int ylen, int xlen){
+      for(int py = y * cpy ; py < (y + ylen) * cpy ; ++py){
+        for(int px = x * cpx ; px < (x + xlen) * cpx ; ++px){
+          rgba[py * dimx + px] = htole(0xff000000u | (rand() & 0xffffffu));
+        }
+      }
+    };
+    const auto glyph = [](const ncplane* n){
+      return std::string(n->sprite->glyph.buf, n->sprite->glyph.used);
+    };
+    auto ncv = ncvisual_from_rgba(rgba.data(), dimy, dimx * 4, dimx);
+    REQUIRE(nullptr != ncv);
+    auto n = ncvisual_render(nc_, ncv, &vopts);
+    REQUIRE(nullptr != n);
+    ncvisual_destroy(ncv);
+    const uint32_t imgid = n->sprite->imgid;
+    CHECK(n->sprite->id == imgid);
+    CHECK(0 == notcurses_render(nc_));
+    auto vopts2 = vopts;
+    vopts2.n = n;
+    // an unchanged reblit sends nothing
+    const auto original = rgba;
+    ncv = ncvisual_from_rgba(rgba.data(), dimy, dimx * 4, dimx);
+    REQUIRE(nullptr != ncv);
+    REQUIRE(n == ncvisual_render(nc_, ncv, &vopts2));
+    ncvisual_destroy(ncv);
+    CHECK(n->sprite->id != imgid);
+    CHECK(imgid == n->sprite->imgid);
+    CHECK(0 == n->sprite->glyph.used);
+    CHECK(0 == notcurses_render(nc_));
+    // a column of two cells, and a row of two cells, are sent as two rects
+    scribble(1, 2, 2, 1);
+    scribble(5, 5, 1, 2);
+    ncv = ncvisual_from_rgba(rgba.data(), dimy, dimx * 4, dimx);
+    REQUIRE(nullptr != ncv);
+    REQUIRE(n == ncvisual_render(nc_, ncv, &vopts2));
+    ncvisual_destroy(ncv);
+    CHECK(imgid == n->sprite->imgid);
+    const auto g = glyph(n);
+    CHECK(std::string::npos == g.find("a=t,"));
+    CHECK(2 == count_of(g, "a=f,r=1,"));
+    const auto rect = [&](int y, int x, int ylen, int xlen){
+      return "a=f,r=1,x=" + std::to_string(x * cpx) + ",y=" + std::to_string(y * cpy) +
+             ",s=" + std::to_string(xlen * cpx) + ",v=" + std::to_string(ylen * cpy) +
+             ",i=" + std::to_string(imgid) + ",X=1,";
+    };
+    CHECK(1 == count_of(g, rect(1, 2, 2, 1)));
+    CHECK(1 == count_of(g, rect(5, 5, 1, 2)));
+    CHECK(0 == notcurses_render(nc_));
+    // the updated image no longer matches its original pixels
+    ncv = ncvisual_from_rgba(original.data(), dimy, dimx * 4, dimx);
+    REQUIRE(nullptr != ncv);
+    auto vopts3 = vopts;
+    vopts3.y = 10;
+    auto n2 = ncvisual_render(nc_, ncv, &vopts3);
+    REQUIRE(nullptr != n2);
+    ncvisual_destroy(ncv);
+    CHECK(imgid != n2->sprite->imgid);
+    CHECK(n2->sprite->id == n2->sprite->imgid);
+    CHECK(1 == count_of(render_output(n2), kitty_upload(n2->sprite->imgid)));
+    CHECK(0 == ncplane_destroy(n2));
+    CHECK(0 == notcurses_render(nc_));
+    // changing most of the image uploads it whole
+    scribble(0, 0, 6, 8);
+    ncv = ncvisual_from_rgba(rgba.data(), dimy, dimx * 4, dimx);
+    REQUIRE(nullptr != ncv);
+    REQUIRE(n == ncvisual_render(nc_, ncv, &vopts2));
+    ncvisual_destroy(ncv);
+    CHECK(imgid != n->sprite->imgid);
+    CHECK(n->sprite->id == n->sprite->imgid);
+    const auto output = render_output(n);
+    CHECK(1 == count_of(output, kitty_upload(n->sprite->imgid)));
+    CHECK(std::string::npos == output.find("a=f,r=1,"));
+    CHECK(0 == ncplane_destroy(n));
+    CHECK(0 == notcurses_render(nc_));
+  }
+
+  // drawn mediums belong to the terminal, which would delete them
+  for(const auto& name : dir_entries(tmpdir, prefix)){
+    unlink((std::string(tmpdir) + "/" + name).c_str());
+  }
+  CHECK(0 == rmdir(tmpdir));
+  if(envtmp){
+    setenv("TMPDIR", oldtmp.c_str(), 1);
+  }else{
+    unsetenv("TMPDIR");
+  }
+  CHECK(0 == notcurses_stop(nc_));
+}
@@ -1,4 +1,5 @@
 #include <cstdlib>
+#include <vector>
 #include "main.h"
 
 void BoxPermutationsRounded(struct notcurses* nc, struct ncplane* n, unsigned edges) {
@@ -135,6 +136,51 @@ TEST_CASE("Plane") {
     CHECK(0 == notcurses_render(nc_));
   }
 
+  // Verify we can emit a span of cells, including those read back from a
+  // plane, and that glyphs straddling the span's edges are obliterated
+  SUBCASE("EmitCellSpan") {
+    CHECK(0 < ncplane_putstr_yx(n_, 0, 0, "a漢✔b"));
+    std::vector<nccell> cells(5);
+    for(int x = 0 ; x < 5 ; ++x){
+      CHECK(0 <= ncplane_at_yx_cell(n_, 0, x, &cells[x]));
+    }
+    CHECK(5 == ncplane_putcells_yx(n_, 1, 0, cells.data(), cells.size()));
+    int y, x;
+    ncplane_cursor_yx(n_, &y, &x);
+    CHECK(1 == y);
+    CHECK(5 == x);
+    char* row0 = ncplane_contents(n_, 0, 0, 1, 5);
+    char* row1 = ncplane_contents(n_, 1, 0, 1, 5);
+    REQUIRE(nullptr != row0);
+    REQUIRE(nullptr != row1);
+    CHECK(0 == strcmp(row0, row1));
+    free(row0);
+    free(row1);
+    // a span ending on the left half of the wide glyph
+    CHECK(2 == ncplane_putcells_yx(n_, 1, 0, &cells[3], 2));
+    char* egc = ncplane_at_yx(n_, 1, 2, nullptr, nullptr);
+    REQUIRE(nullptr != egc);
+    CHECK(0 == strcmp(egc, ""));
+    free(egc);
+    // a span starting on the right half of the wide glyph
+    CHECK(5 == ncplane_putcells_yx(n_, 1, 0, cells.data(), cells.size()));
+    CHECK(1 == ncplane_putcells_yx(n_, 1, 2, &cells[4], 1));
+    egc = ncplane_at_yx(n_, 1, 1, nullptr, nullptr);
+    REQUIRE(nullptr != egc);
+    CHECK(0 == strcmp(egc, ""));
+    free(egc);
+    egc = ncplane_at_yx(n_, 1, 2, nullptr, nullptr);
+    REQUIRE(nullptr != egc);
+    CHECK(0 == strcmp(egc, "b"));
+    free(egc);
+    // spans mustn't extend past the end of the row
+    CHECK(0 > ncplane_putcells_yx(n_, 1, ncplane_dim_x(n_) - 2, cells.data(), 3));
+    for(auto& c : cells){
+      nccell_release(n_, &c);
+    }
+    CHECK(0 == notcurses_render(nc_));
+  }
+
   // Verify we can emit a wchar_t, and it advances the cursor
   SUBCASE("EmitWcharT") {
     const wchar_t* w = L"✔";
@@ -164,6 +210,36 @@ TEST_CASE("Plane") {
     CHECK(0 == notcurses_render(nc_));
   }
 
+  // ASCII runs are written directly, but must neither split an EGC begun by
+  // an ASCII character, nor leave behind half of an overwritten wide glyph
+  SUBCASE("EmitAsciiRuns") {
+    CHECK(0 < ncplane_putstr_yx(n_, 0, 0, "ab漢cd"));
+    CHECK(5 == ncplane_putstr_yx(n_, 0, 1, "xyzwe\u0301"));
+    int y, x;
+    ncplane_cursor_yx(n_, &y, &x);
+    CHECK(0 == y);
+    CHECK(6 == x);
+    char* egc = ncplane_at_yx(n_, 0, 5, nullptr, nullptr);
+    REQUIRE(nullptr != egc);
+    CHECK(0 == strcmp(egc, "e\u0301"));
+    free(egc);
+    CHECK(3 == ncplane_putstr_yx(n_, 1, 0, "漢q"));
+    CHECK(1 == ncplane_putstr_yx(n_, 1, 1, "r"));
+    egc = ncplane_at_yx(n_, 1, 0, nullptr, nullptr);
+    REQUIRE(nullptr != egc);
+    CHECK(0 == strcmp(egc, ""));
+    free(egc);
+    egc = ncplane_at_yx(n_, 1, 2, nullptr, nullptr);
+    REQUIRE(nullptr != egc);
+    CHECK(0 == strcmp(egc, "q"));
+    free(egc);
+    char* row = ncplane_contents(n_, 0, 0, 1, 6);
+    REQUIRE(nullptr != row);
+    CHECK(0 == strcmp(row, "axyzwe\u0301"));
+    free(row);
+    CHECK(0 == notcurses_render(nc_));
+  }
+
   // Verify we can emit a wide string, and it advances the cursor
   SUBCASE("EmitWideStr") {
     const wchar_t* ss[] = { L"Σιβυλλα τι θελεις;",
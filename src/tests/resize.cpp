@@ -1,4 +1,6 @@
 #include "main.h"
+#include <string>
+#include <vector>
 
 TEST_CASE("Resize") {
   auto nc_ = testing_notcurses();
@@ -70,6 +72,71 @@ TEST_CASE("Resize") {
     CHECK(0 == ncplane_destroy(testn));
   }
 
+  // resizes retaining the top left corner, with rows wrapped by scrolling,
+  // must retain the same content as a fresh copy would
+  SUBCASE("ResizeInPlace") {
+    struct ncplane_options nopts = {
+      .y = 0,
+      .x = 0,
+      .rows = 10,
+      .cols = 8,
+      .userptr = nullptr, .name = nullptr, .resizecb = nullptr, .flags = 0,
+      .margin_b = 0, .margin_r = 0,
+    };
+    struct ncplane* testn = ncplane_create(n_, &nopts);
+    REQUIRE(nullptr != testn);
+    ncplane_set_scrolling(testn, true);
+    for(char c = 'a' ; c <= 'o' ; ++c){
+      CHECK(0 < ncplane_printf(testn, "%c%c%c%c%c%c%c\n", c, c, c, c, c, c, c));
+    }
+    CHECK(0 != testn->logrow); // rows ought be wrapped
+    // expected contents, with '.' for empty cells
+    std::vector<std::string> model;
+    for(int y = 0 ; y < ncplane_dim_y(testn) ; ++y){
+      std::string row;
+      for(int x = 0 ; x < ncplane_dim_x(testn) ; ++x){
+        char* egc = ncplane_at_yx(testn, y, x, nullptr, nullptr);
+        REQUIRE(nullptr != egc);
+        row += *egc ? *egc : '.';
+        free(egc);
+      }
+      model.push_back(row);
+    }
+    const struct { int keepy, keepleny, keeplenx, ylen, xlen; } steps[] = {
+      { 0, 7, 8, 7, 8, },   // fewer rows, wrapped
+      { 0, 7, 8, 12, 8, },  // more rows
+      { 0, 5, 8, 5, 8, },   // fewer rows
+      { 0, 5, 6, 5, 6, },   // fewer columns
+      { 0, 5, 6, 9, 11, },  // more rows and columns
+      { 2, 4, 5, 9, 7, },   // dropping rows at the top
+    };
+    for(const auto& s : steps){
+      CHECK(0 == ncplane_resize(testn, s.keepy, 0, s.keepleny, s.keeplenx,
+                                -s.keepy, 0, s.ylen, s.xlen));
+      std::vector<std::string> next;
+      for(int y = 0 ; y < s.ylen ; ++y){
+        std::string row(s.xlen, '.');
+        if(y >= s.keepy && y < s.keepy + s.keepleny){
+          row.replace(0, s.keeplenx, model[y], 0, s.keeplenx);
+        }
+        next.push_back(row);
+      }
+      model = next;
+      REQUIRE(s.ylen == ncplane_dim_y(testn));
+      REQUIRE(s.xlen == ncplane_dim_x(testn));
+      for(int y = 0 ; y < s.ylen ; ++y){
+        for(int x = 0 ; x < s.xlen ; ++x){
+          char* egc = ncplane_at_yx(testn, y, x, nullptr, nullptr);
+          REQUIRE(nullptr != egc);
+          CHECK(model[y][x] == (*egc ? *egc : '.'));
+          free(egc);
+        }
+      }
+      CHECK(0 == notcurses_render(nc_));
+    }
+    CHECK(0 == ncplane_destroy(testn));
+  }
+
   CHECK(0 == notcurses_stop(nc_));
 
 }
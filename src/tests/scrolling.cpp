@@ -1,6 +1,8 @@
 #include "main.h"
 #include <array>
 #include <cstdlib>
+#include <string>
+#include <unistd.h>
 
 TEST_CASE("Scrolling") {
   auto nc_ = testing_notcurses();
@@ -309,6 +311,267 @@ TEST_CASE("Scrolling") {
     CHECK(0 == ncplane_destroy(np));
   }
 
+  // scrolling many lines at once must be equivalent to scrolling them one
+  // at a time, including movement of bound planes
+  SUBCASE("ScrollupBulk") {
+    struct ncplane_options nopts = {
+      .y = 1,
+      .x = 1,
+      .rows = 8,
+      .cols = 20,
+      .userptr = nullptr, .name = nullptr, .resizecb = nullptr, .flags = 0,
+      .margin_b = 0, .margin_r = 0,
+    };
+    struct ncplane_options copts = {
+      .y = 5,
+      .x = 2,
+      .rows = 2,
+      .cols = 4,
+      .userptr = nullptr, .name = nullptr, .resizecb = nullptr, .flags = 0,
+      .margin_b = 0, .margin_r = 0,
+    };
+    std::array<struct ncplane*, 2> planes;
+    std::array<struct ncplane*, 2> kids;
+    for(int i = 0 ; i < 2 ; ++i){
+      planes[i] = ncplane_create(n_, &nopts);
+      REQUIRE(nullptr != planes[i]);
+      CHECK(!ncplane_set_scrolling(planes[i], true));
+      kids[i] = ncplane_create(planes[i], &copts);
+      REQUIRE(nullptr != kids[i]);
+      for(int y = 0 ; y < ncplane_dim_y(planes[i]) ; ++y){
+        CHECK(0 < ncplane_printf_yx(planes[i], y, 0, "line %d", y));
+      }
+      CHECK(0 == ncplane_cursor_move_yx(planes[i], 2, 3));
+    }
+    CHECK(0 == ncplane_scrollup(planes[0], 9));
+    for(int i = 0 ; i < 9 ; ++i){
+      CHECK(0 == ncplane_scrollup(planes[1], 1));
+    }
+    int y0, x0, y1, x1;
+    ncplane_cursor_yx(planes[0], &y0, &x0);
+    ncplane_cursor_yx(planes[1], &y1, &x1);
+    CHECK(y0 == y1);
+    CHECK(x0 == x1);
+    CHECK(ncplane_y(kids[0]) == ncplane_y(kids[1]));
+    char* c0 = ncplane_contents(planes[0], 0, 0, 0, 0);
+    char* c1 = ncplane_contents(planes[1], 0, 0, 0, 0);
+    REQUIRE(nullptr != c0);
+    REQUIRE(nullptr != c1);
+    CHECK(0 == strcmp(c0, c1));
+    free(c0);
+    free(c1);
+    CHECK(0 == notcurses_render(nc_));
+    CHECK(0 == ncplane_destroy(planes[0]));
+    CHECK(0 == ncplane_destroy(planes[1]));
+  }
+
+  // a big chunk of text through ncplane_putstr() must leave the plane just as
+  // writing it EGC by EGC would
+  SUBCASE("ScrollingPutstrBulk") {
+    struct ncplane_options nopts = {
+      .y = 1,
+      .x = 1,
+      .rows = 5,
+      .cols = 16,
+      .userptr = nullptr, .name = nullptr, .resizecb = nullptr, .flags = 0,
+      .margin_b = 0, .margin_r = 0,
+    };
+    std::string text;
+    for(int i = 0 ; i < 200 ; ++i){
+      text += "line " + std::to_string(i);
+      if(i % 7 == 0){
+        text += " which is long enough to wrap around";
+      }
+      text += "\n";
+    }
+    text += "tail";
+    auto bulk = ncplane_create(n_, &nopts);
+    REQUIRE(nullptr != bulk);
+    auto slow = ncplane_create(n_, &nopts);
+    REQUIRE(nullptr != slow);
+    CHECK(!ncplane_set_scrolling(bulk, true));
+    CHECK(!ncplane_set_scrolling(slow, true));
+    int bulkcols = ncplane_putstr(bulk, text.c_str());
+    int slowcols = 0;
+    const char* egc = text.c_str();
+    while(*egc){
+      int sbytes;
+      int cols = ncplane_putegc(slow, egc, &sbytes);
+      REQUIRE(0 <= cols);
+      slowcols += cols;
+      egc += sbytes;
+    }
+    CHECK(bulkcols == slowcols);
+    int y0, x0, y1, x1;
+    ncplane_cursor_yx(bulk, &y0, &x0);
+    ncplane_cursor_yx(slow, &y1, &x1);
+    CHECK(y0 == y1);
+    CHECK(x0 == x1);
+    char* c0 = ncplane_contents(bulk, 0, 0, 0, 0);
+    char* c1 = ncplane_contents(slow, 0, 0, 0, 0);
+    REQUIRE(nullptr != c0);
+    REQUIRE(nullptr != c1);
+    CHECK(0 == strcmp(c0, c1));
+    free(c0);
+    free(c1);
+    CHECK(0 == notcurses_render(nc_));
+    CHECK(0 == ncplane_destroy(bulk));
+    CHECK(0 == ncplane_destroy(slow));
+  }
+
+  // a printable ASCII run spanning many rows (without newlines) is written a
+  // row at a time, wrapping and scrolling, through both ncplane_putstr() and
+  // ncplane_putnstr() (the latter cut short mid-run). the run ends with a
+  // character followed by a combining mark, which must stay with it.
+  SUBCASE("ScrollingPutstrRun") {
+    struct ncplane_options nopts = {
+      .y = 1,
+      .x = 1,
+      .rows = 5,
+      .cols = 16,
+      .userptr = nullptr, .name = nullptr, .resizecb = nullptr, .flags = 0,
+      .margin_b = 0, .margin_r = 0,
+    };
+    std::string text;
+    for(int i = 0 ; i < 65536 ; ++i){
+      text += static_cast<char>(' ' + (i * 7) % 95);
+    }
+    text += "e\xcc\x81tail";
+    for(size_t len : { text.size(), text.size() / 2 + 3 }){
+      auto bulk = ncplane_create(n_, &nopts);
+      REQUIRE(nullptr != bulk);
+      auto slow = ncplane_create(n_, &nopts);
+      REQUIRE(nullptr != slow);
+      CHECK(!ncplane_set_scrolling(bulk, true));
+      CHECK(!ncplane_set_scrolling(slow, true));
+      int bulkcols;
+      if(len == text.size()){
+        bulkcols = ncplane_putstr(bulk, text.c_str());
+      }else{
+        bulkcols = ncplane_putnstr(bulk, len, text.c_str());
+      }
+      int slowcols = 0;
+      const char* egc = text.c_str();
+      while(egc < text.c_str() + len){
+        int sbytes;
+        int cols = ncplane_putegc(slow, egc, &sbytes);
+        REQUIRE(0 <= cols);
+        slowcols += cols;
+        egc += sbytes;
+      }
+      CHECK(bulkcols == slowcols);
+      int y0, x0, y1, x1;
+      ncplane_cursor_yx(bulk, &y0, &x0);
+      ncplane_cursor_yx(slow, &y1, &x1);
+      CHECK(y0 == y1);
+      CHECK(x0 == x1);
+      char* c0 = ncplane_contents(bulk, 0, 0, 0, 0);
+      char* c1 = ncplane_contents(slow, 0, 0, 0, 0);
+      REQUIRE(nullptr != c0);
+      REQUIRE(nullptr != c1);
+      CHECK(0 == strcmp(c0, c1));
+      free(c0);
+      free(c1);
+      CHECK(0 == ncplane_destroy(bulk));
+      CHECK(0 == ncplane_destroy(slow));
+    }
+  }
+
+  // a plane spanning full rows is scrolled by the terminal, within a
+  // scrolling region, and the lastframe must track what the terminal did
+  SUBCASE("ScrollingRegion") {
+    struct ncplane_options nopts = {
+      .y = 2,
+      .x = 0,
+      .rows = 6,
+      .cols = ncplane_dim_x(n_),
+      .userptr = nullptr, .name = nullptr, .resizecb = nullptr, .flags = 0,
+      .margin_b = 0, .margin_r = 0,
+    };
+    auto n = ncplane_create(n_, &nopts);
+    REQUIRE(nullptr != n);
+    CHECK(!ncplane_set_scrolling(n, true));
+    for(int y = 0 ; y < ncplane_dim_y(n) ; ++y){
+      CHECK(0 < ncplane_printf_yx(n, y, 0, "%d", y));
+    }
+    CHECK(0 == notcurses_render(nc_));
+    CHECK(0 == ncplane_scrollup(n, 2));
+    CHECK(2 == ncplane_pile(n)->rscrolls);
+    CHECK(0 == notcurses_render(nc_));
+    CHECK(0 == ncplane_pile(n)->rscrolls);
+    for(int y = 0 ; y < ncplane_dim_y(n) ; ++y){
+      char* egc = notcurses_at_yx(nc_, ncplane_abs_y(n) + y, 0, nullptr, nullptr);
+      REQUIRE(nullptr != egc);
+      if(y < ncplane_dim_y(n) - 2){
+        CHECK('0' + y + 2 == egc[0]);
+      }else{
+        CHECK(0 == strcmp(egc, ""));
+      }
+      free(egc);
+    }
+    CHECK(0 == ncplane_destroy(n));
+  }
+
+  // rows scrolled away are retained in history, and can be viewed once more
+  SUBCASE("ScrollingHistory") {
+    struct ncplane_options nopts = {
+      .y = 1,
+      .x = 1,
+      .rows = 4,
+      .cols = 20,
+      .userptr = nullptr, .name = nullptr, .resizecb = nullptr, .flags = 0,
+      .margin_b = 0, .margin_r = 0,
+    };
+    auto n = ncplane_create(n_, &nopts);
+    REQUIRE(nullptr != n);
+    CHECK(!ncplane_set_scrolling(n, true));
+    char path[] = "/tmp/nchistoryXXXXXX";
+    int fd = mkstemp(path);
+    REQUIRE(0 <= fd);
+    close(fd);
+    CHECK(0 > ncplane_history_seek(n, 0));
+    REQUIRE(0 == ncplane_set_history(n, path));
+    // the extended EGC must survive the round trip through the file
+    CHECK(0 < ncplane_putstr(n, "0\n1\n2e\u0301\u0301\n3\n4\n5\n6\n7\n8\n9"));
+    CHECK(6 == ncplane_history_rows(n));
+    CHECK(0 > ncplane_history_seek(n, 7));
+    CHECK(0 == ncplane_history_seek(n, 3));
+    CHECK(0 == notcurses_render(nc_));
+    const char* expected[] = { "3", "4", "5", "6", };
+    for(int y = 0 ; y < ncplane_dim_y(n) ; ++y){
+      char* egc = notcurses_at_yx(nc_, ncplane_abs_y(n) + y, ncplane_abs_x(n), nullptr, nullptr);
+      REQUIRE(nullptr != egc);
+      CHECK(0 == strcmp(egc, expected[y]));
+      free(egc);
+    }
+    // the view stays where it was while the plane scrolls beneath it
+    CHECK(0 < ncplane_putstr(n, "\nX"));
+    CHECK(7 == ncplane_history_rows(n));
+    CHECK(0 == notcurses_render(nc_));
+    for(int y = 0 ; y < ncplane_dim_y(n) ; ++y){
+      char* egc = notcurses_at_yx(nc_, ncplane_abs_y(n) + y, ncplane_abs_x(n), nullptr, nullptr);
+      REQUIRE(nullptr != egc);
+      CHECK(0 == strcmp(egc, expected[y]));
+      free(egc);
+    }
+    CHECK(0 == ncplane_history_seek(n, 6));
+    CHECK(0 == notcurses_render(nc_));
+    char* egc = notcurses_at_yx(nc_, ncplane_abs_y(n) + 1, ncplane_abs_x(n) + 1, nullptr, nullptr);
+    REQUIRE(nullptr != egc);
+    CHECK(0 == strcmp(egc, "e\u0301\u0301"));
+    free(egc);
+    CHECK(0 == ncplane_history_seek(n, 0));
+    CHECK(0 == notcurses_render(nc_));
+    egc = notcurses_at_yx(nc_, ncplane_abs_y(n) + 3, ncplane_abs_x(n), nullptr, nullptr);
+    REQUIRE(nullptr != egc);
+    CHECK(0 == strcmp(egc, "X"));
+    free(egc);
+    CHECK(0 == ncplane_set_history(n, nullptr));
+    CHECK(0 == ncplane_history_rows(n));
+    CHECK(0 == ncplane_destroy(n));
+    unlink(path);
+  }
+
   CHECK(0 == notcurses_stop(nc_));
 
 }
@@ -1,5 +1,6 @@
 #include "main.h"
 #include "lib/visual-details.h"
+#include <string>
 #include <vector>
 #include <iostream>
 
@@ -77,7 +78,7 @@ std::vector<uint32_t> sixel_to_rgb(const char* s, size_t len, int dimy, int dimx
       }while(isdigit(*s));
       uint32_t rgb = htole(0xff000000 + (r << 16u) * 255 / 100 + (g << 8u) * 255 / 100 + b * 255 / 100);
 //std::cerr << "Got color " << color << ": " << r << "/" << g << "/" << b << std::endl;
-      if(color >= colors.capacity()){
+      if(color >= colors.size()){
         colors.resize(color + 1);
       }
       colors[color] = rgb;
@@ -220,5 +221,238 @@ TEST_CASE("Sixels") {
   }
 #endif
 
+  // four flat quadrants ought come back as four flat quadrants
+  SUBCASE("SixelMedianCut") {
+    const int dimy = nc_->tcache.cellpixy * 2;
+    const int dimx = nc_->tcache.cellpixx * 2;
+    std::vector<uint32_t> rgba(dimy * dimx);
+    const uint32_t quads[4] = {
+      htole(0xff2020e0), htole(0xff20e020), htole(0xffe02020), htole(0xffe0e0e0),
+    };
+    for(int y = 0 ; y < dimy ; ++y){
+      for(int x = 0 ; x < dimx ; ++x){
+        rgba[y * dimx + x] = quads[(y >= dimy / 2) * 2 + (x >= dimx / 2)];
+      }
+    }
+    auto ncv = ncvisual_from_rgba(rgba.data(), dimy, dimx * 4, dimx);
+    REQUIRE(ncv);
+    struct ncvisual_options vopts{};
+    vopts.blitter = NCBLIT_PIXEL;
+    vopts.flags = NCVISUAL_OPTION_NODEGRADE | NCVISUAL_OPTION_MEDIANCUT;
+    auto newn = ncvisual_render(nc_, ncv, &vopts);
+    REQUIRE(newn);
+    CHECK(0 == notcurses_render(nc_));
+    auto rgb = sixel_to_rgb(newn->sprite->glyph.buf, newn->sprite->glyph.used,
+                            newn->sprite->pixy, newn->sprite->pixx);
+    uint32_t seen[4] = { 0, 0, 0, 0 };
+    for(int y = 0 ; y < dimy ; ++y){
+      for(int x = 0 ; x < dimx ; ++x){
+        const int q = (y >= dimy / 2) * 2 + (x >= dimx / 2);
+        const uint32_t px = rgb[y * newn->sprite->pixx + x];
+        CHECK(0 != px);
+        if(seen[q] == 0){
+          seen[q] = px;
+        }
+        CHECK(seen[q] == px);
+      }
+    }
+    for(int q = 0 ; q < 4 ; ++q){
+      for(int p = q + 1 ; p < 4 ; ++p){
+        CHECK(seen[q] != seen[p]);
+      }
+    }
+    CHECK(0 == ncplane_destroy(newn));
+    ncvisual_destroy(ncv);
+  }
+
+  // a byte budget ought shrink the encoding, and leave a hint for next time
+  SUBCASE("SixelBudget") {
+    const int dimy = nc_->tcache.cellpixy * 6;
+    const int dimx = nc_->tcache.cellpixx * 12;
+    std::vector<uint32_t> rgba(dimy * dimx);
+    for(int y = 0 ; y < dimy ; ++y){
+      for(int x = 0 ; x < dimx ; ++x){
+        uint32_t px = 0;
+        ncpixel_set_a(&px, 0xff);
+        ncpixel_set_rgb8(&px, y * 255 / dimy, x * 255 / dimx, (x ^ y) & 0xff);
+        rgba[y * dimx + x] = px;
+      }
+    }
+    auto ncv = ncvisual_from_rgba(rgba.data(), dimy, dimx * 4, dimx);
+    REQUIRE(ncv);
+    struct ncvisual_options vopts{};
+    vopts.blitter = NCBLIT_PIXEL;
+    vopts.flags = NCVISUAL_OPTION_NODEGRADE;
+    auto full = ncvisual_render(nc_, ncv, &vopts);
+    REQUIRE(full);
+    const size_t fullbytes = full->sprite->glyph.used;
+    CHECK(0 == ncv->sixelregs);
+    CHECK(0 == ncvisual_set_pxbudget(ncv, fullbytes / 2));
+    auto budgeted = ncvisual_render(nc_, ncv, &vopts);
+    REQUIRE(budgeted);
+    CHECK(fullbytes > budgeted->sprite->glyph.used);
+    CHECK(0 < ncv->sixelregs);
+    CHECK(0 == notcurses_render(nc_));
+    CHECK(0 == ncplane_destroy(budgeted));
+    CHECK(0 == ncplane_destroy(full));
+    ncvisual_destroy(ncv);
+  }
+
+  // a carried palette ought reproduce the frame from which it was built
+  SUBCASE("SixelKeepPalette") {
+    const int dimy = nc_->tcache.cellpixy * 4;
+    const int dimx = nc_->tcache.cellpixx * 4;
+    std::vector<uint32_t> rgba(dimy * dimx);
+    for(int y = 0 ; y < dimy ; ++y){
+      for(int x = 0 ; x < dimx ; ++x){
+        uint32_t px = 0;
+        ncpixel_set_a(&px, 0xff);
+        ncpixel_set_rgb8(&px, y * 255 / dimy, x * 255 / dimx, 0x80);
+        rgba[y * dimx + x] = px;
+      }
+    }
+    auto ncv = ncvisual_from_rgba(rgba.data(), dimy, dimx * 4, dimx);
+    REQUIRE(ncv);
+    struct ncvisual_options vopts{};
+    vopts.blitter = NCBLIT_PIXEL;
+    vopts.flags = NCVISUAL_OPTION_NODEGRADE | NCVISUAL_OPTION_KEEPPALETTE;
+    auto first = ncvisual_render(nc_, ncv, &vopts);
+    REQUIRE(first);
+    CHECK(nullptr != ncv->spal);
+    auto second = ncvisual_render(nc_, ncv, &vopts);
+    REQUIRE(second);
+    auto rgb1 = sixel_to_rgb(first->sprite->glyph.buf, first->sprite->glyph.used,
+                             first->sprite->pixy, first->sprite->pixx);
+    auto rgb2 = sixel_to_rgb(second->sprite->glyph.buf, second->sprite->glyph.used,
+                             second->sprite->pixy, second->sprite->pixx);
+    CHECK(rgb1 == rgb2);
+    CHECK(0 == notcurses_render(nc_));
+    CHECK(0 == ncplane_destroy(second));
+    CHECK(0 == ncplane_destroy(first));
+    ncvisual_destroy(ncv);
+  }
+
+  // a threaded encode ought produce exactly the same sixel
+  SUBCASE("SixelThreaded") {
+    const int dimy = nc_->tcache.cellpixy * 12;
+    const int dimx = nc_->tcache.cellpixx * 8;
+    std::vector<uint32_t> rgba(dimy * dimx);
+    for(int y = 0 ; y < dimy ; ++y){
+      for(int x = 0 ; x < dimx ; ++x){
+        uint32_t px = 0;
+        ncpixel_set_a(&px, (x + y) % 7 ? 0xff : 0);
+        ncpixel_set_rgb8(&px, y * 255 / dimy, x * 255 / dimx, (x * y) % 256);
+        rgba[y * dimx + x] = px;
+      }
+    }
+    auto ncv = ncvisual_from_rgba(rgba.data(), dimy, dimx * 4, dimx);
+    REQUIRE(ncv);
+    for(auto quant : { 0ull, NCVISUAL_OPTION_MEDIANCUT }){
+      struct ncvisual_options vopts{};
+      vopts.blitter = NCBLIT_PIXEL;
+      vopts.flags = NCVISUAL_OPTION_NODEGRADE | quant;
+      auto serialn = ncvisual_render(nc_, ncv, &vopts);
+      REQUIRE(serialn);
+      vopts.flags |= NCVISUAL_OPTION_THREADED;
+      auto threadn = ncvisual_render(nc_, ncv, &vopts);
+      REQUIRE(threadn);
+      CHECK(serialn->sprite->glyph.used == threadn->sprite->glyph.used);
+      CHECK(0 == memcmp(serialn->sprite->glyph.buf, threadn->sprite->glyph.buf,
+                        serialn->sprite->glyph.used));
+      CHECK(0 == notcurses_render(nc_));
+      CHECK(0 == ncplane_destroy(threadn));
+      CHECK(0 == ncplane_destroy(serialn));
+    }
+    ncvisual_destroy(ncv);
+  }
+
+  // wiping and rebuilding cells re-encodes only the affected bands, splicing
+  // them among the old glyph's others. the result must decode to the wiped
+  // image, match across serial and threaded encodes (whose band offsets are
+  // recorded differently), and once every cell is rebuilt, match the full
+  // encode byte for byte.
+  SUBCASE("SixelReblitBands") {
+    const int celly = 12, cellx = 8;
+    const int dimy = nc_->tcache.cellpixy * celly;
+    const int dimx = nc_->tcache.cellpixx * cellx;
+    std::vector<uint32_t> rgba(dimy * dimx);
+    for(int y = 0 ; y < dimy ; ++y){
+      for(int x = 0 ; x < dimx ; ++x){
+        uint32_t px = 0;
+        ncpixel_set_a(&px, (x + y) % 7 ? 0xff : 0);
+        ncpixel_set_rgb8(&px, y * 255 / dimy, x * 255 / dimx, (x * y) % 256);
+        rgba[y * dimx + x] = px;
+      }
+    }
+    auto ncv = ncvisual_from_rgba(rgba.data(), dimy, dimx * 4, dimx);
+    REQUIRE(ncv);
+    std::vector<std::string> glyphs[2];
+    for(int threaded = 0 ; threaded < 2 ; ++threaded){
+      struct ncvisual_options vopts{};
+      vopts.blitter = NCBLIT_PIXEL;
+      vopts.flags = NCVISUAL_OPTION_NODEGRADE;
+      if(threaded){
+        vopts.flags |= NCVISUAL_OPTION_THREADED;
+      }
+      auto newn = ncvisual_render(nc_, ncv, &vopts);
+      REQUIRE(newn);
+      auto s = newn->sprite;
+      const std::string full(s->glyph.buf, s->glyph.used);
+      const auto fullrgb = sixel_to_rgb(s->glyph.buf, s->glyph.used, s->pixy, s->pixx);
+      CHECK(0 == notcurses_render(nc_));
+      std::vector<ncplane*> blockers(celly * cellx, nullptr);
+      // the wiped cells must be empty, and all others as they were
+      auto check_glyph = [&](){
+        glyphs[threaded].emplace_back(s->glyph.buf, s->glyph.used);
+        auto rgb = sixel_to_rgb(s->glyph.buf, s->glyph.used, s->pixy, s->pixx);
+        for(int y = 0 ; y < s->pixy ; ++y){
+          for(int x = 0 ; x < s->pixx ; ++x){
+            const int c = (y / s->cellpxy) * cellx + x / s->cellpxx;
+            const uint32_t want = blockers[c] ? 0 : fullrgb[y * s->pixx + x];
+            CHECK(want == rgb[y * s->pixx + x]);
+          }
+        }
+      };
+      srand(0);
+      for(int round = 0 ; round < 8 ; ++round){
+        for(int i = 0 ; i < 6 ; ++i){
+          const int c = rand() % (celly * cellx);
+          if(blockers[c] == nullptr){
+            struct ncplane_options nopts = {
+              .y = c / cellx, .x = c % cellx, .rows = 1, .cols = 1,
+              .userptr = nullptr, .name = "blck", .resizecb = nullptr,
+              .flags = 0, .margin_b = 0, .margin_r = 0,
+            };
+            blockers[c] = ncplane_create(n_, &nopts);
+            REQUIRE(nullptr != blockers[c]);
+            CHECK(1 == ncplane_set_base(blockers[c], "x", 0, 0));
+          }
+        }
+        CHECK(0 == notcurses_render(nc_));
+        check_glyph();
+        for(auto& b : blockers){
+          if(b && rand() % 2){
+            CHECK(0 == ncplane_destroy(b));
+            b = nullptr;
+          }
+        }
+        CHECK(0 == notcurses_render(nc_));
+        check_glyph();
+      }
+      for(auto& b : blockers){
+        if(b){
+          CHECK(0 == ncplane_destroy(b));
+          b = nullptr;
+        }
+      }
+      CHECK(0 == notcurses_render(nc_));
+      check_glyph();
+      CHECK(full == glyphs[threaded].back());
+      CHECK(0 == ncplane_destroy(newn));
+    }
+    CHECK(glyphs[0] == glyphs[1]);
+    ncvisual_destroy(ncv);
+  }
+
   CHECK(!notcurses_stop(nc_));
 }
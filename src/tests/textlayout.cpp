@@ -1,4 +1,5 @@
 #include "main.h"
+#include <string>
 
 TEST_CASE("TextLayout") {
   auto nc_ = testing_notcurses();
@@ -633,6 +634,75 @@ TEST_CASE("TextLayout") {
     ncplane_destroy(sp);
   }
 
+  // a layout ought write exactly what ncplane_puttext() writes, whether fresh,
+  // reused at the same width, refilled at a new width, or appended to
+  SUBCASE("LayoutReuse") {
+    const char text[] =
+      "Notcurses provides several widgets to quickly build vivid TUIs.\n\n"
+      "This NCReader widget facilitates free-form text entry complete with readline-style bindings. "
+      "NCSelector allows a single option to be selected from a list.\n";
+    const char more[] = "Widgets can be controlled with the keyboard and/or mouse.";
+    struct ncplane_options nopts = {
+      .y = 0,
+      .x = 0,
+      .rows = 15,
+      .cols = 30,
+      .userptr = nullptr,
+      .name = nullptr,
+      .resizecb = nullptr,
+      .flags = 0,
+      .margin_b = 0, .margin_r = 0,
+    };
+    auto lp = ncplane_create(n_, &nopts);
+    REQUIRE(lp);
+    auto tp = ncplane_create(n_, &nopts);
+    REQUIRE(tp);
+    ncplane_set_scrolling(lp, true);
+    ncplane_set_scrolling(tp, true);
+    auto l = nclayout_create(text);
+    REQUIRE(l);
+    std::string full = text;
+    for(int pass = 0 ; pass < 5 ; ++pass){
+      if(pass == 2){
+        CHECK(0 == ncplane_resize_simple(lp, 15, 17));
+        CHECK(0 == ncplane_resize_simple(tp, 15, 17));
+      }else if(pass == 3){
+        CHECK(0 == nclayout_append(l, more));
+        full += more;
+      }else if(pass == 4){
+        CHECK(0 > nclayout_append(l, "\xff"));
+      }
+      ncplane_erase(lp);
+      ncplane_erase(tp);
+      size_t lbytes, tbytes;
+      int lcols = ncplane_putlayout(lp, 0, NCALIGN_CENTER, l, &lbytes);
+      int tcols = ncplane_puttext(tp, 0, NCALIGN_CENTER, full.c_str(), &tbytes);
+      CHECK(0 < lcols);
+      CHECK(lcols == tcols);
+      CHECK(lbytes == tbytes);
+      CHECK(tbytes == full.size());
+      int ly, lx, ty, tx;
+      ncplane_cursor_yx(lp, &ly, &lx);
+      ncplane_cursor_yx(tp, &ty, &tx);
+      CHECK(ly == ty);
+      CHECK(lx == tx);
+      for(int y = 0 ; y < ncplane_dim_y(lp) ; ++y){
+        for(int x = 0 ; x < ncplane_dim_x(lp) ; ++x){
+          char* legc = ncplane_at_yx(lp, y, x, nullptr, nullptr);
+          char* tegc = ncplane_at_yx(tp, y, x, nullptr, nullptr);
+          REQUIRE(legc);
+          REQUIRE(tegc);
+          CHECK(0 == strcmp(legc, tegc));
+          free(legc);
+          free(tegc);
+        }
+      }
+    }
+    nclayout_destroy(l);
+    ncplane_destroy(tp);
+    ncplane_destroy(lp);
+  }
+
   CHECK(0 == notcurses_stop(nc_));
 
 }
@@ -0,0 +1,170 @@
+#include "main.h"
+
+static int
+allocated_tiles(const ncplane* n){
+  int count = 0;
+  for(int t = 0 ; t < ncplane_tilecount(ncplane_dim_y(n)) ; ++t){
+    if(n->tiles[t]){
+      ++count;
+    }
+  }
+  return count;
+}
+
+TEST_CASE("TiledPlanes") {
+  auto nc_ = testing_notcurses();
+  if(!nc_){
+    return;
+  }
+  struct ncplane* n_ = notcurses_stdplane(nc_);
+  REQUIRE(n_);
+  struct ncplane_options nopts = {
+    .y = 0,
+    .x = 0,
+    .rows = NCPLANE_TILEROWS * 100,
+    .cols = 80,
+    .userptr = nullptr, .name = "tile", .resizecb = nullptr,
+    .flags = NCPLANE_OPTION_TILED,
+    .margin_b = 0, .margin_r = 0,
+  };
+
+  // a fresh tiled plane has no framebuffer, and reads back as empty
+  SUBCASE("TiledEmpty") {
+    ncstats stats;
+    notcurses_stats(nc_, &stats);
+    auto fbbytes = stats.fbbytes;
+    auto n = ncplane_create(n_, &nopts);
+    REQUIRE(nullptr != n);
+    CHECK(nullptr == n->fb);
+    CHECK(0 == allocated_tiles(n));
+    notcurses_stats(nc_, &stats);
+    CHECK(fbbytes == stats.fbbytes);
+    uint16_t stylemask;
+    uint64_t channels;
+    char* egc = ncplane_at_yx(n, ncplane_dim_y(n) - 1, 10, &stylemask, &channels);
+    REQUIRE(nullptr != egc);
+    CHECK(0 == strcmp(egc, ""));
+    free(egc);
+    CHECK(0 == notcurses_render(nc_));
+    CHECK(0 == allocated_tiles(n));
+    CHECK(0 == ncplane_destroy(n));
+  }
+
+  // writes allocate only the tile they land in
+  SUBCASE("TiledWrite") {
+    ncstats stats;
+    notcurses_stats(nc_, &stats);
+    auto fbbytes = stats.fbbytes;
+    auto n = ncplane_create(n_, &nopts);
+    REQUIRE(nullptr != n);
+    const int y = NCPLANE_TILEROWS * 50 + 3;
+    CHECK(0 < ncplane_putstr_yx(n, y, 2, "tiled"));
+    CHECK(1 == allocated_tiles(n));
+    CHECK(nullptr != n->tiles[50]);
+    notcurses_stats(nc_, &stats);
+    CHECK(fbbytes + sizeof(nccell) * NCPLANE_TILEROWS * 80 == stats.fbbytes);
+    char* egc = ncplane_at_yx(n, y, 3, nullptr, nullptr);
+    REQUIRE(nullptr != egc);
+    CHECK(0 == strcmp(egc, "i"));
+    free(egc);
+    CHECK(0 == notcurses_render(nc_));
+    ncplane_erase(n);
+    CHECK(0 == allocated_tiles(n));
+    notcurses_stats(nc_, &stats);
+    CHECK(fbbytes == stats.fbbytes);
+    CHECK(0 == ncplane_destroy(n));
+  }
+
+  // scrolling through unallocated tiles mustn't allocate them
+  SUBCASE("TiledScroll") {
+    auto n = ncplane_create(n_, &nopts);
+    REQUIRE(nullptr != n);
+    ncplane_set_scrolling(n, true);
+    CHECK(0 < ncplane_putstr_yx(n, 0, 0, "top"));
+    CHECK(1 == allocated_tiles(n));
+    CHECK(0 == ncplane_cursor_move_yx(n, ncplane_dim_y(n) - 1, 0));
+    CHECK(0 == ncplane_scrollup(n, NCPLANE_TILEROWS * 10));
+    CHECK(1 == allocated_tiles(n));
+    char* egc = ncplane_at_yx(n, 0, 0, nullptr, nullptr);
+    REQUIRE(nullptr != egc);
+    CHECK(0 == strcmp(egc, ""));
+    free(egc);
+    CHECK(0 == ncplane_destroy(n));
+  }
+
+  // resizing and duplication carry only the allocated tiles
+  SUBCASE("TiledResizeDup") {
+    auto n = ncplane_create(n_, &nopts);
+    REQUIRE(nullptr != n);
+    const int y = NCPLANE_TILEROWS * 2 + 1;
+    CHECK(0 < ncplane_putstr_yx(n, y, 0, "kept"));
+    const int leny = ncplane_dim_y(n) / 2;
+    CHECK(0 == ncplane_resize(n, 0, 0, leny, 40, 0, 0, leny, 60));
+    CHECK(1 == allocated_tiles(n));
+    char* egc = ncplane_at_yx(n, y, 0, nullptr, nullptr);
+    REQUIRE(nullptr != egc);
+    CHECK(0 == strcmp(egc, "k"));
+    free(egc);
+    auto dup = ncplane_dup(n, nullptr);
+    REQUIRE(nullptr != dup);
+    CHECK(ncplane_tiled_p(dup));
+    CHECK(1 == allocated_tiles(dup));
+    egc = ncplane_at_yx(dup, y, 3, nullptr, nullptr);
+    REQUIRE(nullptr != egc);
+    CHECK(0 == strcmp(egc, "t"));
+    free(egc);
+    CHECK(0 == notcurses_render(nc_));
+    CHECK(0 == ncplane_destroy(dup));
+    CHECK(0 == ncplane_destroy(n));
+  }
+
+  // greyscaling leaves unallocated tiles unallocated
+  SUBCASE("TiledGreyscale") {
+    auto n = ncplane_create(n_, &nopts);
+    REQUIRE(nullptr != n);
+    const int y = NCPLANE_TILEROWS * 40;
+    CHECK(0 == ncplane_set_fg_rgb(n, 0x40f080));
+    CHECK(0 < ncplane_putstr_yx(n, y, 0, "grey"));
+    CHECK(1 == allocated_tiles(n));
+    ncplane_greyscale(n);
+    CHECK(1 == allocated_tiles(n));
+    uint64_t channels;
+    char* egc = ncplane_at_yx(n, y, 0, nullptr, &channels);
+    REQUIRE(nullptr != egc);
+    CHECK(0 == strcmp(egc, "g"));
+    free(egc);
+    unsigned r, g, b;
+    ncchannels_fg_rgb8(channels, &r, &g, &b);
+    CHECK(r == g);
+    CHECK(g == b);
+    CHECK(0 == ncplane_destroy(n));
+  }
+
+  // merging down onto a tiled plane allocates only the tiles written to
+  SUBCASE("TiledMergedown") {
+    auto n = ncplane_create(n_, &nopts);
+    REQUIRE(nullptr != n);
+    struct ncplane_options sopts = {
+      .y = NCPLANE_TILEROWS * 20 + 1,
+      .x = 4,
+      .rows = 2,
+      .cols = 8,
+      .userptr = nullptr, .name = "src", .resizecb = nullptr,
+      .flags = 0, .margin_b = 0, .margin_r = 0,
+    };
+    auto src = ncplane_create(n_, &sopts);
+    REQUIRE(nullptr != src);
+    CHECK(0 < ncplane_putstr_yx(src, 0, 0, "merged"));
+    CHECK(0 == allocated_tiles(n));
+    CHECK(0 == ncplane_mergedown_simple(src, n));
+    CHECK(1 == allocated_tiles(n));
+    char* egc = ncplane_at_yx(n, sopts.y, sopts.x, nullptr, nullptr);
+    REQUIRE(nullptr != egc);
+    CHECK(0 == strcmp(egc, "m"));
+    free(egc);
+    CHECK(0 == ncplane_destroy(src));
+    CHECK(0 == ncplane_destroy(n));
+  }
+
+  CHECK(0 == notcurses_stop(nc_));
+}